@@ -0,0 +1,120 @@
+#include "Checks.h"
+#include "ColliderTree.h"
+#include "Collider.h"
+#include "CollisionTests.h"
+
+using namespace Glade;
+
+bool Checks::Run(FILE* out)
+{
+	bool passed = true;
+	passed &= ColliderTreeSplit(out);
+	passed &= ConvexHullFollowsBody(out);
+	passed &= ConvexHullFlatSupport(out);
+	passed &= SphereConvexHullDepth(out);
+	fprintf(out, "\n");
+	return passed;
+}
+
+bool Checks::ColliderTreeSplit(FILE* out)
+{
+	// 8 unit boxes along x, in scrambled order. Only minimum and maximum are set, like Collider bounds
+	const int xs[8] = { 5, 1, 7, 3, 0, 6, 2, 4 };
+	std::vector<AABB> bounds(8);
+	for(unsigned int i = 0; i < 8; ++i)
+	{
+		bounds[i].minimum = Vector(gFloat(xs[i] * 2), gFloat(0.0f), gFloat(0.0f));
+		bounds[i].maximum = bounds[i].minimum + Vector(1, 1, 1);
+		bounds[i].center = Vector();
+	}
+	ColliderTree tree;
+	tree.Build(bounds);
+
+	// Each child of the root should hold one half of the row, boxes 0-3 (x 0 to 7) and 4-7 (x 8 to 15)
+	Vector c1, e1, c2, e2;
+	tree.GetNodeBox(1, c1, e1);
+	tree.GetNodeBox(2, c2, e2);
+	bool passed = tree.GetNumNodes() == 15 && Abs(e1.x - gFloat(3.5f)) < EPSILON && Abs(e2.x - gFloat(3.5f)) < EPSILON &&
+				  Abs(c1.x - c2.x) > e1.x + e2.x;
+	fprintf(out, "%-48s %s\n", "ColliderTree splits Colliders in a row", passed ? "ok" : "FAILED");
+	return passed;
+}
+
+bool Checks::ConvexHullFollowsBody(FILE* out)
+{
+	// Unit cube centered 4 units along x
+	std::vector<Vector> points;
+	for(int i = 0; i < 8; ++i)
+		points.push_back(Vector(gFloat(3.5f + (i & 1)), gFloat((i & 2) ? 0.5f : -0.5f), gFloat((i & 4) ? 0.5f : -0.5f)));
+	SmartPointer<ConvexHull> hull(new ConvexHull(points));
+	ConvexHullCollider collider(nullptr, SmartPointer<PhysicMaterial>(), 1, hull);
+
+	// Turn the body a quarter around z and move it. The hull should land where the points themselves land
+	Matrix body = Matrix::MatrixFromZAxisRotation(gFloat(PI * 0.5f)) * Matrix::MatrixFromTranslation(Vector(1, 2, 3));
+	collider.CalcTransformAndDerivedGeometricData(body);
+
+	bool passed = true;
+	for(int i = 0; i < 8; ++i)
+	{
+		Vector d(gFloat((i & 1) ? 1.0f : -1.0f), gFloat((i & 2) ? 1.0f : -1.0f), gFloat((i & 4) ? 0.5f : -0.5f));
+		gFloat expected = -G_MAX;
+		for(unsigned int j = 0; j < points.size(); ++j)
+			expected = Max(expected, (points[j] * body).DotProduct(d));
+		passed &= Abs(collider.GetSupportPoint(d).DotProduct(d) - expected) < gFloat(1e-4f);
+	}
+	fprintf(out, "%-48s %s\n", "ConvexHull Collider follows its body", passed ? "ok" : "FAILED");
+	return passed;
+}
+
+bool Checks::ConvexHullFlatSupport(FILE* out)
+{
+	// 12 points on a circle and 12 inside it, in a plane tilted away from every axis
+	Matrix tilt = Matrix::MatrixFromAxisAngle(gFloat(0.7f), Vector(1, 2, 3).Normalized());
+	std::vector<Vector> points;
+	for(int i = 0; i < 24; ++i)
+	{
+		gFloat angle = gFloat(PI * 2.0f) * gFloat(i) / gFloat(12.0f), radius = gFloat(i < 12 ? 2.0f : 1.0f);
+		points.push_back(Vector(radius * cos(angle), radius * sin(angle), gFloat(0.0f)) * tilt);
+	}
+	ConvexHull hull(points);
+
+	bool passed = hull.GetNumVertices() == 12;
+	for(int i = 0; i < 64; ++i)
+	{
+		gFloat yaw = gFloat(PI * 2.0f) * gFloat(i) / gFloat(64.0f), pitch = gFloat(i % 5) - gFloat(2.0f);
+		Vector d(cos(yaw), sin(yaw), pitch * gFloat(0.3f));
+		gFloat expected = -G_MAX;
+		for(unsigned int j = 0; j < points.size(); ++j)
+			expected = Max(expected, (points[j] - hull.GetCentroid()).DotProduct(d));
+		passed &= Abs(hull.GetVertex(hull.Support(d)).DotProduct(d) - expected) < gFloat(1e-4f);
+	}
+	fprintf(out, "%-48s %s\n", "ConvexHull of flat points supports every way", passed ? "ok" : "FAILED");
+	return passed;
+}
+
+bool Checks::SphereConvexHullDepth(FILE* out)
+{
+	// Hull of a cube 2 units wide, and a Sphere of radius 1 half a unit into its +x face, then a unit away from it
+	std::vector<Vector> points;
+	for(int i = 0; i < 8; ++i)
+		points.push_back(Vector(gFloat((i & 1) ? 1.0f : -1.0f), gFloat((i & 2) ? 1.0f : -1.0f), gFloat((i & 4) ? 1.0f : -1.0f)));
+	typedef PhysicMaterial::PhysicMaterialCombine MaterialCombine;
+	SmartPointer<PhysicMaterial> material = PhysicMaterial::CreateFromData(std::string("Checks Material"), false, MaterialCombine::AVERAGE, MaterialCombine::AVERAGE,
+																		  gFloat(0.5f), gFloat(0.5f), gFloat(0.4f));
+	ConvexHullCollider hull(nullptr, material, 1, SmartPointer<ConvexHull>(new ConvexHull(points)));
+	SphereCollider sphere(nullptr, material, 1, gFloat(1.0f));
+	hull.CalcTransformAndDerivedGeometricData(Matrix());
+
+	Contact contacts[MAX_CONTACTS_PER_TEST];
+	CollisionWarmStart warmStart;
+	sphere.CalcTransformAndDerivedGeometricData(Matrix::MatrixFromTranslation(Vector(gFloat(1.5f), gFloat(0.2f), gFloat(-0.1f))));
+	CollisionTests::Kernel test = CollisionTests::SelectKernel(&sphere, &hull);
+	int used = test(&sphere, &hull, contacts, &warmStart);
+	bool passed = used == 1 && Abs(contacts[0].GetPenetrationDepth() - gFloat(0.5f)) < gFloat(0.01f) && Abs(Abs(contacts[0].GetNormal().x) - gFloat(1.0f)) < gFloat(0.01f);
+
+	warmStart = CollisionWarmStart();
+	sphere.CalcTransformAndDerivedGeometricData(Matrix::MatrixFromTranslation(Vector(gFloat(3.0f), gFloat(0.2f), gFloat(-0.1f))));
+	passed &= test(&sphere, &hull, contacts, &warmStart) == 0;
+	fprintf(out, "%-48s %s\n", "Sphere into ConvexHull found as deep as it is", passed ? "ok" : "FAILED");
+	return passed;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdio.h>
+
+// Correctness checks for engine code the timings depend on. Each prints one line and returns whether it passed
+class Checks
+{
+public:
+	// Run every check. Returns false if any failed
+	static bool Run(FILE* out);
+
+private:
+	// Colliders in a row are split into the two halves of the row by a ColliderTree, even though their bounds'
+	// centers are never set
+	static bool ColliderTreeSplit(FILE* out);
+	// A ConvexHullCollider built from points away from the origin stays on those points when its RigidBody turns
+	static bool ConvexHullFollowsBody(FILE* out);
+	// A ConvexHull of points in a tilted plane finds the farthest point in every direction, not only along the axes
+	static bool ConvexHullFlatSupport(FILE* out);
+	// A Sphere pushed into a box-shaped ConvexHull is found as deep as it is, and one beside it isn't found at all
+	static bool SphereConvexHullDepth(FILE* out);
+};
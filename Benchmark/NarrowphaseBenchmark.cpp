@@ -0,0 +1,349 @@
+#include "NarrowphaseBenchmark.h"
+#include "Math\Quaternion.h"
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#define NUM_SHAPES	10
+
+// Each call's result is added here so the calls being timed can't be optimized away
+static volatile int benchmarkSink;
+
+static const char* RegimeNames[] = { "separated", "grazing", "penetrating" };
+
+NarrowphaseBenchmark::NarrowphaseBenchmark(unsigned int poses, unsigned int calls, unsigned int seed) : posesPerRegime(poses), callsPerPose(calls), random(seed)
+{
+	typedef PhysicMaterial::PhysicMaterialCombine MaterialCombine;
+	material = PhysicMaterial::CreateFromData(std::string("Benchmark Material"), false, MaterialCombine::AVERAGE, MaterialCombine::AVERAGE,
+											  gFloat(0.5f), gFloat(0.5f), gFloat(0.4f));
+
+	// Flat 8x8 grid of triangles centered on the origin, facing up
+	std::vector<Vector> verts;
+	std::vector<unsigned int> inds;
+	for(int z = 0; z <= 8; ++z)
+		for(int x = 0; x <= 8; ++x)
+			verts.push_back(Vector(gFloat(x - 4), gFloat(0.0f), gFloat(z - 4)));
+	for(unsigned int z = 0; z < 8; ++z)
+	{
+		for(unsigned int x = 0; x < 8; ++x)
+		{
+			unsigned int i = z * 9 + x;
+			inds.push_back(i); inds.push_back(i + 9); inds.push_back(i + 1);
+			inds.push_back(i + 1); inds.push_back(i + 9); inds.push_back(i + 10);
+		}
+	}
+	triangleMesh = SmartPointer<TriangleMesh>(new TriangleMesh(verts, inds));
+
+	// Same grid as a HeightField. Its corner is at the origin, so MakeCollider offsets it to the center
+	heightField = SmartPointer<HeightField>(new HeightField(std::vector<gFloat>(9 * 9, gFloat(0.0f)), 9, 9, gFloat(1.0f)));
+
+	// Points on a unit sphere for the MeshCollider and ConvexHull
+	std::vector<Vector> points;
+	for(unsigned int i = 0; i < 32; ++i)
+		points.push_back(RandomDirection());
+	meshVertices.assign(points.begin(), points.begin() + 12);
+	convexHull = SmartPointer<ConvexHull>(new ConvexHull(points));
+}
+
+NarrowphaseBenchmark::Category NarrowphaseBenchmark::GetCategory(Collider::ColliderShape shape)
+{
+	switch(shape)
+	{
+	case Collider::ColliderShape::PLANE:			return PLANE;
+	case Collider::ColliderShape::TRIANGLE_MESH:
+	case Collider::ColliderShape::HEIGHTFIELD:		return SURFACE;
+	default:										return CONVEX;
+	}
+}
+
+const char* NarrowphaseBenchmark::GetName(Collider::ColliderShape shape)
+{
+	static const char* names[NUM_SHAPES] = { "Sphere", "Box", "Capsule", "Cone", "Cylinder", "Plane", "Mesh", "TriangleMesh", "HeightField", "ConvexHull" };
+	return names[(int)shape];
+}
+
+gFloat NarrowphaseBenchmark::GetSize(Collider::ColliderShape shape)
+{
+	switch(shape)
+	{
+	case Collider::ColliderShape::BOX:		return Vector(1.0f, 0.75f, 0.5f).Magnitude();
+	case Collider::ColliderShape::CAPSULE:	return gFloat(1.25f);
+	case Collider::ColliderShape::CONE:
+	case Collider::ColliderShape::CYLINDER:	return Vector(0.75f, 0.75f, 0.0f).Magnitude();
+	case Collider::ColliderShape::PLANE:
+	case Collider::ColliderShape::TRIANGLE_MESH:
+	case Collider::ColliderShape::HEIGHTFIELD:	return gFloat(4.0f);
+	default:								return gFloat(1.0f);
+	}
+}
+
+Collider* NarrowphaseBenchmark::MakeCollider(Collider::ColliderShape shape, const Matrix& transform, const Vector& planeNormal, gFloat planeD)
+{
+	Collider* c = nullptr;
+	switch(shape)
+	{
+	case Collider::ColliderShape::SPHERE:		c = new SphereCollider(nullptr, material, 1, gFloat(1.0f)); break;
+	case Collider::ColliderShape::BOX:			c = new BoxCollider(nullptr, material, 1, Vector(1.0f, 0.75f, 0.5f)); break;
+	case Collider::ColliderShape::CAPSULE:		c = new CapsuleCollider(nullptr, material, 1, gFloat(0.5f), gFloat(1.5f)); break;
+	case Collider::ColliderShape::CONE:			c = new ConeCollider(nullptr, material, 1, gFloat(0.75f), gFloat(1.5f)); break;
+	case Collider::ColliderShape::CYLINDER:		c = new CylinderCollider(nullptr, material, 1, gFloat(0.75f), gFloat(1.5f)); break;
+	case Collider::ColliderShape::PLANE:		c = new PlaneCollider(nullptr, material, 0, planeNormal, planeD, gFloat(100.0f), gFloat(100.0f)); break;
+	case Collider::ColliderShape::MESH:			c = new MeshCollider(nullptr, material, 1, meshVertices); break;
+	case Collider::ColliderShape::TRIANGLE_MESH:	c = new TriangleMeshCollider(nullptr, material, triangleMesh); break;
+	case Collider::ColliderShape::HEIGHTFIELD:	c = new HeightFieldCollider(nullptr, material, heightField, Matrix::MatrixFromTranslation(Vector(-4.0f, 0.0f, -4.0f))); break;
+	case Collider::ColliderShape::CONVEX_HULL:	c = new ConvexHullCollider(nullptr, material, 1, convexHull); break;
+	}
+	c->CalcTransformAndDerivedGeometricData(transform);
+	return c;
+}
+
+// Collider has no virtual destructor, so delete as the concrete type
+static void DeleteCollider(Collider* c)
+{
+	switch(c->GetShape())
+	{
+	case Collider::ColliderShape::SPHERE:		delete static_cast<SphereCollider*>(c); break;
+	case Collider::ColliderShape::BOX:			delete static_cast<BoxCollider*>(c); break;
+	case Collider::ColliderShape::CAPSULE:		delete static_cast<CapsuleCollider*>(c); break;
+	case Collider::ColliderShape::CONE:			delete static_cast<ConeCollider*>(c); break;
+	case Collider::ColliderShape::CYLINDER:		delete static_cast<CylinderCollider*>(c); break;
+	case Collider::ColliderShape::PLANE:		delete static_cast<PlaneCollider*>(c); break;
+	case Collider::ColliderShape::MESH:			delete static_cast<MeshCollider*>(c); break;
+	case Collider::ColliderShape::TRIANGLE_MESH:	delete static_cast<TriangleMeshCollider*>(c); break;
+	case Collider::ColliderShape::HEIGHTFIELD:	delete static_cast<HeightFieldCollider*>(c); break;
+	case Collider::ColliderShape::CONVEX_HULL:	delete static_cast<ConvexHullCollider*>(c); break;
+	}
+}
+
+static Matrix MakeTransform(Vector position, Quaternion orientation)
+{
+	Matrix m;
+	m.ComposeTransformationMatrix(&position, &orientation, nullptr);
+	return m;
+}
+
+Quaternion NarrowphaseBenchmark::RandomOrientation()
+{
+	// Normalized 4D Gaussian is uniform over rotations
+	std::normal_distribution<double> gauss;
+	Quaternion q(gauss(random), gauss(random), gauss(random), gauss(random));
+	q.NormalizeInPlace();
+	return q;
+}
+
+Vector NarrowphaseBenchmark::RandomDirection()
+{
+	std::normal_distribution<double> gauss;
+	Vector v;
+	do { v = Vector(gauss(random), gauss(random), gauss(random)); } while(v.SquaredMagnitude() < EPSILON);
+	return v.Normalized();
+}
+
+gFloat NarrowphaseBenchmark::TouchingDistance(Collider::ColliderShape shapeA, const Matrix& aTransform, Collider::ColliderShape shapeB, const Matrix& bRotation, const Vector& dir)
+{
+	Collider* a = MakeCollider(shapeA, aTransform);
+	Collider* b = MakeCollider(shapeB, bRotation);
+	Vector pointA, pointB;
+
+	// Both contain their own center, so they touch at 0 and can't touch past the sum of their sizes
+	gFloat lo = gFloat(0.0f), hi = GetSize(shapeA) + GetSize(shapeB) + gFloat(0.1f), mid;
+	for(unsigned int i = 0; i < 32; ++i)
+	{
+		mid = (lo + hi) * gFloat(0.5f);
+		b->CalcTransformAndDerivedGeometricData(bRotation * Matrix::MatrixFromTranslation(dir * mid));
+		if(CollisionTests::GJKDistance(a, b, pointA, pointB) > gFloat(0.0f))
+			hi = mid;
+		else
+			lo = mid;
+	}
+
+	DeleteCollider(a);
+	DeleteCollider(b);
+	return hi;
+}
+
+bool NarrowphaseBenchmark::MakePair(Collider::ColliderShape shapeA, Collider::ColliderShape shapeB, Regime regime, Collider*& a, Collider*& b)
+{
+	Category catA = GetCategory(shapeA), catB = GetCategory(shapeB);
+	Matrix identity;
+
+	// Neither Collider moves, so there is nothing to pose. Both pass through the origin, so only timed penetrating
+	if(catA != CONVEX && catB != CONVEX)
+	{
+		if(regime != PENETRATING)
+			return false;
+		a = MakeCollider(shapeA, identity, RandomDirection(), gFloat(0.0f));
+		b = MakeCollider(shapeB, identity, RandomDirection(), gFloat(0.0f));
+		return true;
+	}
+
+	if(catA == CONVEX && catB == CONVEX)
+	{
+		// Move 'b' away from 'a' along a random direction until they just stop touching, then back in or further out
+		Matrix aTransform = MakeTransform(Vector(), RandomOrientation());
+		Matrix bRotation = MakeTransform(Vector(), RandomOrientation());
+		Vector dir = RandomDirection();
+		gFloat touching = TouchingDistance(shapeA, aTransform, shapeB, bRotation, dir);
+		gFloat size = Min(GetSize(shapeA), GetSize(shapeB)), t;
+		switch(regime)
+		{
+		case SEPARATED:	t = touching + size * gFloat(0.25f); break;
+		case GRAZING:	t = touching - size * gFloat(0.01f); break;
+		default:		t = touching * gFloat(0.5f); break;
+		}
+		a = MakeCollider(shapeA, aTransform);
+		b = MakeCollider(shapeB, bRotation * Matrix::MatrixFromTranslation(dir * t));
+		return true;
+	}
+
+	// One convex Collider against a Plane or surface. Find its lowest and highest points along the other's normal
+	Collider::ColliderShape convexShape = catA == CONVEX ? shapeA : shapeB, otherShape = catA == CONVEX ? shapeB : shapeA;
+	Quaternion orientation = RandomOrientation();
+	Collider* convex = MakeCollider(convexShape, MakeTransform(Vector(), orientation));
+	Vector normal = GetCategory(otherShape) == PLANE ? RandomDirection() : Vector(0, 1, 0);
+	gFloat low = convex->GetSupportPoint(normal.Negated()).DotProduct(normal);
+	gFloat high = convex->GetSupportPoint(normal).DotProduct(normal);
+	gFloat size = GetSize(convexShape), offset;
+	switch(regime)
+	{
+	case SEPARATED:	offset = low - size * gFloat(0.25f); break;
+	case GRAZING:	offset = low + size * gFloat(0.01f); break;
+	default:		offset = (low + high) * gFloat(0.5f); break;
+	}
+
+	Collider* other;
+	if(GetCategory(otherShape) == PLANE)
+		other = MakeCollider(otherShape, identity, normal, offset);
+	else
+	{
+		// Surface stays at y = 0, so move the convex Collider instead, somewhere over the middle of it
+		std::uniform_real_distribution<double> across(-2.0, 2.0);
+		other = MakeCollider(otherShape, identity);
+		convex->CalcTransformAndDerivedGeometricData(MakeTransform(Vector(across(random), -offset, across(random)), orientation));
+	}
+
+	a = catA == CONVEX ? convex : other;
+	b = catA == CONVEX ? other : convex;
+	return true;
+}
+
+NarrowphaseBenchmark::Result NarrowphaseBenchmark::Measure(Collider::ColliderShape shapeA, Collider::ColliderShape shapeB, Regime regime, CollisionTests::Kernel test)
+{
+	Result r = { 0.0, 0.0, 0.0, 0.0, 0.0, false };
+	Contact contacts[MAX_CONTACTS_PER_TEST];
+	CollisionWarmStart warmStart;
+	unsigned long long totalContacts = 0, zeroPoses = 0, gjkIterations = 0, epaIterations = 0;
+	double totalNs = 0.0;
+	Collider* a, *b;
+	int sink = 0;
+
+	for(unsigned int p = 0; p < posesPerRegime; ++p)
+	{
+		if(!MakePair(shapeA, shapeB, regime, a, b))
+			return r;
+
+		// Every call starts cold, the same as a pair seen for the first time
+		// Contacts start with no normal and a NaN depth, so ones a test counts but never fills in aren't counted here either
+		for(unsigned int c = 0; c < MAX_CONTACTS_PER_TEST; ++c)
+			contacts[c].SetNewContact(nullptr, nullptr, 0, 0, 0, Vector(), Vector(), std::numeric_limits<gFloat>::quiet_NaN());
+		warmStart = CollisionWarmStart();
+		int used = test(a, b, contacts, &warmStart), filled = 0;
+		for(int c = 0; c < used; ++c)
+			filled += contacts[c].GetNormal().SquaredMagnitude() > gFloat(0.0f) && !std::isnan(contacts[c].GetPenetrationDepth()) ? 1 : 0;
+		totalContacts += filled;
+		zeroPoses += filled == 0 ? 1 : 0;
+		gjkIterations += warmStart.gjkIterations;
+		epaIterations += warmStart.epaIterations;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for(unsigned int c = 0; c < callsPerPose; ++c)
+		{
+			warmStart.valid = false;
+			warmStart.axis = 0;
+			sink += test(a, b, contacts, &warmStart);
+		}
+		totalNs += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+
+		DeleteCollider(a);
+		DeleteCollider(b);
+	}
+	benchmarkSink = sink;
+
+	r.nsPerCall = totalNs / ((double)posesPerRegime * callsPerPose);
+	r.contactsPerCall = (double)totalContacts / posesPerRegime;
+	r.zeroFraction = (double)zeroPoses / posesPerRegime;
+	r.gjkIterations = (double)gjkIterations / posesPerRegime;
+	r.epaIterations = (double)epaIterations / posesPerRegime;
+	r.measured = true;
+	return r;
+}
+
+void NarrowphaseBenchmark::PrintRow(FILE* out, const std::string& pair, Regime regime, const Result& r)
+{
+	if(!r.measured)
+		return;
+	fprintf(out, "%-26s %-12s %10.1f %9.2f %6.0f%%", pair.c_str(), RegimeNames[regime], r.nsPerCall, r.contactsPerCall, r.zeroFraction * 100.0);
+	if(r.gjkIterations > 0.0)
+		fprintf(out, " %7.1f %7.1f\n", r.gjkIterations, r.epaIterations);
+	else
+		fprintf(out, " %7s %7s\n", "-", "-");
+}
+
+void NarrowphaseBenchmark::Run(FILE* out)
+{
+	std::vector<std::string> silent;
+	Matrix identity;
+	const char* header = "%-26s %-12s %10s %9s %7s %7s %7s\n";
+
+	// Every entry of the Collision Test table. The table is symmetric, so each unordered pair once
+	fprintf(out, "Collision Tests (%u poses x %u calls per regime)\n", posesPerRegime, callsPerPose);
+	fprintf(out, header, "Pair", "Regime", "ns/call", "contacts", "none", "GJK it", "EPA it");
+	for(int i = 0; i < NUM_SHAPES; ++i)
+	{
+		for(int j = i; j < NUM_SHAPES; ++j)
+		{
+			Collider::ColliderShape shapeA = (Collider::ColliderShape)i, shapeB = (Collider::ColliderShape)j;
+			std::string pair = std::string(GetName(shapeA)) + "-" + GetName(shapeB);
+
+			Collider* a = MakeCollider(shapeA, identity), *b = MakeCollider(shapeB, identity);
+			CollisionTests::Kernel test = CollisionTests::SelectKernel(a, b);
+			DeleteCollider(a);
+			DeleteCollider(b);
+
+			bool missed = false;
+			for(int regime = 0; regime < NUM_REGIMES; ++regime)
+			{
+				Result r = Measure(shapeA, shapeB, (Regime)regime, test);
+				PrintRow(out, pair, (Regime)regime, r);
+				missed = missed || (regime == PENETRATING && r.measured && r.contactsPerCall == 0.0);
+			}
+			if(missed)
+				silent.push_back(pair);
+		}
+	}
+
+	// GJK and EPA on their own, for every pair of convex shapes, whichever test the table uses for them
+	fprintf(out, "\nGJK/EPA\n");
+	fprintf(out, header, "Pair", "Regime", "ns/call", "contacts", "none", "GJK it", "EPA it");
+	for(int i = 0; i < NUM_SHAPES; ++i)
+	{
+		if(GetCategory((Collider::ColliderShape)i) != CONVEX)
+			continue;
+		for(int j = i; j < NUM_SHAPES; ++j)
+		{
+			if(GetCategory((Collider::ColliderShape)j) != CONVEX)
+				continue;
+			Collider::ColliderShape shapeA = (Collider::ColliderShape)i, shapeB = (Collider::ColliderShape)j;
+			std::string pair = std::string(GetName(shapeA)) + "-" + GetName(shapeB);
+			for(int regime = 0; regime < NUM_REGIMES; ++regime)
+				PrintRow(out, pair, (Regime)regime, Measure(shapeA, shapeB, (Regime)regime, &CollisionTests::GJKCollision));
+		}
+	}
+
+	fprintf(out, "\nPairs with no Contacts while penetrating:");
+	if(silent.empty())
+		fprintf(out, " none");
+	for(unsigned int i = 0; i < silent.size(); ++i)
+		fprintf(out, "%s %s", i > 0 ? "," : "", silent[i].c_str());
+	fprintf(out, "\n");
+}
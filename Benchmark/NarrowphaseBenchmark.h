@@ -0,0 +1,67 @@
+#pragma once
+#include "Collider.h"
+#include "CollisionTests.h"
+#include "Contacts\ContactStream.h"
+#include <stdio.h>
+#include <random>
+#include <vector>
+#include <string>
+
+using namespace Glade;
+
+// Times every Collision Test in CollisionTests' table, and GJK/EPA on every pair of convex shapes, from many random poses
+// Each pair is posed three ways: separated, grazing (barely touching) and deeply penetrating. Pairs that return no
+// Contacts while penetrating are listed at the end, since they are missing a test rather than just slow. Contacts a test
+// counts without filling in don't count, so tests that only report a hit are listed too
+class NarrowphaseBenchmark
+{
+public:
+	// 'posesPerRegime' random poses per pair and regime, each one tested 'callsPerPose' times in a row
+	NarrowphaseBenchmark(unsigned int posesPerRegime=64, unsigned int callsPerPose=256, unsigned int seed=1);
+
+	// Run everything, printing a table to 'out'
+	void Run(FILE* out);
+
+private:
+	enum Regime { SEPARATED=0, GRAZING=1, PENETRATING=2, NUM_REGIMES=3 };
+
+	struct Result
+	{
+		double	nsPerCall;
+		double	contactsPerCall;	// Only the ones filled in
+		double	zeroFraction;		// Fraction of poses with no Contacts
+		double	gjkIterations;		// Per call, 0 if the test doesn't use GJK
+		double	epaIterations;
+		bool	measured;			// False if the regime doesn't apply to the pair
+	};
+
+	// Shapes the Colliders can be placed by. Planes and surfaces (TriangleMesh, HeightField) don't move
+	enum Category { CONVEX, PLANE, SURFACE };
+	static Category GetCategory(Collider::ColliderShape shape);
+	static const char* GetName(Collider::ColliderShape shape);
+
+	// New Collider of 'shape', posed by 'transform'. Planes are through the origin along 'planeNormal', 'planeD' from it
+	Collider* MakeCollider(Collider::ColliderShape shape, const Matrix& transform, const Vector& planeNormal=Vector(0,1,0), gFloat planeD=gFloat(0.0f));
+	// Random pose of a pair for 'regime'. Returns false (and no Colliders) if the regime doesn't apply to the pair
+	bool MakePair(Collider::ColliderShape shapeA, Collider::ColliderShape shapeB, Regime regime, Collider*& a, Collider*& b);
+	// Distance 'a' and 'b' can be moved apart along 'dir' before they stop touching, found with GJKDistance
+	gFloat TouchingDistance(Collider::ColliderShape shapeA, const Matrix& aTransform, Collider::ColliderShape shapeB, const Matrix& bRotation, const Vector& dir);
+	// Radius of a sphere around Collider of 'shape'
+	static gFloat GetSize(Collider::ColliderShape shape);
+
+	Result Measure(Collider::ColliderShape shapeA, Collider::ColliderShape shapeB, Regime regime, CollisionTests::Kernel test);
+	void PrintRow(FILE* out, const std::string& pair, Regime regime, const Result& r);
+
+	Quaternion	RandomOrientation();
+	Vector		RandomDirection();
+
+	unsigned int	posesPerRegime;
+	unsigned int	callsPerPose;
+	std::mt19937	random;
+
+	SmartPointer<PhysicMaterial>	material;
+	SmartPointer<TriangleMesh>		triangleMesh;
+	SmartPointer<HeightField>		heightField;
+	SmartPointer<ConvexHull>		convexHull;
+	std::vector<Vector>				meshVertices;		// MeshCollider
+};
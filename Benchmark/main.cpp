@@ -0,0 +1,18 @@
+#include "NarrowphaseBenchmark.h"
+#include "Checks.h"
+#include <stdlib.h>
+
+// Usage: Benchmark [posesPerRegime] [callsPerPose] [seed]
+// Returns 1 if any of the correctness checks run before the timings failed
+int main(int argc, char* argv[])
+{
+	unsigned int poses = argc > 1 ? (unsigned int)atoi(argv[1]) : 64;
+	unsigned int calls = argc > 2 ? (unsigned int)atoi(argv[2]) : 256;
+	unsigned int seed = argc > 3 ? (unsigned int)atoi(argv[3]) : 1;
+
+	bool passed = Checks::Run(stdout);
+
+	NarrowphaseBenchmark benchmark(poses, calls, seed);
+	benchmark.Run(stdout);
+	return passed ? 0 : 1;
+}
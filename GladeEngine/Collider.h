@@ -10,6 +10,15 @@
 #include "Math\Matrix.h"
 #endif
 #include "Math\AABB.h"
+#ifndef GLADE_TRIANGLE_MESH_H
+#include "TriangleMesh.h"
+#endif
+#ifndef GLADE_HEIGHT_FIELD_H
+#include "HeightField.h"
+#endif
+#ifndef GLADE_CONVEX_HULL_H
+#include "ConvexHull.h"
+#endif
 #include "Utils\SmartPointer\SmartPointer.h"
 #include <vector>
 #include <set>
@@ -30,10 +39,11 @@ namespace Glade {
 */
 class RigidBody;
 class CollisionTests;
+class ColliderUpdateBatch;
 class Collider
 {
 public:
-	enum class ColliderShape { SPHERE=0, BOX=1, CAPSULE=2, CONE=3, CYLINDER=4, PLANE=5, MESH=6 };
+	enum class ColliderShape { SPHERE=0, BOX=1, CAPSULE=2, CONE=3, CYLINDER=4, PLANE=5, MESH=6, TRIANGLE_MESH=7, HEIGHTFIELD=8, CONVEX_HULL=9 };
 
 	Collider(RigidBody* rb, ColliderShape cs, SmartPointer<PhysicMaterial> m, gFloat iMass, Matrix off, int mask) : attachedBody(rb), shape(cs), physicMaterial(m), inverseMass(iMass), offset(off), collisionMask(mask), collisionType(1), enabled(true) 
 #ifdef TRACK_MASS
@@ -44,7 +54,7 @@ public:
 	// Calculate complete transformation matrix for this Collider and pre-computer & save any derived geometric data
 	virtual void CalcTransformAndDerivedGeometricData(Matrix attachedParentTransform) { transform = attachedParentTransform * offset; position = Vector(transform(3,0), transform(3,1), transform(3,2)); }
 
-	// Return point on Collider farthest in direction 'd'
+	// Return point on Collider farthest in direction 'd'. 'd' doesn't have to be unit length
 	// Support function for GJK Collision Detection algorithm
 	virtual Vector GetSupportPoint(const Vector& d) = 0;
 	
@@ -55,9 +65,16 @@ public:
 	// This function returns R^t * d so GetSupportPoint can perform T(S(CalcTransformedDirectionVector(d)))
 	Vector CalcTransformedDirectionVector(const Vector& d) { return transform.Transpose3Times(d); }
 
+	// Convert between world space and this Collider's local space. Assumes the transform doesn't scale
+	Vector ToLocal(const Vector& p) const { return transform.Transpose3Times(p - position); }
+	Vector ToWorld(const Vector& p) const { return transform.Times3(p) + position; }
+
 	// Return ColliderShape of this Collider
 	ColliderShape GetShape() const { return shape; }
 
+	// Whether this Collider is convex and has a GetSupportPoint, so it can be tested with GJK
+	bool IsConvex() const { return shape <= ColliderShape::CYLINDER || shape == ColliderShape::CONVEX_HULL; }
+
 	// Return Mass of this Collider
 	gFloat GetMass() const 
 	{
@@ -86,6 +103,9 @@ public:
 	// Check Collision Mask for specific collision group(s)
 	bool QueryCollisionMask(int m) const { return collisionMask & m; }
 
+	// Return Collision Mask of Collider
+	int GetCollisionMask() const { return collisionMask; }
+
 	// Add collision group(s) to Collision Mask
 	void AddCollisionMask(int m) { collisionMask |= m; }
 
@@ -99,7 +119,7 @@ public:
 	void RemoveCollisionType(int t) { collisionType &= ~t; }
 
 	// Return Collision Type of Collider
-	int GetCollisionType() { return collisionType; }
+	int GetCollisionType() const { return collisionType; }
 
 	// Enable/Disable Collider
 	void Enable() { enabled = true; }
@@ -112,6 +132,7 @@ public:
 //  Vector ClosestPointOnBounds(Vector p);	// return closest point on bounds to p
 
 	friend class CollisionTests;
+	friend class ColliderUpdateBatch;
 
 protected:
 	ColliderShape	shape;
@@ -142,6 +163,7 @@ public:
 		inertiaTensor = Matrix::SphereInertiaTensor((gFloat)1.0f / iMass, rad);
 	}
 	friend class CollisionTests;
+	friend class ColliderUpdateBatch;
 
 	void CalcTransformAndDerivedGeometricData(Matrix attachedParentTransform)
 	{
@@ -157,7 +179,7 @@ public:
 
 	Vector GetSupportPoint(const Vector& d)
 	{
-		return (d * radius) + position;
+		return (d.Normalized() * radius) + position;
 	}
 
 protected:
@@ -175,45 +197,33 @@ public:
 			inertiaTensor = Matrix::CuboidInertiaTensor((gFloat)1.0f / iMass, halfW*(gFloat)2.0f);
 	}
 	friend class CollisionTests;
+	friend class ColliderUpdateBatch;
 
 	void CalcTransformAndDerivedGeometricData(Matrix attachedParentTransform)
 	{
 		Collider::CalcTransformAndDerivedGeometricData(attachedParentTransform);
 
-		// Calc local x-, y-, z- axes of Box Collider
+		CalcAxes();
+
+		// Calc AABB from how far the OOBB reaches along each world axis: |u| * halfWidths
+		Vector extents(Abs(u[0].x) * halfWidths.x + Abs(u[1].x) * halfWidths.y + Abs(u[2].x) * halfWidths.z,
+					   Abs(u[0].y) * halfWidths.x + Abs(u[1].y) * halfWidths.y + Abs(u[2].y) * halfWidths.z,
+					   Abs(u[0].z) * halfWidths.x + Abs(u[1].z) * halfWidths.y + Abs(u[2].z) * halfWidths.z);
+		bounds.maximum = position + extents;
+		bounds.minimum = position - extents;
+	}
+
+	// Calc local x-, y-, z- axes of Box Collider
+	void CalcAxes()
+	{
 		u[0] = Vector(transform(0,0), transform(0,1), transform(0,2));
 		u[1] = Vector(transform(1,0), transform(1,1), transform(1,2));
 		u[2] = Vector(transform(2,0), transform(2,1), transform(2,2));
 		if(Abs(u[0].SquaredMagnitude() - 1) > EPSILON) u[0].NormalizeInPlace();
 		if(Abs(u[1].SquaredMagnitude() - 1) > EPSILON) u[1].NormalizeInPlace();
 		if(Abs(u[2].SquaredMagnitude() - 1) > EPSILON) u[2].NormalizeInPlace();
-
-		// Calculate vertices of OOBB
-		Vector vertices[8] = {
-			u[0]*halfWidths.x + u[1]*halfWidths.y + u[2]*halfWidths.z + position,
-			u[0]*halfWidths.x + u[1]*halfWidths.y + u[2]*-halfWidths.z + position,
-			u[0]*halfWidths.x + u[1]*-halfWidths.y + u[2]*halfWidths.z + position,
-			u[0]*halfWidths.x + u[1]*-halfWidths.y + u[2]*-halfWidths.z + position,
-			u[0]*-halfWidths.x + u[1]*halfWidths.y + u[2]*halfWidths.z + position,
-			u[0]*-halfWidths.x + u[1]*halfWidths.y + u[2]*-halfWidths.z + position,
-			u[0]*-halfWidths.x + u[1]*-halfWidths.y + u[2]*halfWidths.z + position,
-			u[0]*-halfWidths.x + u[1]*-halfWidths.y + u[2]*-halfWidths.z + position,
-		};
-
-		// Calc AABB from OOBB vertices
-		bounds.maximum = vertices[0]; bounds.minimum = vertices[7];
-		for(unsigned int i = 0; i < 8; ++i)
-		{
-			if(vertices[i].x > bounds.maximum.x) bounds.maximum.x = vertices[i].x;
-			else if(vertices[i].x < bounds.minimum.x) bounds.minimum.x = vertices[i].x;
-			if(vertices[i].y > bounds.maximum.y) bounds.maximum.y = vertices[i].y;
-			else if(vertices[i].y < bounds.minimum.y) bounds.minimum.y = vertices[i].y;
-			if(vertices[i].z > bounds.maximum.z) bounds.maximum.z = vertices[i].z;
-			else if(vertices[i].z < bounds.minimum.z) bounds.minimum.z = vertices[i].z;
-		}
 	}
 
-
 	Vector GetSupportPoint(const Vector& d)
 	{
 		Vector dir = CalcTransformedDirectionVector(d);
@@ -264,12 +274,13 @@ public:
 
 	Vector GetSupportPoint(const Vector& d)
 	{
+		// 'p' and 'q' are already in world space, so only the side of the axis is picked in local space
 		Vector dir = CalcTransformedDirectionVector(d);
-		Vector r = dir * radius;
+		Vector r = d.Normalized() * radius;
 		if(dir.y > gFloat(0.0f))
-			return r + p;
-		if(dir.y < gFloat(0.0f))
 			return r + q;
+		if(dir.y < gFloat(0.0f))
+			return r + p;
 		return r + position;
 	}
 protected:
@@ -475,6 +486,120 @@ protected:
 	std::set<Vector> vertices;
 };
 
+// Static mesh of triangles, for level geometry that isn't convex or would take too many other Colliders to build
+// Spheres, Boxes and Capsules are tested against it. It should only be attached to RigidBodies with infinite mass
+// The TriangleMesh (and its BVH) can be shared by many Colliders. The transform must not scale
+class TriangleMeshCollider : public Collider
+{
+public:
+	TriangleMeshCollider(RigidBody* rb, SmartPointer<PhysicMaterial> m, SmartPointer<TriangleMesh> tm, Matrix offset=Matrix(), int mask=1) : Collider(rb, ColliderShape::TRIANGLE_MESH, m, 0, offset, mask), mesh(tm) { }
+	friend class CollisionTests;
+
+	void CalcTransformAndDerivedGeometricData(Matrix attachedParentTransform)
+	{
+		Collider::CalcTransformAndDerivedGeometricData(attachedParentTransform);
+
+		// Rotate the mesh's local bounds into an AABB around it in world space
+		const AABB& local = mesh->GetBounds();
+		Vector e = local.GetExtents();
+		Vector center = ToWorld(local.center);
+		Vector extents(Abs(transform(0,0)) * e.x + Abs(transform(1,0)) * e.y + Abs(transform(2,0)) * e.z,
+					   Abs(transform(0,1)) * e.x + Abs(transform(1,1)) * e.y + Abs(transform(2,1)) * e.z,
+					   Abs(transform(0,2)) * e.x + Abs(transform(1,2)) * e.y + Abs(transform(2,2)) * e.z);
+		bounds = AABB(center - extents, center + extents);
+	}
+
+	// Not convex, so there is no support point. Never tested with GJK
+	Vector GetSupportPoint(const Vector& d) { assert(false); return Vector(); }
+
+	SmartPointer<TriangleMesh> GetMesh() const { return mesh; }
+	const TriangleMesh* GetTriangles() const { return mesh.GetPointer(); }
+
+protected:
+	SmartPointer<TriangleMesh> mesh;
+};
+
+// Static terrain. Has no mass, only meant for RigidBodies that never move
+// The heightfield's grid starts at the Collider's origin and runs along its local +x and +z, with +y up
+class HeightFieldCollider : public Collider
+{
+public:
+	HeightFieldCollider(RigidBody* rb, SmartPointer<PhysicMaterial> m, SmartPointer<HeightField> hf, Matrix offset=Matrix(), int mask=1) : Collider(rb, ColliderShape::HEIGHTFIELD, m, 0, offset, mask), field(hf) { }
+	friend class CollisionTests;
+
+	void CalcTransformAndDerivedGeometricData(Matrix attachedParentTransform)
+	{
+		Collider::CalcTransformAndDerivedGeometricData(attachedParentTransform);
+
+		// Rotate the heightfield's local bounds into an AABB around it in world space
+		const AABB& local = field->GetBounds();
+		Vector e = local.GetExtents();
+		Vector center = ToWorld(local.center);
+		Vector extents(Abs(transform(0,0)) * e.x + Abs(transform(1,0)) * e.y + Abs(transform(2,0)) * e.z,
+					   Abs(transform(0,1)) * e.x + Abs(transform(1,1)) * e.y + Abs(transform(2,1)) * e.z,
+					   Abs(transform(0,2)) * e.x + Abs(transform(1,2)) * e.y + Abs(transform(2,2)) * e.z);
+		bounds = AABB(center - extents, center + extents);
+	}
+
+	// Not convex, so there is no support point. Never tested with GJK
+	Vector GetSupportPoint(const Vector& d) { assert(false); return Vector(); }
+
+	SmartPointer<HeightField> GetHeightField() const { return field; }
+	const HeightField* GetTriangles() const { return field.GetPointer(); }
+
+protected:
+	SmartPointer<HeightField> field;
+};
+
+// Convex hull of a cloud of points, for irregular shapes like rocks that would otherwise need a compound of primitives
+// Tested with GJK/EPA like the other convex shapes. The ConvexHull can be shared by many Colliders. The transform must not scale
+// The hull's vertices are relative to its centroid, so they are moved back to where the centroid was among the points
+// before the Collider's usual transform. The offset places the original points like any other Collider
+class ConvexHullCollider : public Collider
+{
+public:
+	ConvexHullCollider(RigidBody* rb, SmartPointer<PhysicMaterial> m, gFloat iMass, SmartPointer<ConvexHull> ch, Matrix offset=Matrix(), int mask=1) : Collider(rb, ColliderShape::CONVEX_HULL, m, iMass, offset, mask), hull(ch)
+	{
+		if(iMass == gFloat(0.0f))
+			inertiaTensor = Matrix::INFINITE_MASS_INERTIA_TENSOR;
+		else
+		{
+			// Move the tensor from the centroid to the Collider's origin with the Parallel Axis Theorem
+			const Vector& c = hull->GetCentroid();
+			inertiaTensor = (hull->GetUnitInertiaTensor() + (Matrix() * c.DotProduct(c)) - c.TensorProduct(c)) * ((gFloat)1.0f / iMass);
+			inertiaTensor(3,3) = gFloat(1.0f);
+		}
+	}
+	friend class CollisionTests;
+
+	void CalcTransformAndDerivedGeometricData(Matrix attachedParentTransform)
+	{
+		Collider::CalcTransformAndDerivedGeometricData(attachedParentTransform);
+		transform = Matrix::MatrixFromTranslation(hull->GetCentroid()) * transform;
+		position = Vector(transform(3,0), transform(3,1), transform(3,2));
+
+		// Support points along each world axis bound the hull exactly
+		for(unsigned int i = 0; i < 3; ++i)
+		{
+			Vector axis;
+			axis[i] = gFloat(1.0f);
+			bounds.maximum[i] = GetSupportPoint(axis)[i];
+			bounds.minimum[i] = GetSupportPoint(-axis)[i];
+		}
+		bounds.CalcCenter();
+	}
+
+	Vector GetSupportPoint(const Vector& d)
+	{
+		return hull->GetVertex(hull->Support(CalcTransformedDirectionVector(d))) * transform;
+	}
+
+	SmartPointer<ConvexHull> GetHull() const { return hull; }
+
+protected:
+	SmartPointer<ConvexHull> hull;
+};
+
 } // namespace Glade
 #endif //GLADE_COLLIDER_H
 
@@ -0,0 +1,61 @@
+#include "ColliderTree.h"
+#include <algorithm>
+
+using namespace Glade;
+
+void ColliderTree::Build(const std::vector<AABB>& bounds)
+{
+	nodes.clear();
+	if(bounds.empty())
+		return;
+
+	std::vector<unsigned int> order(bounds.size());
+	for(unsigned int i = 0; i < order.size(); ++i)
+		order[i] = i;
+
+	nodes.reserve(bounds.size() * 2 - 1);
+	nodes.push_back(Node());
+	BuildNode(0, 0, bounds.size(), order, bounds);
+}
+
+void ColliderTree::BuildNode(unsigned int index, unsigned int start, unsigned int end, std::vector<unsigned int>& order, const std::vector<AABB>& bounds)
+{
+	// Box around every Collider in this node
+	Vector minimum = bounds[order[start]].minimum, maximum = bounds[order[start]].maximum;
+	for(unsigned int i = start + 1; i < end; ++i)
+	{
+		minimum = Vector::VectorMin(minimum, bounds[order[i]].minimum);
+		maximum = Vector::VectorMax(maximum, bounds[order[i]].maximum);
+	}
+	nodes[index].center = (minimum + maximum) * gFloat(0.5f);
+	nodes[index].extents = (maximum - minimum) * gFloat(0.5f);
+
+	// One Collider per leaf
+	if(end - start == 1)
+	{
+		nodes[index].child = -1;
+		nodes[index].collider = order[start];
+		return;
+	}
+
+	// Split at the median Collider center along the node's longest axis
+	// Collider bounds only keep their minimum and maximum up to date, so centers are worked out from those
+	unsigned int axis = 0;
+	const Vector& e = nodes[index].extents;
+	if(e.y > e[axis]) axis = 1;
+	if(e.z > e[axis]) axis = 2;
+
+	unsigned int mid = (start + end) / 2;
+	std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end,
+		[&](unsigned int c1, unsigned int c2) { return bounds[c1].minimum[axis] + bounds[c1].maximum[axis] < bounds[c2].minimum[axis] + bounds[c2].maximum[axis]; });
+
+	// Both children are allocated together so they sit next to each other
+	unsigned int child = nodes.size();
+	nodes.push_back(Node());
+	nodes.push_back(Node());
+	nodes[index].child = child;
+	nodes[index].collider = -1;
+
+	BuildNode(child, start, mid, order, bounds);
+	BuildNode(child + 1, mid, end, order, bounds);
+}
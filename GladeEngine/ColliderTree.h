@@ -0,0 +1,121 @@
+#pragma once
+#ifndef GLADE_COLLIDER_TREE_H
+#define GLADE_COLLIDER_TREE_H
+
+#include "GladeConfig.h"
+#ifndef GLADE_VECTOR_H
+#include "Math\Vector.h"
+#endif
+#ifndef GLADE_MATRIX_H
+#include "Math\Matrix.h"
+#endif
+#include "Math\AABB.h"
+#include "Math\MathMisc.h"
+#include <vector>
+#include <assert.h>
+
+// Most pairs of nodes waiting to be visited while descending two ColliderTrees together
+// Trees are balanced, so this only runs out for RigidBodies with millions of Colliders
+#define COLLIDER_TREE_STACK_SIZE	64
+
+namespace Glade {
+// Bounding Volume Hierarchy over the Colliders of one RigidBody, in the RigidBody's local space
+// Colliders don't move relative to their RigidBody, so the tree is built once when Colliders are added and never refit.
+// Node boxes are brought into world space when tested, which only makes them larger, never misses an overlap.
+// Nodes are split at the median Collider along their longest axis, so every internal node has two children
+class ColliderTree
+{
+public:
+	// Build over a box around each Collider in the RigidBody's local space. Leaves use the same indices as 'bounds'
+	void Build(const std::vector<AABB>& bounds);
+
+	unsigned int GetNumNodes() const { return nodes.size(); }
+	// Box of node 'i' in local space. The root is node 0 and its children are nodes 1 and 2
+	void GetNodeBox(unsigned int i, Vector& center, Vector& extents) const { center = nodes[i].center; extents = nodes[i].extents; }
+
+	// Call 'callback(i, j)' for every Collider 'i' of 'a' and 'j' of 'b' whose boxes are within 'margin' of each other
+	// once moved by each RigidBody's transform. 'callback' returns false to stop early, and so does QueryPair.
+	// The roots themselves aren't tested, BroadPhase already found the RigidBodies' boxes overlapping
+	template<class F> static bool QueryPair(const ColliderTree& a, const Matrix& aTransform, const ColliderTree& b, const Matrix& bTransform,
+											gFloat margin, F callback);
+
+private:
+	struct Node
+	{
+		Vector	center;		// Box in local space
+		Vector	extents;
+		int		child;		// Internal: index of first child, the second is right after it. Leaf: -1
+		int		collider;	// Leaf: index of Collider. Internal: -1
+	};
+
+	void BuildNode(unsigned int index, unsigned int start, unsigned int end, std::vector<unsigned int>& order, const std::vector<AABB>& bounds);
+
+	// Move a node's box into world space
+	static inline void ToWorld(const Node& n, const Matrix& transform, Vector& center, Vector& extents)
+	{
+		center = n.center * transform;
+		const Vector& e = n.extents;
+		extents = Vector(Abs(transform(0,0)) * e.x + Abs(transform(1,0)) * e.y + Abs(transform(2,0)) * e.z,
+						 Abs(transform(0,1)) * e.x + Abs(transform(1,1)) * e.y + Abs(transform(2,1)) * e.z,
+						 Abs(transform(0,2)) * e.x + Abs(transform(1,2)) * e.y + Abs(transform(2,2)) * e.z);
+	}
+
+	std::vector<Node>	nodes;		// Root is node 0
+};
+
+template<class F> bool ColliderTree::QueryPair(const ColliderTree& a, const Matrix& aTransform, const ColliderTree& b, const Matrix& bTransform,
+											   gFloat margin, F callback)
+{
+	if(a.nodes.empty() || b.nodes.empty())
+		return true;
+
+	unsigned int stack[COLLIDER_TREE_STACK_SIZE][2];
+	unsigned int size = 0;
+	Vector aCenter, aExtents, bCenter, bExtents;
+
+	// Start as if the roots had already been found overlapping
+	stack[size][0] = 0;
+	stack[size][1] = 0;
+	++size;
+	bool tested = false;
+
+	while(size > 0)
+	{
+		--size;
+		unsigned int iA = stack[size][0], iB = stack[size][1];
+		const Node& nA = a.nodes[iA];
+		const Node& nB = b.nodes[iB];
+
+		if(tested)
+		{
+			ToWorld(nA, aTransform, aCenter, aExtents);
+			ToWorld(nB, bTransform, bCenter, bExtents);
+			if(Abs(aCenter.x - bCenter.x) > aExtents.x + bExtents.x + margin ||
+			   Abs(aCenter.y - bCenter.y) > aExtents.y + bExtents.y + margin ||
+			   Abs(aCenter.z - bCenter.z) > aExtents.z + bExtents.z + margin)
+				continue;
+		}
+		tested = true;
+
+		if(nA.child < 0 && nB.child < 0)
+		{
+			if(!callback((unsigned int)nA.collider, (unsigned int)nB.collider))
+				return false;
+			continue;
+		}
+
+		// Descend into the larger node (or the only one with children)
+		assert(size + 2 <= COLLIDER_TREE_STACK_SIZE);
+		bool descendA = nB.child < 0 || (nA.child >= 0 && nA.extents.SquaredMagnitude() > nB.extents.SquaredMagnitude());
+		for(int i = 0; i < 2; ++i)
+		{
+			stack[size][0] = descendA ? nA.child + i : iA;
+			stack[size][1] = descendA ? iB : nB.child + i;
+			++size;
+		}
+	}
+
+	return true;
+}
+}	// namespace
+#endif	// GLADE_COLLIDER_TREE_H
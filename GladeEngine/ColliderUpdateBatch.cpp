@@ -0,0 +1,224 @@
+#include "ColliderUpdateBatch.h"
+#include "RigidBody.h"
+#include "Collider.h"
+#include "Math\SIMD.h"
+#include "Math\MathMisc.h"
+#include <cmath>
+
+using namespace Glade;
+
+void ColliderUpdateBatch::ShapeArrays::Clear()
+{
+	colliders.clear();
+	for(unsigned int k = 0; k < 12; ++k)
+	{
+		parent[k].clear();
+		offset[k].clear();
+	}
+	hx.clear(); hy.clear(); hz.clear();
+}
+
+void ColliderUpdateBatch::ShapeArrays::Add(Collider* c, const Matrix& p, const Matrix& o)
+{
+	colliders.push_back(c);
+	for(unsigned int r = 0; r < 4; ++r)
+	{
+		for(unsigned int col = 0; col < 3; ++col)
+		{
+			parent[r * 3 + col].push_back(p(r, col));
+			offset[r * 3 + col].push_back(o(r, col));
+		}
+	}
+}
+
+void ColliderUpdateBatch::Clear()
+{
+	bodies.clear();
+	spheres.Clear();
+	boxes.Clear();
+	others.clear();
+	otherBodies.clear();
+}
+
+void ColliderUpdateBatch::Add(RigidBody* body)
+{
+	bodies.push_back(body);
+	Matrix transform = body->GetTransformMatrix();
+	const std::vector<Collider*>& colliders = body->GetColliders();
+	for(unsigned int i = 0; i < colliders.size(); ++i)
+	{
+		Collider* c = colliders[i];
+		switch(c->GetShape())
+		{
+		case Collider::ColliderShape::SPHERE:
+			spheres.Add(c, transform, c->offset);
+			break;
+		case Collider::ColliderShape::BOX:
+			{
+				const Vector& h = static_cast<BoxCollider*>(c)->halfWidths;
+				boxes.Add(c, transform, c->offset);
+				boxes.hx.push_back(float(h.x));
+				boxes.hy.push_back(float(h.y));
+				boxes.hz.push_back(float(h.z));
+			}
+			break;
+		default:
+			others.push_back(c);
+			otherBodies.push_back(body);
+			break;
+		}
+	}
+}
+
+void ColliderUpdateBatch::Run(WorkerPool& pool)
+{
+	for(unsigned int k = 0; k < 12; ++k)
+	{
+		spheres.transform[k].resize(spheres.GetSize());
+		boxes.transform[k].resize(boxes.GetSize());
+	}
+	boxes.ex.resize(boxes.GetSize()); boxes.ey.resize(boxes.GetSize()); boxes.ez.resize(boxes.GetSize());
+
+	// Too little work to be worth splitting up - move everything on this thread
+	unsigned int numChunks = pool.GetNumThreads();
+	if(spheres.GetSize() + boxes.GetSize() + others.size() < MIN_PARALLEL_COLLIDER_UPDATE)
+		numChunks = 1;
+
+	// Each chunk takes the same share of every shape. Shares are whole registers, so only the last chunk has a scalar tail
+	auto range = [numChunks](unsigned int size, unsigned int c, unsigned int& start, unsigned int& end)
+	{
+		unsigned int share = (size + numChunks - 1) / numChunks;
+		share = (share + 3) & ~3u;
+		start = Min(c * share, size);
+		end = Min(start + share, size);
+	};
+	auto moveColliders = [&](unsigned int c)
+	{
+		unsigned int start, end;
+		range(spheres.GetSize(), c, start, end);
+		CalcTransforms(spheres, start, end, false);
+		WriteSpheres(start, end);
+
+		range(boxes.GetSize(), c, start, end);
+		CalcTransforms(boxes, start, end, true);
+		WriteBoxes(start, end);
+
+		range(others.size(), c, start, end);
+		for(unsigned int i = start; i < end; ++i)
+			others[i]->CalcTransformAndDerivedGeometricData(otherBodies[i]->GetTransformMatrix());
+	};
+
+	// RigidBody AABBs need all of their Colliders moved first, wherever they were in the arrays
+	auto finishBodies = [&](unsigned int c)
+	{
+		unsigned int start, end;
+		range(bodies.size(), c, start, end);
+		for(unsigned int i = start; i < end; ++i)
+			bodies[i]->FinishUpdate();
+	};
+
+	if(numChunks == 1)
+	{
+		moveColliders(0);
+		finishBodies(0);
+		return;
+	}
+	pool.ParallelFor(numChunks, moveColliders);
+	pool.ParallelFor(numChunks, finishBodies);
+}
+
+void ColliderUpdateBatch::CalcTransforms(ShapeArrays& a, unsigned int start, unsigned int end, bool boxes)
+{
+	// transform = parent * offset. With the last columns (0, 0, 0, 1), every row is the parent's row times the offset's
+	// rotation, and the translation row also adds the offset's translation
+	unsigned int i = start;
+#ifdef GLADE_SSE2
+	fLanes p[12], o[12], t[12];
+	for(; i + F_LANE_COUNT <= end; i += F_LANE_COUNT)
+	{
+		for(unsigned int k = 0; k < 12; ++k)
+		{
+			p[k] = FLanesLoad(&a.parent[k][i]);
+			o[k] = FLanesLoad(&a.offset[k][i]);
+		}
+		for(unsigned int r = 0; r < 4; ++r)
+		{
+			for(unsigned int c = 0; c < 3; ++c)
+			{
+				t[r * 3 + c] = FLanesAdd(FLanesAdd(FLanesMul(p[r * 3], o[c]), FLanesMul(p[r * 3 + 1], o[3 + c])), FLanesMul(p[r * 3 + 2], o[6 + c]));
+				if(r == 3)
+					t[r * 3 + c] = FLanesAdd(t[r * 3 + c], o[9 + c]);
+				FLanesStore(&a.transform[r * 3 + c][i], t[r * 3 + c]);
+			}
+		}
+
+		// Each world axis gets the halfwidths along it of the Box's 3 axes (rows 0-2)
+		if(boxes)
+		{
+			fLanes hx = FLanesLoad(&a.hx[i]), hy = FLanesLoad(&a.hy[i]), hz = FLanesLoad(&a.hz[i]);
+			FLanesStore(&a.ex[i], FLanesAdd(FLanesAdd(FLanesMul(FLanesAbs(t[0]), hx), FLanesMul(FLanesAbs(t[3]), hy)), FLanesMul(FLanesAbs(t[6]), hz)));
+			FLanesStore(&a.ey[i], FLanesAdd(FLanesAdd(FLanesMul(FLanesAbs(t[1]), hx), FLanesMul(FLanesAbs(t[4]), hy)), FLanesMul(FLanesAbs(t[7]), hz)));
+			FLanesStore(&a.ez[i], FLanesAdd(FLanesAdd(FLanesMul(FLanesAbs(t[2]), hx), FLanesMul(FLanesAbs(t[5]), hy)), FLanesMul(FLanesAbs(t[8]), hz)));
+		}
+	}
+#endif
+
+	// Colliders that don't fill a whole register (or every Collider without SIMD)
+	float ts[12];
+	for(; i < end; ++i)
+	{
+		for(unsigned int r = 0; r < 4; ++r)
+		{
+			for(unsigned int c = 0; c < 3; ++c)
+			{
+				ts[r * 3 + c] = a.parent[r * 3][i] * a.offset[c][i] + a.parent[r * 3 + 1][i] * a.offset[3 + c][i] + a.parent[r * 3 + 2][i] * a.offset[6 + c][i];
+				if(r == 3)
+					ts[r * 3 + c] += a.offset[9 + c][i];
+				a.transform[r * 3 + c][i] = ts[r * 3 + c];
+			}
+		}
+
+		if(boxes)
+		{
+			a.ex[i] = std::abs(ts[0]) * a.hx[i] + std::abs(ts[3]) * a.hy[i] + std::abs(ts[6]) * a.hz[i];
+			a.ey[i] = std::abs(ts[1]) * a.hx[i] + std::abs(ts[4]) * a.hy[i] + std::abs(ts[7]) * a.hz[i];
+			a.ez[i] = std::abs(ts[2]) * a.hx[i] + std::abs(ts[5]) * a.hy[i] + std::abs(ts[8]) * a.hz[i];
+		}
+	}
+}
+
+void ColliderUpdateBatch::WriteTransform(Collider* c, const ShapeArrays& a, unsigned int i)
+{
+	for(unsigned int r = 0; r < 4; ++r)
+	{
+		for(unsigned int col = 0; col < 3; ++col)
+			c->transform(r, col) = a.transform[r * 3 + col][i];
+		c->transform(r, 3) = r == 3 ? 1.0f : 0.0f;
+	}
+	c->position = Vector(c->transform(3,0), c->transform(3,1), c->transform(3,2));
+}
+
+void ColliderUpdateBatch::WriteSpheres(unsigned int start, unsigned int end)
+{
+	for(unsigned int i = start; i < end; ++i)
+	{
+		SphereCollider* s = static_cast<SphereCollider*>(spheres.colliders[i]);
+		WriteTransform(s, spheres, i);
+		Vector radiusVec(s->radius, s->radius, s->radius);
+		s->bounds.maximum = s->position + radiusVec;
+		s->bounds.minimum = s->position - radiusVec;
+	}
+}
+
+void ColliderUpdateBatch::WriteBoxes(unsigned int start, unsigned int end)
+{
+	for(unsigned int i = start; i < end; ++i)
+	{
+		BoxCollider* b = static_cast<BoxCollider*>(boxes.colliders[i]);
+		WriteTransform(b, boxes, i);
+		b->CalcAxes();
+		Vector extents(boxes.ex[i], boxes.ey[i], boxes.ez[i]);
+		b->bounds.maximum = b->position + extents;
+		b->bounds.minimum = b->position - extents;
+	}
+}
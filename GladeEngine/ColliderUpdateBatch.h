@@ -0,0 +1,64 @@
+#pragma once
+#ifndef GLADE_COLLIDER_UPDATE_BATCH_H
+#define GLADE_COLLIDER_UPDATE_BATCH_H
+
+#include "GladeConfig.h"
+#ifndef GLADE_MATRIX_H
+#include "Math\Matrix.h"
+#endif
+#include "System\Threads\WorkerPool.h"
+#include <vector>
+
+// Fewest Colliders worth splitting across worker threads
+#define MIN_PARALLEL_COLLIDER_UPDATE	256
+
+namespace Glade {
+class Collider;
+class RigidBody;
+
+// Moves the Colliders of every RigidBody that moved this step together, instead of one RigidBody at a time
+// Spheres and Boxes are gathered by shape, each value in its own array, so their world transforms (and Box AABB
+// extents, |R| * halfWidths) are calculated several Colliders at a time with SIMD. Matrices are stored as floats,
+// so the arrays are too, and 4 Colliders fit in a register whatever gFloat is.
+// Every other shape is moved through CalcTransformAndDerivedGeometricData. Work is split across a WorkerPool
+class ColliderUpdateBatch
+{
+public:
+	void Clear();
+	// Gather the Colliders of 'body', which has its new transform but hasn't moved its Colliders (RigidBody::Update(false))
+	void Add(RigidBody* body);
+	// Move every gathered Collider, then recalculate each RigidBody's AABB (RigidBody::FinishUpdate)
+	void Run(WorkerPool& pool);
+
+private:
+	// Colliders of one shape. Transforms are kept as rows 0-3 of columns 0-2, the last column is always (0, 0, 0, 1)
+	struct ShapeArrays
+	{
+		void Clear();
+		void Add(Collider* c, const Matrix& parent, const Matrix& offset);
+		unsigned int GetSize() const { return colliders.size(); }
+
+		std::vector<Collider*>	colliders;
+		std::vector<float>		parent[12];		// Attached RigidBody's transform
+		std::vector<float>		offset[12];		// Collider's offset from it
+		std::vector<float>		hx, hy, hz;		// Box halfwidths
+
+		// Results
+		std::vector<float>		transform[12];
+		std::vector<float>		ex, ey, ez;		// Box AABB extents
+	};
+
+	// Calculate transforms (and extents if 'boxes') of Colliders [start, end) of 'a'
+	static void CalcTransforms(ShapeArrays& a, unsigned int start, unsigned int end, bool boxes);
+	// Copy results of Colliders [start, end) back to the Colliders
+	static void WriteTransform(Collider* c, const ShapeArrays& a, unsigned int i);
+	void WriteSpheres(unsigned int start, unsigned int end);
+	void WriteBoxes(unsigned int start, unsigned int end);
+
+	std::vector<RigidBody*>	bodies;
+	ShapeArrays				spheres, boxes;
+	std::vector<Collider*>	others;			// Every other shape
+	std::vector<RigidBody*>	otherBodies;	// RigidBody each of 'others' is attached to
+};
+}	// namespace
+#endif	// GLADE_COLLIDER_UPDATE_BATCH_H
@@ -1,33 +1,378 @@
 ﻿#include "CollisionTests.h"
+#include "Math\SIMD.h"
 
 using namespace Glade;
 
-const CollisionTests::FP CollisionTests::Tests[28] = {
-	&CollisionTests::SphereSphereTest, &CollisionTests::SphereBoxTest, &CollisionTests::SphereCapsuleTest, &CollisionTests::SphereCylinderTest,	&CollisionTests::SphereConeTest, &CollisionTests::SpherePlaneTest, &CollisionTests::GJKTest, 
-	&CollisionTests::BoxBoxTest, &CollisionTests::GJKTest, &CollisionTests::GJKTest, &CollisionTests::GJKTest, &CollisionTests::BoxPlaneTest, &CollisionTests::GJKTest, 
-	&CollisionTests::CapsuleCapsuleTest, &CollisionTests::GJKTest, &CollisionTests::GJKTest, &CollisionTests::CapsulePlaneTest, &CollisionTests::GJKTest,
-	&CollisionTests::GJKTest, &CollisionTests::GJKTest, &CollisionTests::CylinderPlaneTest, &CollisionTests::GJKTest, 
-	&CollisionTests::GJKTest, &CollisionTests::ConePlaneTest, &CollisionTests::GJKTest,  
-	&CollisionTests::PlanePlaneTest, &CollisionTests::GJKTest, 
-	&CollisionTests::GJKTest
-	};
+// Concrete Collider type for each shape
+template<Collider::ColliderShape S> struct ColliderType;
+template<> struct ColliderType<Collider::ColliderShape::SPHERE>		{ typedef SphereCollider Type; };
+template<> struct ColliderType<Collider::ColliderShape::BOX>		{ typedef BoxCollider Type; };
+template<> struct ColliderType<Collider::ColliderShape::CAPSULE>	{ typedef CapsuleCollider Type; };
+template<> struct ColliderType<Collider::ColliderShape::CONE>		{ typedef ConeCollider Type; };
+template<> struct ColliderType<Collider::ColliderShape::CYLINDER>	{ typedef CylinderCollider Type; };
+template<> struct ColliderType<Collider::ColliderShape::PLANE>		{ typedef PlaneCollider Type; };
+template<> struct ColliderType<Collider::ColliderShape::MESH>		{ typedef MeshCollider Type; };
+template<> struct ColliderType<Collider::ColliderShape::TRIANGLE_MESH>	{ typedef TriangleMeshCollider Type; };
+template<> struct ColliderType<Collider::ColliderShape::HEIGHTFIELD>	{ typedef HeightFieldCollider Type; };
+template<> struct ColliderType<Collider::ColliderShape::CONVEX_HULL>	{ typedef ConvexHullCollider Type; };
+
+// Pairs without their own Collision Test use GJK
+// GJK/EPA iterates over support points and can expand a polytope - by far the most expensive
+template<Collider::ColliderShape A, Collider::ColliderShape B> struct CollisionTests::PairTest
+{
+	static const unsigned int cost = 16;
+	static inline int Test(Collider* _a, Collider* _b, Contact* contacts, CollisionWarmStart* warmStart)
+	{
+		return GJKTest(static_cast<typename ColliderType<A>::Type*>(_a), static_cast<typename ColliderType<B>::Type*>(_b), contacts, warmStart);
+	}
+};
+
+// Pairs with their own Collision Test
+#define PAIR_TEST(A, B, c, test)																		\
+template<> struct CollisionTests::PairTest<Collider::ColliderShape::A, Collider::ColliderShape::B>		\
+{																										\
+	static const unsigned int cost = c;																	\
+	static inline int Test(Collider* _a, Collider* _b, Contact* contacts, CollisionWarmStart* warmStart)	\
+	{																									\
+		return test;																					\
+	}																									\
+};
+PAIR_TEST(SPHERE,	SPHERE,		1, SphereSphereTest(_a, _b, contacts))
+PAIR_TEST(SPHERE,	BOX,		1, SphereBoxTest(_a, _b, contacts))
+PAIR_TEST(SPHERE,	CAPSULE,	1, SphereCapsuleTest(_a, _b, contacts))
+PAIR_TEST(SPHERE,	CONE,		1, SphereConeTest(_a, _b, contacts))
+PAIR_TEST(SPHERE,	CYLINDER,	1, SphereCylinderTest(_a, _b, contacts))
+PAIR_TEST(SPHERE,	PLANE,		1, SpherePlaneTest(_a, _b, contacts))
+PAIR_TEST(BOX,		BOX,		4, BoxBoxTest(_a, _b, contacts, warmStart))
+PAIR_TEST(BOX,		PLANE,		1, BoxPlaneTest(_a, _b, contacts))
+PAIR_TEST(CAPSULE,	CAPSULE,	1, CapsuleCapsuleTest(_a, _b, contacts))
+PAIR_TEST(CAPSULE,	PLANE,		1, CapsulePlaneTest(_a, _b, contacts))
+PAIR_TEST(CONE,		PLANE,		1, ConePlaneTest(_a, _b, contacts))
+PAIR_TEST(CYLINDER,	PLANE,		1, CylinderPlaneTest(_a, _b, contacts))
+PAIR_TEST(PLANE,	PLANE,		1, PlanePlaneTest(_a, _b, contacts))
+PAIR_TEST(PLANE,	MESH,		4, PlaneMeshTest(_a, _b, contacts))
+PAIR_TEST(PLANE,	CONVEX_HULL,	4, PlaneConvexHullTest(_a, _b, contacts))
+PAIR_TEST(SPHERE,	TRIANGLE_MESH,	4, SphereTrianglesTest(_a, _b, static_cast<TriangleMeshCollider*>(_b)->GetTriangles(), contacts))
+PAIR_TEST(BOX,		TRIANGLE_MESH,	8, BoxTrianglesTest(_a, _b, static_cast<TriangleMeshCollider*>(_b)->GetTriangles(), contacts))
+PAIR_TEST(CAPSULE,	TRIANGLE_MESH,	6, CapsuleTrianglesTest(_a, _b, static_cast<TriangleMeshCollider*>(_b)->GetTriangles(), contacts))
+PAIR_TEST(SPHERE,	HEIGHTFIELD,	4, SphereTrianglesTest(_a, _b, static_cast<HeightFieldCollider*>(_b)->GetTriangles(), contacts))
+PAIR_TEST(BOX,		HEIGHTFIELD,	8, BoxTrianglesTest(_a, _b, static_cast<HeightFieldCollider*>(_b)->GetTriangles(), contacts))
+PAIR_TEST(CAPSULE,	HEIGHTFIELD,	6, CapsuleTrianglesTest(_a, _b, static_cast<HeightFieldCollider*>(_b)->GetTriangles(), contacts))
+// TriangleMeshes and HeightFields are not convex and have no support point for GJK
+// Pairs of them with each other or a Plane are never tested, as neither side can move
+PAIR_TEST(PLANE,	TRIANGLE_MESH,	0, 0)
+PAIR_TEST(TRIANGLE_MESH, TRIANGLE_MESH, 0, 0)
+PAIR_TEST(PLANE,	HEIGHTFIELD,	0, 0)
+PAIR_TEST(TRIANGLE_MESH, HEIGHTFIELD, 0, 0)
+PAIR_TEST(HEIGHTFIELD, HEIGHTFIELD,	0, 0)
+// Shapes that can move but have no test against them pass straight through. Count every test so it can be
+// found with GetUnsupportedTestCount
+#define PAIR_UNSUPPORTED(A, B)																			\
+template<> struct CollisionTests::PairTest<Collider::ColliderShape::A, Collider::ColliderShape::B>		\
+{																										\
+	static const unsigned int cost = 0;																	\
+	static inline int Test(Collider* _a, Collider* _b, Contact* contacts, CollisionWarmStart* warmStart)	\
+	{																									\
+		++UnsupportedTests[(int)Collider::ColliderShape::A][(int)Collider::ColliderShape::B];				\
+		return 0;																						\
+	}																									\
+};
+PAIR_UNSUPPORTED(CONE,		TRIANGLE_MESH)
+PAIR_UNSUPPORTED(CYLINDER,	TRIANGLE_MESH)
+PAIR_UNSUPPORTED(MESH,		TRIANGLE_MESH)
+PAIR_UNSUPPORTED(CONE,		HEIGHTFIELD)
+PAIR_UNSUPPORTED(CYLINDER,	HEIGHTFIELD)
+PAIR_UNSUPPORTED(MESH,		HEIGHTFIELD)
+PAIR_UNSUPPORTED(TRIANGLE_MESH, CONVEX_HULL)
+PAIR_UNSUPPORTED(HEIGHTFIELD, CONVEX_HULL)
+#undef PAIR_UNSUPPORTED
+#undef PAIR_TEST
+
+template<Collider::ColliderShape A, Collider::ColliderShape B>
+struct CollisionTests::OrderedPairTest<A, B, true>
+{
+	static const unsigned int cost = PairTest<A, B>::cost;
+	static inline int Test(Collider* _a, Collider* _b, Contact* contacts, CollisionWarmStart* warmStart)	{ return PairTest<A, B>::Test(_a, _b, contacts, warmStart); }
+};
+template<Collider::ColliderShape A, Collider::ColliderShape B>
+struct CollisionTests::OrderedPairTest<A, B, false>
+{
+	static const unsigned int cost = PairTest<B, A>::cost;
+	static inline int Test(Collider* _a, Collider* _b, Contact* contacts, CollisionWarmStart* warmStart)	{ return PairTest<B, A>::Test(_b, _a, contacts, warmStart); }
+};
+
+template<Collider::ColliderShape A, Collider::ColliderShape B>
+int CollisionTests::PairKernel(Collider* _a, Collider* _b, Contact* contacts, CollisionWarmStart* warmStart)
+{
+	return OrderedPairTest<A, B>::Test(_a, _b, contacts, warmStart);
+}
 
-const int CollisionTests::helperIndices[7] = { 0, 6, 11, 15, 18, 20, 21 };
+#define KERNEL(A, B) { &CollisionTests::PairKernel<Collider::ColliderShape::A, Collider::ColliderShape::B>,	\
+	OrderedPairTest<Collider::ColliderShape::A, Collider::ColliderShape::B>::cost }
+#define KERNEL_ROW(A) { KERNEL(A, SPHERE), KERNEL(A, BOX), KERNEL(A, CAPSULE), KERNEL(A, CONE), KERNEL(A, CYLINDER), KERNEL(A, PLANE), KERNEL(A, MESH), KERNEL(A, TRIANGLE_MESH), KERNEL(A, HEIGHTFIELD), KERNEL(A, CONVEX_HULL) }
+const CollisionTests::KernelEntry CollisionTests::Kernels[10][10] = {
+	KERNEL_ROW(SPHERE),
+	KERNEL_ROW(BOX),
+	KERNEL_ROW(CAPSULE),
+	KERNEL_ROW(CONE),
+	KERNEL_ROW(CYLINDER),
+	KERNEL_ROW(PLANE),
+	KERNEL_ROW(MESH),
+	KERNEL_ROW(TRIANGLE_MESH),
+	KERNEL_ROW(HEIGHTFIELD),
+	KERNEL_ROW(CONVEX_HULL)
+};
+#undef KERNEL_ROW
+#undef KERNEL
 
 gFloat CollisionTests::AABBTestEpsilon = gFloat(0.03f);
 gFloat CollisionTests::EPADistanceThreshold = gFloat(0.001f);
+unsigned int CollisionTests::GJKMaxIterations = 32;
+
+CollisionTests::Kernel CollisionTests::SelectKernel(Collider* a, Collider* b)
+{
+	return Kernels[(int)a->GetShape()][(int)b->GetShape()].test;
+}
 
 int CollisionTests::TestCollision(Collider* a, Collider* b, Contact* contacts)
 {
-	int _a = (int)a->GetShape(), _b = (int)b->GetShape();
+	return Kernels[(int)a->GetShape()][(int)b->GetShape()].test(a, b, contacts, nullptr);
+}
+
+int CollisionTests::TestCollision(Collider* a, Collider* b, Contact* contacts, CollisionWarmStart* warmStart)
+{
+	return Kernels[(int)a->GetShape()][(int)b->GetShape()].test(a, b, contacts, warmStart);
+}
+
+unsigned int CollisionTests::EstimateCost(Collider* a, Collider* b)
+{
+	return Kernels[(int)a->GetShape()][(int)b->GetShape()].cost;
+}
+
+std::atomic<unsigned int> CollisionTests::UnsupportedTests[10][10];
+
+unsigned int CollisionTests::GetUnsupportedTestCount(Collider::ColliderShape a, Collider::ColliderShape b)
+{
+	return a <= b ? UnsupportedTests[(int)a][(int)b].load() : UnsupportedTests[(int)b][(int)a].load();
+}
+
+// Speculative Contacts
+// Colliders that are not touching, but close enough that they could be by the end of the step, get a
+// Contact with negative penetration. The ContactResolver only removes the part of the closing velocity
+// that would make them actually touch, so a fast body is stopped at the surface without substepping
+int CollisionTests::SpeculativeTest(Collider* a, Collider* b, gFloat margin, Contact* contacts)
+{
+	if(margin <= gFloat(0.0f)) return 0;
+
+	// Same order as TestCollision so normals always point the same way for a pair
+	Collider* _a = a, *_b = b;
+	if(a->GetShape() > b->GetShape())
+		Swap<Collider*>(_a, _b);
+
+	// TriangleMeshes and HeightFields have no support point for GJK
+	Collider::ColliderShape sA = _a->GetShape(), sB = _b->GetShape();
+	if(sA == Collider::ColliderShape::TRIANGLE_MESH || sA == Collider::ColliderShape::HEIGHTFIELD ||
+	   sB == Collider::ColliderShape::TRIANGLE_MESH || sB == Collider::ColliderShape::HEIGHTFIELD) return 0;
+
+	Vector normal, pointA, pointB;
+	gFloat dist;
+
+	// Planes have no support point, so use deepest point of other Collider into the Plane instead of GJK
+	if(_a->GetShape() == Collider::ColliderShape::PLANE || _b->GetShape() == Collider::ColliderShape::PLANE)
+	{
+		if(_a->GetShape() == _b->GetShape()) return 0;
+		bool planeFirst = _a->GetShape() == Collider::ColliderShape::PLANE;
+		PlaneCollider* p = static_cast<PlaneCollider*>(planeFirst ? _a : _b);
+		Collider* c = planeFirst ? _b : _a;
+
+		// Plane normal pointing towards the side the other Collider is on
+		Vector side = (c->position.DotProduct(p->normal) - p->d) >= gFloat(0.0f) ? p->normal : -p->normal;
+		pointA = c->GetSupportPoint(-side);
+		dist = pointA.DotProduct(side) - (side == p->normal ? p->d : -p->d);
+		normal = planeFirst ? side : -side;
+	}
+	else
+	{
+		dist = GJKDistance(_a, _b, pointA, pointB);
+		if(dist > gFloat(0.0f))
+			normal = (pointB - pointA) / dist;
+	}
+
+	// Touching (regular tests missed it) or too far away to reach this step
+	if(dist <= gFloat(0.0f) || dist >= margin)
+		return 0;
+
+	contacts->SetNewContact(_a->attachedBody, _b->attachedBody, GetCoeffOfRestitution(_a, _b),
+							GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
+							normal, pointA, -dist);
+	return 1;
+}
+
+#pragma region Batched Sphere Tests
+#ifdef GLADE_SSE2
+// Lanes matching gBatchFloat. BLanes(Add) is FLanesAdd in float batches, LanesAdd otherwise
+#ifdef MIXED_PRECISION_BATCHES
+typedef fLanes bLanes;
+#define B_LANE_COUNT	F_LANE_COUNT
+#define BLanes(op)		FLanes##op
+#else
+typedef gLanes bLanes;
+#define B_LANE_COUNT	LANE_COUNT
+#define BLanes(op)		Lanes##op
+#endif
+#endif
+
+void SphereBatch::Clear()
+{
+	colliders1.clear(); colliders2.clear();
+	origins.clear(); ar.clear();
+	bx.clear(); by.clear(); bz.clear(); bw.clear();
+	margins.clear();
+}
 
-	// Call appropriate function
-	if(_a > _b)
-		return Tests[helperIndices[_b] + _a](b, a, contacts);
+unsigned int CollisionTests::AddSpherePair(SphereBatch& batch, Collider* sphere, Collider* other, gFloat margin)
+{
+	SphereCollider* s = static_cast<SphereCollider*>(sphere);
+	const Vector& origin = s->position;
+	batch.colliders1.push_back(sphere);
+	batch.colliders2.push_back(other);
+	batch.origins.push_back(origin);
+	batch.ar.push_back(gBatchFloat(s->radius));
+	if(other->GetShape() == Collider::ColliderShape::PLANE)
+	{
+		// Move the Plane's distance to be from the pair's origin
+		PlaneCollider* p = static_cast<PlaneCollider*>(other);
+		batch.bx.push_back(gBatchFloat(p->normal.x));
+		batch.by.push_back(gBatchFloat(p->normal.y));
+		batch.bz.push_back(gBatchFloat(p->normal.z));
+		batch.bw.push_back(gBatchFloat(p->d - p->normal.DotProduct(origin)));
+	}
 	else
-		return Tests[helperIndices[_a] + _b](a, b, contacts);
+	{
+		SphereCollider* s2 = static_cast<SphereCollider*>(other);
+		batch.bx.push_back(gBatchFloat(s2->position.x - origin.x));
+		batch.by.push_back(gBatchFloat(s2->position.y - origin.y));
+		batch.bz.push_back(gBatchFloat(s2->position.z - origin.z));
+		batch.bw.push_back(gBatchFloat(s2->radius));
+	}
+	batch.margins.push_back(margin);
+	return batch.colliders1.size() - 1;
 }
 
+// Same as SphereSphereTest, but every pair gets a result. Separated pairs get a negative depth
+void CollisionTests::SphereSphereBatchTest(SphereBatch& batch)
+{
+	unsigned int i = 0, size = batch.GetSize();
+	batch.nx.resize(size); batch.ny.resize(size); batch.nz.resize(size);
+	batch.px.resize(size); batch.py.resize(size); batch.pz.resize(size);
+	batch.depths.resize(size);
+
+#ifdef GLADE_SSE2
+	bLanes smallest = BLanes(Set)(gBatchFloat(G_FLT_SMALL)), one = BLanes(Set)(gBatchFloat(1.0f));
+	for(; i + B_LANE_COUNT <= size; i += B_LANE_COUNT)
+	{
+		// The first Sphere is at the origin, so the second Sphere's center is the difference between them
+		bLanes dx = BLanes(Load)(&batch.bx[i]), dy = BLanes(Load)(&batch.by[i]), dz = BLanes(Load)(&batch.bz[i]), ar = BLanes(Load)(&batch.ar[i]);
+		bLanes len = BLanes(Sqrt)(BLanes(Add)(BLanes(Add)(BLanes(Mul)(dx, dx), BLanes(Mul)(dy, dy)), BLanes(Mul)(dz, dz)));
+
+		// Concentric Spheres get a zero normal, fixed up when the Contact is read back
+		bLanes inv = BLanes(Div)(one, BLanes(Max)(len, smallest));
+		bLanes nx = BLanes(Mul)(dx, inv), ny = BLanes(Mul)(dy, inv), nz = BLanes(Mul)(dz, inv);
+		BLanes(Store)(&batch.nx[i], nx);
+		BLanes(Store)(&batch.ny[i], ny);
+		BLanes(Store)(&batch.nz[i], nz);
+		BLanes(Store)(&batch.px[i], BLanes(Mul)(nx, ar));
+		BLanes(Store)(&batch.py[i], BLanes(Mul)(ny, ar));
+		BLanes(Store)(&batch.pz[i], BLanes(Mul)(nz, ar));
+		BLanes(Store)(&batch.depths[i], BLanes(Sub)(BLanes(Add)(ar, BLanes(Load)(&batch.bw[i])), len));
+	}
+#endif
+
+	// Pairs that don't fill a whole register (or every pair without SIMD)
+	for(; i < size; ++i)
+	{
+		gBatchFloat dx = batch.bx[i], dy = batch.by[i], dz = batch.bz[i];
+		gBatchFloat len = std::sqrt(dx * dx + dy * dy + dz * dz);
+		gBatchFloat inv = gBatchFloat(1.0f) / (len > gBatchFloat(G_FLT_SMALL) ? len : gBatchFloat(G_FLT_SMALL));
+		batch.nx[i] = dx * inv;
+		batch.ny[i] = dy * inv;
+		batch.nz[i] = dz * inv;
+		batch.px[i] = batch.nx[i] * batch.ar[i];
+		batch.py[i] = batch.ny[i] * batch.ar[i];
+		batch.pz[i] = batch.nz[i] * batch.ar[i];
+		batch.depths[i] = batch.ar[i] + batch.bw[i] - len;
+	}
+}
+
+// Same as SpherePlaneTest, but every pair gets a result. Separated pairs get a negative depth
+void CollisionTests::SpherePlaneBatchTest(SphereBatch& batch)
+{
+	unsigned int i = 0, size = batch.GetSize();
+	batch.nx.resize(size); batch.ny.resize(size); batch.nz.resize(size);
+	batch.px.resize(size); batch.py.resize(size); batch.pz.resize(size);
+	batch.depths.resize(size);
+
+#ifdef GLADE_SSE2
+	bLanes zero = BLanes(Set)(gBatchFloat(0.0f));
+	for(; i + B_LANE_COUNT <= size; i += B_LANE_COUNT)
+	{
+		bLanes ar = BLanes(Load)(&batch.ar[i]);
+		bLanes bx = BLanes(Load)(&batch.bx[i]), by = BLanes(Load)(&batch.by[i]), bz = BLanes(Load)(&batch.bz[i]);
+
+		// Signed distance of Sphere center (the origin) from Plane
+		bLanes dist = BLanes(Sub)(zero, BLanes(Load)(&batch.bw[i]));
+
+		// Normal points from the Sphere into the Plane
+		bLanes above = BLanes(Greater)(dist, zero);
+		bLanes nx = BLanes(Select)(above, BLanes(Sub)(zero, bx), bx);
+		bLanes ny = BLanes(Select)(above, BLanes(Sub)(zero, by), by);
+		bLanes nz = BLanes(Select)(above, BLanes(Sub)(zero, bz), bz);
+		BLanes(Store)(&batch.nx[i], nx);
+		BLanes(Store)(&batch.ny[i], ny);
+		BLanes(Store)(&batch.nz[i], nz);
+		BLanes(Store)(&batch.px[i], BLanes(Mul)(nx, ar));
+		BLanes(Store)(&batch.py[i], BLanes(Mul)(ny, ar));
+		BLanes(Store)(&batch.pz[i], BLanes(Mul)(nz, ar));
+		BLanes(Store)(&batch.depths[i], BLanes(Sub)(ar, BLanes(Abs)(dist)));
+	}
+#endif
+
+	// Pairs that don't fill a whole register (or every pair without SIMD)
+	for(; i < size; ++i)
+	{
+		gBatchFloat dist = -batch.bw[i];
+		gBatchFloat sign = dist > gBatchFloat(0.0f) ? gBatchFloat(-1.0f) : gBatchFloat(1.0f);
+		batch.nx[i] = batch.bx[i] * sign;
+		batch.ny[i] = batch.by[i] * sign;
+		batch.nz[i] = batch.bz[i] * sign;
+		batch.px[i] = batch.nx[i] * batch.ar[i];
+		batch.py[i] = batch.ny[i] * batch.ar[i];
+		batch.pz[i] = batch.nz[i] * batch.ar[i];
+		batch.depths[i] = batch.ar[i] - std::abs(dist);
+	}
+}
+
+int CollisionTests::GetBatchContact(const SphereBatch& batch, unsigned int i, Contact* contacts)
+{
+	// Without Speculative Contacts the margin is 0, so this is the same as the single pair tests
+	if(batch.depths[i] <= -batch.margins[i])
+		return 0;
+
+	Collider* _a = batch.colliders1[i], *_b = batch.colliders2[i];
+	Vector normal(batch.nx[i], batch.ny[i], batch.nz[i]);
+	if(normal.IsZero())
+		normal = Vector(0, 1, 0);	// Concentric Spheres, any direction will push them apart
+	else
+		normal.NormalizeInPlace();	// Back to full precision
+	// Contact point goes back to world space in gFloat
+	Vector point = batch.origins[i] + Vector(batch.px[i], batch.py[i], batch.pz[i]);
+	contacts->SetNewContact(_a->attachedBody, _b->attachedBody, GetCoeffOfRestitution(_a, _b),
+							GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
+							normal, point, batch.depths[i]);
+	return 1;
+}
+#pragma endregion
+
 void CollisionTests::SetAABBTestEpsilon(gFloat e) { AABBTestEpsilon = e; }
 bool CollisionTests::AABBTest(AABB a, AABB b)
 {
@@ -40,6 +385,19 @@ bool CollisionTests::AABBTest(AABB a, AABB b)
 	return true;
 }
 
+// Same as AABBTest, but AABBs are also considered intersecting if they are within 'margin' of each other
+bool CollisionTests::AABBTest(AABB a, AABB b, gFloat margin)
+{
+	margin += AABBTestEpsilon;
+	if(a.maximum.x < b.minimum.x - margin) return false;
+	if(a.minimum.x > b.maximum.x + margin) return false;
+	if(a.maximum.y < b.minimum.y - margin) return false;
+	if(a.minimum.y > b.maximum.y + margin) return false;
+	if(a.maximum.z < b.minimum.z - margin) return false;
+	if(a.minimum.z > b.maximum.z + margin) return false;
+	return true;
+}
+
 // Test if a Ray intersects with a Sphere
 // If intersection, set 't' to distance along ray to intersection point and return True
 // If no intersection, return False
@@ -134,8 +492,54 @@ bool CollisionTests::RayPlaneTest(Ray ray, Plane p, gFloat t, Vector& v)
 	return false;
 }
 
+// Test if a Ray hits any triangle of a TriangleMeshCollider
+// If it does, set 't' to distance along ray to the closest hit and return True
+bool CollisionTests::RayTriangleMeshTest(Ray ray, Collider* mesh, gFloat& t)
+{
+	TriangleMeshCollider* m = static_cast<TriangleMeshCollider*>(mesh);
+
+	// Mesh transform doesn't scale, so distances along the ray are the same in local space
+	Ray local(m->ToLocal(ray.origin), m->transform.Transpose3Times(ray.dir), ray.len);
+	unsigned int triangle;
+	return m->mesh->RayCast(local, t, triangle);
+}
+
+// Test if a Ray hits any triangle of a HeightFieldCollider
+// If it does, set 't' to distance along ray to the closest hit and return True
+bool CollisionTests::RayHeightFieldTest(Ray ray, Collider* field, gFloat& t)
+{
+	HeightFieldCollider* h = static_cast<HeightFieldCollider*>(field);
+
+	Ray local(h->ToLocal(ray.origin), h->transform.Transpose3Times(ray.dir), ray.len);
+	unsigned int triangle;
+	return h->field->RayCast(local, t, triangle);
+}
+
+// Test if a Ray hits a ConvexHullCollider
+// If it does, set 't' to distance along ray to where it enters the hull and return True
+bool CollisionTests::RayConvexHullTest(Ray ray, Collider* hull, gFloat& t)
+{
+	ConvexHullCollider* h = static_cast<ConvexHullCollider*>(hull);
+
+	Ray local(h->ToLocal(ray.origin), h->transform.Transpose3Times(ray.dir), ray.len);
+	return h->hull->RayCast(local, t);
+}
+
+bool CollisionTests::RayColliderTest(Ray ray, Collider* c, gFloat& t)
+{
+	switch(c->GetShape())
+	{
+	case Collider::ColliderShape::TRIANGLE_MESH:	return RayTriangleMeshTest(ray, c, t);
+	case Collider::ColliderShape::HEIGHTFIELD:		return RayHeightFieldTest(ray, c, t);
+	case Collider::ColliderShape::CONVEX_HULL:		return RayConvexHullTest(ray, c, t);
+	default:										return RayAABBTest(ray, c->GetBounds(), t);
+	}
+}
+
 // NORMAL IS RELATIVE TO _A
 // CONTACT POINT SHOULD BE ON SURFACE OF _A
+// NORMAL POINTS FROM _A TO _B, PENETRATION IS POSITIVE WHEN OVERLAPPING
+// (NEGATIVE PENETRATION IS RESERVED FOR SPECULATIVE CONTACTS)
 #pragma region Sphere Collisions
 int CollisionTests::SphereSphereTest(Collider* _a, Collider* _b, Contact* contacts)
 {
@@ -152,7 +556,7 @@ int CollisionTests::SphereSphereTest(Collider* _a, Collider* _b, Contact* contac
 		Vector normal = diff / len;
 		contacts->SetNewContact(s1->attachedBody, s2->attachedBody, GetCoeffOfRestitution(_a,_b), 
 								GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b), 
-								normal, s1->position + normal*s1->radius, len - rad);
+								normal, s1->position + normal*s1->radius, rad - len);
 		return 1;
 	}
 
@@ -175,7 +579,7 @@ int CollisionTests::SphereBoxTest(Collider* _a, Collider* _b, Contact* contacts)
 		Vector normal = diff / len;
 		contacts->SetNewContact(s->attachedBody, b->attachedBody, GetCoeffOfRestitution(_a,_b), 
 								GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
-								normal,	s->position + normal*s->radius, len - s->radius);
+								normal,	s->position + normal*s->radius, s->radius - len);
 		return 1;
 	}
 	return 0;
@@ -197,7 +601,7 @@ int CollisionTests::SphereCapsuleTest(Collider* _a, Collider* _b, Contact* conta
 		normal /= len;
 		contacts->SetNewContact(_a->attachedBody, _b->attachedBody, GetCoeffOfRestitution(_a, _b),
 								GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
-								normal, s->position + normal*s->radius, len - rad);
+								normal, s->position + normal*s->radius, rad - len);
 		return 1;
 	}
 	return 0;
@@ -225,7 +629,7 @@ int CollisionTests::SphereCylinderTest(Collider* _a, Collider* _b, Contact* cont
 			Vector norm = diff / len;
 			contacts->SetNewContact(s->attachedBody, c->attachedBody, GetCoeffOfRestitution(_a, _b),
 									GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b), 
-									norm, s->position + norm*s->radius, len - rad);
+									norm, s->position + norm*s->radius, rad - len);
 			return 1;
 		}
 	}
@@ -250,9 +654,10 @@ int CollisionTests::SphereCylinderTest(Collider* _a, Collider* _b, Contact* cont
 		Vector norm = diff / len;
 		contacts->SetNewContact(s->attachedBody, c->attachedBody, GetCoeffOfRestitution(_a, _b),
 								GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b), 
-								norm, s->position + norm*s->radius, len - rad);
+								norm, s->position + norm*s->radius, rad - len);
 		return 1;
 	}
+	return 0;
 }
 int CollisionTests::SphereConeTest(Collider* _a, Collider* _b, Contact* contacts)
 {
@@ -301,7 +706,7 @@ int CollisionTests::SphereConeTest(Collider* _a, Collider* _b, Contact* contacts
 		Vector normal = (p - s->position).Normalized();
 		contacts->SetNewContact(s->attachedBody, c->attachedBody, GetCoeffOfRestitution(_a, _b),
 								GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
-								normal, normal*s->radius, e - s->radius);
+								normal, s->position + normal*s->radius, s->radius - e);
 		return 1;
 	}
 	return 0;
@@ -318,10 +723,10 @@ int CollisionTests::SpherePlaneTest(Collider* _a, Collider* _b, Contact* contact
 	// Collision true if distance from Sphere center to plane is less than Sphere's radius
 	if(Abs(dist) < s->radius)
 	{
-		Vector normal = dist > 0 ? p->normal : -p->normal;
+		Vector normal = dist > 0 ? -p->normal : p->normal;
 		contacts->SetNewContact(_a->attachedBody, _b->attachedBody, GetCoeffOfRestitution(_a, _b),
 								GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
-								normal, s->position + normal*s->radius, Abs(dist) - s->radius);
+								normal, s->position + normal*s->radius, s->radius - Abs(dist));
 		return 1;
 	}
 	return 0;
@@ -329,7 +734,7 @@ int CollisionTests::SpherePlaneTest(Collider* _a, Collider* _b, Contact* contact
 #pragma endregion
 
 #pragma region Box Collisions
-int CollisionTests::BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts)
+int CollisionTests::BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts, CollisionWarmStart* warmStart)
 {
 	BoxCollider* b1 = static_cast<BoxCollider*>(_a);
 	BoxCollider* b2 = static_cast<BoxCollider*>(_b);
@@ -352,12 +757,34 @@ int CollisionTests::BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts)
 										//	4,5,6 = b1 intersects face of b2
 										//  7..15 = edge-edge contact
 
+	// Compute Matrix to express b2 in b1's coordinate frame
+	// Add in epsilon term to counteract errors when two edges are parallel and their
+	// cross product is near null
+	Matrix R, AbsR;
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		for(unsigned int j = 0; j < 3; ++j)
+		{
+			R(i,j) = b1->u[i].DotProduct(b2->u[j]);
+			AbsR(i, j) = Abs(R(i,j)) + 1.0e-5f;
+		}
+	}
+
+	// Try the axis that separated them last time first. Boxes whose AABBs overlap are usually still apart along it
+	if(warmStart != nullptr && warmStart->axis > 0 && BoxBoxAxisSeparates(b1, b2, R, AbsR, t, warmStart->axis))
+		return 0;
+
 	// Calculate the separation distance between the boxes along an axis
 	// If there is separation, they do not intersect
 	// Otherwise, track and save the smallest penetration depth and the corresponding normal
+#define SEPARATED(c)											\
+	{															\
+		if(warmStart != nullptr) warmStart->axis = (c);			\
+		return 0;												\
+	}
 #define TEST(TL, sumRadii, norm, c)		\
 	sep = Abs(TL) - (sumRadii);			\
-	if(sep > 0) return 0;				\
+	if(sep > 0) SEPARATED(c);			\
 	if(sep > separationDist)			\
 	{									\
 			separationDist = sep;		\
@@ -367,19 +794,9 @@ int CollisionTests::BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts)
 	}
 
 	// Test axes L = A0, L = A1, L = A2
-	Matrix R, AbsR;
 	gFloat rb1, rb2, tDotL;
 	for(unsigned int i = 0; i < 3; ++i)
 	{
-		// Compute Matrix to express b2 in b1's coordinate frame
-		// Add in epsilon term to counteract errors when two edges are parallel and their
-		// cross product is near null
-		for(unsigned int j = 0; j < 3; ++j)
-		{
-			R(i,j) = b1->u[i].DotProduct(b2->u[j]);
-			AbsR(i, j) = Abs(R(i,j)) + 1.0e-5f;
-		}
-
 		rb1 = b1->halfWidths[i];
 		rb2 = b2->halfWidths.x * AbsR(i,0) + b2->halfWidths.y * AbsR(i,1) + b2->halfWidths.z * AbsR(i,2);
 		tDotL = t[i];
@@ -390,7 +807,7 @@ int CollisionTests::BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts)
 	// Test axes L = B0, L = B1, L = B2
 	for(unsigned int i = 0; i < 3; ++i)
 	{
-		rb1 = b1->halfWidths.x * AbsR(0, i) + b1->halfWidths.y * AbsR(1, i) + b2->halfWidths.z * AbsR(2, i);
+		rb1 = b1->halfWidths.x * AbsR(0, i) + b1->halfWidths.y * AbsR(1, i) + b1->halfWidths.z * AbsR(2, i);
 		rb2 = b2->halfWidths[i];
 		tDotL = t.x*R(0,i) + t.y*R(1,i) + t.z*R(2,i);
 		TEST(tDotL, rb1 + rb2, b2->u[i], i+4);
@@ -401,7 +818,7 @@ int CollisionTests::BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts)
 #undef TEST
 #define TEST(TL, sumRadii, n1, n2, n3, c)				\
 	sep = Abs(TL) - (sumRadii);							\
-	if(sep > EPSILON) return 0;							\
+	if(sep > EPSILON) SEPARATED(c);						\
 	l = Sqrt((n1)*(n1) + (n2)*(n2) + (n3)*(n3));		\
 	if(l > EPSILON)										\
 	{													\
@@ -479,7 +896,12 @@ int CollisionTests::BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts)
 	TEST(tDotL, rb1 + rb2, -R(1,2), R(0,2), 0, 15);
 //	if(Abs(tDotL > rb1 + rb2)) return 0;
 
+#undef TEST
+#undef SEPARATED
+
 	// No separating axis found, Collision is true
+	// Axis of least penetration is the most likely to separate them next time
+	if(warmStart != nullptr) warmStart->axis = code;
 	if(code == 0) return 0;
 //	if(contacts == nullptr) return 1;
 
@@ -716,6 +1138,34 @@ int CollisionTests::BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts)
 	//return cnumUsed;
    	return 1;
 }
+bool CollisionTests::BoxBoxAxisSeparates(BoxCollider* b1, BoxCollider* b2, const Matrix& R, const Matrix& AbsR, const Vector& t, int axis)
+{
+	const Vector& a = b1->halfWidths, &b = b2->halfWidths;
+	unsigned int i, j;
+
+	// Axis L = Ai
+	if(axis <= 3)
+	{
+		i = axis - 1;
+		return Abs(t[i]) - (a[i] + b.x * AbsR(i,0) + b.y * AbsR(i,1) + b.z * AbsR(i,2)) > 0;
+	}
+
+	// Axis L = Bj
+	if(axis <= 6)
+	{
+		j = axis - 4;
+		return Abs(t.x*R(0,j) + t.y*R(1,j) + t.z*R(2,j)) - (a.x * AbsR(0,j) + a.y * AbsR(1,j) + a.z * AbsR(2,j) + b[j]) > 0;
+	}
+
+	// Axis L = Ai x Bj, same terms as the edge axes in BoxBoxTest written for any i and j
+	i = (axis - 7) / 3;
+	j = (axis - 7) % 3;
+	unsigned int i1 = (i + 1) % 3, i2 = (i + 2) % 3, j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+	gFloat rb1 = a[i1] * AbsR(i2,j) + a[i2] * AbsR(i1,j);
+	gFloat rb2 = b[j1] * AbsR(i,j2) + b[j2] * AbsR(i,j1);
+	gFloat tDotL = t[i2] * R(i1,j) - t[i1] * R(i2,j);
+	return Abs(tDotL) - (rb1 + rb2) > EPSILON;
+}
 int CollisionTests::BoxCapsuleTest(Collider* _a, Collider* _b, Contact* contacts)
 {
 	BoxCollider* b = static_cast<BoxCollider*>(_a);
@@ -754,10 +1204,10 @@ int CollisionTests::BoxPlaneTest(Collider* _a, Collider* _b, Contact* contacts)
 	// Collision true if distance from Box to plane is less-than Box 'radius'
 	if(Abs(d) < r)
 	{
-		Vector normal = d > 0 ? p->normal : -p->normal;
+		Vector normal = d > 0 ? -p->normal : p->normal;
 		contacts->SetNewContact(_a->attachedBody, _b->attachedBody, GetCoeffOfRestitution(_a, _b),
 								GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
-								normal, b->position + normal*r, d - r);
+								normal, b->position + normal*r, r - Abs(d));
 		return 1;
 	}
 	return 0;
@@ -878,11 +1328,312 @@ int CollisionTests::PlaneMeshTest(Collider* _a, Collider* _b, Contact* contacts)
 	PlaneCollider* p = static_cast<PlaneCollider*>(_a);
 	MeshCollider* m = static_cast<MeshCollider*>(_b);
 
-	return 0;
+	// Same as a ConvexHull: every vertex through the Plane touches it, keep the deepest few
+	Vector side = (m->position.DotProduct(p->normal) - p->d) >= gFloat(0.0f) ? p->normal : -p->normal;
+	gFloat d = side == p->normal ? p->d : -p->d;
+
+	MeshContacts found;
+	Vector v;
+	gFloat depth;
+	for(auto iter = m->vertices.begin(); iter != m->vertices.end(); ++iter)
+	{
+		v = *iter * m->transform;
+		depth = d - v.DotProduct(side);
+		if(depth > gFloat(0.0f))
+			found.Add(side, v + side * depth, depth);
+	}
+
+	for(unsigned int i = 0; i < found.count; ++i)
+		contacts[i].SetNewContact(_a->attachedBody, _b->attachedBody, GetCoeffOfRestitution(_a, _b),
+								  GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
+								  found.normals[i], found.points[i], found.depths[i]);
+	return found.count;
+}
+int CollisionTests::PlaneConvexHullTest(Collider* _a, Collider* _b, Contact* contacts)
+{
+	PlaneCollider* p = static_cast<PlaneCollider*>(_a);
+	ConvexHullCollider* h = static_cast<ConvexHullCollider*>(_b);
+
+	// Plane normal pointing towards the side the Hull's centroid is on
+	Vector side = (h->position.DotProduct(p->normal) - p->d) >= gFloat(0.0f) ? p->normal : -p->normal;
+	gFloat d = side == p->normal ? p->d : -p->d;
+
+	// Nothing reaches through the Plane if the deepest vertex doesn't
+	if(h->GetSupportPoint(-side).DotProduct(side) - d >= gFloat(0.0f))
+		return 0;
+
+	// Every vertex through the Plane touches it. Keep the deepest few so a Hull resting on a face stays flat
+	MeshContacts found;
+	Vector v;
+	gFloat depth;
+	for(unsigned int i = 0; i < h->hull->GetNumVertices(); ++i)
+	{
+		v = h->hull->GetVertex(i) * h->transform;
+		depth = d - v.DotProduct(side);
+		if(depth > gFloat(0.0f))
+			found.Add(side, v + side * depth, depth);
+	}
+
+	for(unsigned int i = 0; i < found.count; ++i)
+		contacts[i].SetNewContact(_a->attachedBody, _b->attachedBody, GetCoeffOfRestitution(_a, _b),
+								  GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
+								  found.normals[i], found.points[i], found.depths[i]);
+	return found.count;
 }
 #pragma endregion
 
-int CollisionTests::GJKTest(Collider* _a, Collider* _b, Contact* contacts)
+#pragma region Triangle Mesh and HeightField Collision
+template<class T> int CollisionTests::SphereTrianglesTest(Collider* _a, Collider* _b, const T* triangles, Contact* contacts)
+{
+	SphereCollider* s = static_cast<SphereCollider*>(_a);
+
+	Vector center = _b->ToLocal(s->position);
+	Vector r(s->radius, s->radius, s->radius);
+
+	MeshContacts found;
+	Vector a, b, c;
+	triangles->Query(AABB(center - r, center + r), [&](unsigned int tri)
+	{
+		triangles->GetTriangle(tri, a, b, c);
+
+		// Collision true if closest point on Triangle is within Sphere's radius
+		Vector d = ClosestPointOnTriangle(center, a, b, c) - center;
+		gFloat dist2 = d.DotProduct(d);
+		if(dist2 >= s->radius * s->radius) return;
+
+		gFloat dist = Sqrt(dist2);
+		Vector normal;
+		if(dist > G_FLT_SMALL)
+			normal = d / dist;
+		else
+		{
+			// Center is on the Triangle, push out the side the face normal points
+			normal = -(b - a).CrossProduct(c - a);
+			gFloat len = normal.Magnitude();
+			if(len < G_FLT_SMALL) return;	// Degenerate Triangle
+			normal /= len;
+		}
+		found.Add(normal, center + normal * s->radius, s->radius - dist);
+	});
+
+	return WriteMeshContacts(found, _a, _b, contacts);
+}
+
+template<class T> int CollisionTests::CapsuleTrianglesTest(Collider* _a, Collider* _b, const T* triangles, Contact* contacts)
+{
+	CapsuleCollider* cap = static_cast<CapsuleCollider*>(_a);
+
+	Vector p = _b->ToLocal(cap->p), q = _b->ToLocal(cap->q);
+	Vector r(cap->radius, cap->radius, cap->radius);
+	gFloat r2 = cap->radius * cap->radius;
+
+	MeshContacts found;
+	Vector a, b, c;
+	triangles->Query(AABB(Vector::VectorMin(p, q) - r, Vector::VectorMax(p, q) + r), [&](unsigned int tri)
+	{
+		triangles->GetTriangle(tri, a, b, c);
+		Vector n = (b - a).CrossProduct(c - a);
+		gFloat len = n.Magnitude();
+		if(len < G_FLT_SMALL) return;	// Degenerate Triangle
+		n /= len;
+
+		// Segment passes through the Triangle. Push the deeper end back out the side the other end is on
+		gFloat dp = (p - a).DotProduct(n), dq = (q - a).DotProduct(n);
+		if(dp * dq < gFloat(0.0f))
+		{
+			Vector hit = p + (q - p) * (dp / (dp - dq));
+			if((ClosestPointOnTriangle(hit, a, b, c) - hit).SquaredMagnitude() < G_FLT_SMALL * G_FLT_SMALL)
+			{
+				bool pDeeper = Abs(dp) < Abs(dq);
+				Vector end = pDeeper ? p : q;
+				Vector normal = (pDeeper ? dq : dp) > gFloat(0.0f) ? -n : n;
+				found.Add(normal, end + normal * cap->radius, cap->radius + Min(Abs(dp), Abs(dq)));
+				return;
+			}
+		}
+
+		// Closest points between segment and Triangle are at an end of the segment, or on an edge of the Triangle
+		Vector closest[5], onSegment[5];
+		closest[0] = ClosestPointOnTriangle(p, a, b, c);	onSegment[0] = p;
+		closest[1] = ClosestPointOnTriangle(q, a, b, c);	onSegment[1] = q;
+		ClosestPointsOnSegments(p, q, a, b, onSegment[2], closest[2]);
+		ClosestPointsOnSegments(p, q, b, c, onSegment[3], closest[3]);
+		ClosestPointsOnSegments(p, q, c, a, onSegment[4], closest[4]);
+
+		// Deepest point, plus each end of the segment that also touches so a Capsule lying on the mesh rests on both ends
+		gFloat dist2[5];
+		unsigned int best = 0;
+		for(unsigned int i = 0; i < 5; ++i)
+		{
+			dist2[i] = (closest[i] - onSegment[i]).SquaredMagnitude();
+			if(dist2[i] < dist2[best]) best = i;
+		}
+		for(unsigned int i = 0; i < 5; ++i)
+		{
+			if(dist2[i] >= r2 || (i != best && i > 1)) continue;
+
+			gFloat dist = Sqrt(dist2[i]);
+			Vector normal = dist > G_FLT_SMALL ? (closest[i] - onSegment[i]) / dist : (dp + dq >= gFloat(0.0f) ? -n : n);
+			found.Add(normal, onSegment[i] + normal * cap->radius, cap->radius - dist);
+		}
+	});
+
+	return WriteMeshContacts(found, _a, _b, contacts);
+}
+
+template<class T> int CollisionTests::BoxTrianglesTest(Collider* _a, Collider* _b, const T* triangles, Contact* contacts)
+{
+	BoxCollider* box = static_cast<BoxCollider*>(_a);
+
+	// Box's center and axes in the mesh's local space
+	Vector center = _b->ToLocal(box->position);
+	Vector u[3], e = box->halfWidths;
+	for(unsigned int i = 0; i < 3; ++i)
+		u[i] = _b->transform.Transpose3Times(box->u[i]);
+	Vector extents(Abs(u[0].x) * e.x + Abs(u[1].x) * e.y + Abs(u[2].x) * e.z,
+				   Abs(u[0].y) * e.x + Abs(u[1].y) * e.y + Abs(u[2].y) * e.z,
+				   Abs(u[0].z) * e.x + Abs(u[1].z) * e.y + Abs(u[2].z) * e.z);
+
+	MeshContacts found;
+	Vector v[3];
+	triangles->Query(AABB(center - extents, center + extents), [&](unsigned int tri)
+	{
+		// Separating Axis Test with Triangle relative to Box's center
+		triangles->GetTriangle(tri, v[0], v[1], v[2]);
+		Vector f[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+		Vector n = f[0].CrossProduct(f[1]);
+		gFloat len = n.Magnitude();
+		if(len < G_FLT_SMALL) return;	// Degenerate Triangle
+		n /= len;
+		for(unsigned int i = 0; i < 3; ++i)
+			v[i] -= center;
+
+		// Axes are Triangle's normal, Box's 3 axes, and the 9 cross products of their edges
+		// Track the axis needing the least movement to push the Box out. Normal points from Box to Triangle
+		gFloat bestDepth = G_MAX;
+		Vector bestNormal;
+		int bestAxis = -1;
+		for(int axis = 0; axis < 13; ++axis)
+		{
+			Vector L = axis == 0 ? n : axis < 4 ? u[axis - 1] : u[(axis - 4) / 3].CrossProduct(f[(axis - 4) % 3]);
+			if(axis >= 4)
+			{
+				gFloat l = L.Magnitude();
+				if(l < G_FLT_SMALL) continue;	// Edges are parallel, axis is covered by the others
+				L /= l;
+			}
+
+			gFloat rb = e.x * Abs(u[0].DotProduct(L)) + e.y * Abs(u[1].DotProduct(L)) + e.z * Abs(u[2].DotProduct(L));
+			gFloat p0 = v[0].DotProduct(L), p1 = v[1].DotProduct(L), p2 = v[2].DotProduct(L);
+			gFloat pMin = Min(p0, Min(p1, p2)), pMax = Max(p0, Max(p1, p2));
+			if(pMin > rb || pMax < -rb) return;	// Separating axis found
+
+			// Box either moves back along L so its top is below the Triangle, or forward so its bottom is above
+			gFloat back = rb - pMin, forward = pMax + rb;
+			gFloat depth = Min(back, forward);
+
+			// Prefer the face normal over other axes that are only slightly shallower, so Boxes resting on
+			// the mesh don't get pushed sideways off edges
+			if(axis == 0 || depth < bestDepth * gFloat(0.95f) - G_FLT_SMALL)
+			{
+				bestDepth = depth;
+				bestNormal = back <= forward ? L : -L;
+				bestAxis = axis;
+			}
+		}
+
+		if(bestAxis == 0)
+		{
+			// Face of the Triangle: each corner of the Box that is through the Triangle's plane and over the Triangle
+			bool added = false;
+			Vector deepest;
+			gFloat deepestDepth = -G_MAX, depth;
+			for(unsigned int i = 0; i < 8; ++i)
+			{
+				Vector corner = u[0] * ((i & 1) ? e.x : -e.x) + u[1] * ((i & 2) ? e.y : -e.y) + u[2] * ((i & 4) ? e.z : -e.z);
+				depth = (corner - v[0]).DotProduct(bestNormal);
+				if(depth > deepestDepth)
+				{
+					deepestDepth = depth;
+					deepest = corner;
+				}
+				if(depth <= gFloat(0.0f)) continue;
+
+				// Over the Triangle if on the inner side of all 3 edges
+				Vector inward = n.CrossProduct(f[0]);
+				if((corner - v[0]).DotProduct(inward) < gFloat(0.0f)) continue;
+				inward = n.CrossProduct(f[1]);
+				if((corner - v[1]).DotProduct(inward) < gFloat(0.0f)) continue;
+				inward = n.CrossProduct(f[2]);
+				if((corner - v[2]).DotProduct(inward) < gFloat(0.0f)) continue;
+
+				found.Add(bestNormal, center + corner, depth);
+				added = true;
+			}
+
+			// Box overlaps an edge of the Triangle without a corner over it
+			if(!added)
+				found.Add(bestNormal, center + deepest, bestDepth);
+		}
+		else if(bestAxis < 4)
+		{
+			// Face of the Box: deepest Triangle vertex, moved out to the Box's face
+			gFloat p0 = v[0].DotProduct(bestNormal), p1 = v[1].DotProduct(bestNormal), p2 = v[2].DotProduct(bestNormal);
+			Vector deepest = p0 <= p1 && p0 <= p2 ? v[0] : p1 <= p2 ? v[1] : v[2];
+			found.Add(bestNormal, center + deepest + bestNormal * bestDepth, bestDepth);
+		}
+		else
+		{
+			// Edge of the Box against edge of the Triangle
+			// Box edge is the one along the axis' Box direction that is furthest along the normal
+			unsigned int i = (bestAxis - 4) / 3, j = (bestAxis - 4) % 3;
+			Vector edge;
+			for(unsigned int k = 0; k < 3; ++k)
+			{
+				if(k == i) continue;
+				edge += u[k] * (u[k].DotProduct(bestNormal) > gFloat(0.0f) ? e[k] : -e[k]);
+			}
+
+			Vector onBox, onTriangle;
+			ClosestPointsOnSegments(edge - u[i] * e[i], edge + u[i] * e[i], v[j], v[(j + 1) % 3], onBox, onTriangle);
+			found.Add(bestNormal, center + onBox, bestDepth);
+		}
+	});
+
+	return WriteMeshContacts(found, _a, _b, contacts);
+}
+
+void CollisionTests::MeshContacts::Add(const Vector& n, const Vector& p, gFloat depth)
+{
+	// Full, replace the shallowest if this one is deeper
+	unsigned int i = count;
+	if(count == MAX_CONTACTS_PER_TEST)
+	{
+		i = 0;
+		for(unsigned int j = 1; j < count; ++j)
+			if(depths[j] < depths[i]) i = j;
+		if(depths[i] >= depth) return;
+	}
+	else
+		++count;
+
+	normals[i] = n;
+	points[i] = p;
+	depths[i] = depth;
+}
+
+int CollisionTests::WriteMeshContacts(const MeshContacts& found, Collider* _a, Collider* _b, Contact* contacts)
+{
+	for(unsigned int i = 0; i < found.count; ++i)
+		contacts[i].SetNewContact(_a->attachedBody, _b->attachedBody, GetCoeffOfRestitution(_a, _b),
+								  GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b),
+								  _b->transform.Times3(found.normals[i]), _b->ToWorld(found.points[i]), found.depths[i]);
+	return found.count;
+}
+#pragma endregion
+
+template<class A, class B>
+int CollisionTests::GJKTest(A* _a, B* _b, Contact* contacts, CollisionWarmStart* warmStart)
 {
 	// Array of 4 vertices representing a k-Simplex as k goes from 0 to 3
 	// Always arranged so the largest index is the newest vertex 'a' and the smallest index is the oldest vertex ('b', 'c', or 'd')
@@ -892,21 +1643,56 @@ int CollisionTests::GJKTest(Collider* _a, Collider* _b, Contact* contacts)
 		// Stacked cubes with the same dimensions creates a line segment that contains the origin and a (0,0,0) search direction
 		// Fairly abritrary workaround, picking diagonal direction so stacks shouldn't cause issues
 	SupportPoint supp;
-	unsigned int simplexIndex = 0;
+	unsigned int simplexIndex = 0, iterations = 0;
+	if(warmStart != nullptr)
+		warmStart->epaIterations = 0;
 
-	// Add 1st point on Minkowski Difference to Simplex
-	simplex[simplexIndex++].Set(_a, _b, d);
-	d.Negate();
+	if(warmStart != nullptr && warmStart->valid)
+	{
+		// Try last step's direction first. If it still separates the Colliders we're done after one support point
+		d = warmStart->direction;
+		simplex[simplexIndex++].Set(_a, _b, d);
+		if(simplex[0].p.DotProduct(d) <= gFloat(0.0f))
+		{
+			warmStart->gjkIterations = 1;
+			return 0;
+		}
+
+		// Otherwise carry on from that point, searching back towards the origin
+		d = simplex[0].p.Negated();
+		if(d.IsZero())
+		{
+			// Origin is on the support point, same degenerate case as above
+			d = Vector(1,1,1);
+			simplex[0].Set(_a, _b, d);
+			d.Negate();
+		}
+	}
+	else
+	{
+		// Add 1st point on Minkowski Difference to Simplex
+		simplex[simplexIndex++].Set(_a, _b, d);
+		d.Negate();
+	}
 
 	while(true)
 	{
 		// Add new point to Simplex
 		supp.Set(_a, _b, d);
+		++iterations;
 
 		// If last point in Simplex does not pass origin in direction 'd,' then the
 		// Minkowski Difference cannot possibly contain the origin, therefore no collision.
 		if(supp.p.DotProduct(d) <= gFloat(0.0f))
+		{
+			if(warmStart != nullptr)
+			{
+				warmStart->direction = d;
+				warmStart->valid = true;
+				warmStart->gjkIterations = iterations;
+			}
 			return 0;
+		}
 
 		// Add new point to Simplex
 		simplex[simplexIndex++] = supp;
@@ -915,7 +1701,18 @@ int CollisionTests::GJKTest(Collider* _a, Collider* _b, Contact* contacts)
 		{
 			// Tetrahedral Simplex contains origin, collision confirmed
 			// Run Expanding Polytope Algorithm (EPA) to get collision details
-			return EPA(_a, _b, simplex, contacts);
+			unsigned int epaIterations;
+			int used = EPA(_a, _b, simplex, contacts, epaIterations);
+
+			// Contact normal is the direction that will separate them first if they move apart
+			if(warmStart != nullptr)
+			{
+				warmStart->direction = contacts->GetNormal();
+				warmStart->valid = !contacts->GetNormal().IsZero();
+				warmStart->gjkIterations = iterations;
+				warmStart->epaIterations = epaIterations;
+			}
+			return used;
 		}
 		// No collision found yet, keep going
 	}
@@ -1233,84 +2030,286 @@ bool CollisionTests::GJKDoSimplex(SupportPoint simplex[4], unsigned int& simplex
 	}
 }
 
-void CollisionTests::SetEPADistanceThreshold(gFloat dist) { EPADistanceThreshold = dist; }
-int CollisionTests::EPA(Collider* _a, Collider* _b, SupportPoint simplex[4], Contact* contacts)
+int CollisionTests::GJKCollision(Collider* a, Collider* b, Contact* contacts, CollisionWarmStart* warmStart)
 {
-	std::list<Triangle> triangles;
-	std::list<Edge> edges;
-	std::list<Triangle>::iterator face;
-	std::list<Edge>::iterator eIter;
-	SupportPoint newPoint;
-	Edge e;
-	gFloat dist = G_MAX;
+	return GJKTest(a, b, contacts, warmStart);
+}
+
+// GJK run to find the distance between 2 separated Colliders instead of just whether they intersect
+// Source: 'Real Time Collision Detection' by Christer Ericson, p399-408
+gFloat CollisionTests::GJKDistance(Collider* _a, Collider* _b, Vector& pointA, Vector& pointB)
+{
+	SupportPoint simplex[4];
+	gFloat lambda[4] = { gFloat(1.0f), gFloat(0.0f), gFloat(0.0f), gFloat(0.0f) };
+	unsigned int simplexSize = 0;
+	SupportPoint supp;
+	gFloat vv;
 
-	triangles.push_back(Triangle(simplex[3], simplex[2], simplex[1]));
-	triangles.push_back(Triangle(simplex[3], simplex[1], simplex[0]));
-	triangles.push_back(Triangle(simplex[3], simplex[0], simplex[2]));
-	triangles.push_back(Triangle(simplex[2], simplex[0], simplex[1]));
+	// Start with any point in the Minkowski Difference
+	// Search directions are normalized because Sphere support points assume a unit vector
+	Vector v = _a->position - _b->position;
+	if(v.SquaredMagnitude() < EPSILON)
+		v = Vector(1, 1, 1);
+	simplex[simplexSize++].Set(_a, _b, (-v).Normalized());
+	v = simplex[0].p;
 
-	while(true)
+	for(unsigned int i = 0; i < GJKMaxIterations; ++i)
+	{
+		// Origin is (nearly) in the Simplex, Colliders intersect
+		vv = v.SquaredMagnitude();
+		if(vv < EPSILON)
+			return gFloat(0.0f);
+
+		// Get support point in the direction of the origin
+		supp.Set(_a, _b, (-v).Normalized());
+
+		// New point gets no closer to the origin than current closest point - done
+		if(vv - v.DotProduct(supp.p) <= vv * gFloat(0.0001f))
+			break;
+
+		// New point is already in the simplex - no more progress can be made
+		bool duplicate = false;
+		for(unsigned int j = 0; j < simplexSize; ++j)
+			if(simplex[j] == supp) duplicate = true;
+		if(duplicate) break;
+
+		simplex[simplexSize++] = supp;
+		v = GJKClosestPointOnSimplex(simplex, simplexSize, lambda);
+
+		// Full Tetrahedron means it encloses the origin
+		if(simplexSize == 4)
+			return gFloat(0.0f);
+	}
+
+	// Closest points on each Collider are the same combination of their support points
+	pointA = Vector();
+	pointB = Vector();
+	for(unsigned int i = 0; i < simplexSize; ++i)
 	{
-		// Pick closest 'face' (triangle) to origin
-		gFloat d;
-		for(auto iter = triangles.begin(); iter != triangles.end(); ++iter)
+		pointA += simplex[i].suppA * lambda[i];
+		pointB += simplex[i].suppB * lambda[i];
+	}
+	return v.Magnitude();
+}
+
+Vector CollisionTests::GJKClosestPointOnSimplex(SupportPoint simplex[4], unsigned int& simplexSize, gFloat lambda[4])
+{
+	Vector closest;
+	gFloat l[4] = { gFloat(0.0f), gFloat(0.0f), gFloat(0.0f), gFloat(0.0f) };
+
+	switch(simplexSize)
+	{
+		case 1:		// 0-Simplex - Point
+		{
+			l[0] = gFloat(1.0f);
+			break;
+		}
+		case 2:		// 1-Simplex - Line Segment
+		{
+			Vector ab = simplex[1].p - simplex[0].p;
+			gFloat t = -simplex[0].p.DotProduct(ab) / ab.SquaredMagnitude();
+			t = Clamp<gFloat>(t, gFloat(0.0f), gFloat(1.0f));
+			l[0] = gFloat(1.0f) - t;
+			l[1] = t;
+			break;
+		}
+		case 3:		// 2-Simplex - Triangle
 		{
-			d = (*iter).normal.DotProduct((*iter).a.p);
-			if(d < dist)
+			// Test which Voronoi region of the Triangle the origin is in
+			// Source: 'Real Time Collision Detection' by Christer Ericson, p139-142
+			Vector a = simplex[0].p, b = simplex[1].p, c = simplex[2].p;
+			Vector ab = b - a, ac = c - a;
+			gFloat d1 = -ab.DotProduct(a), d2 = -ac.DotProduct(a);
+			gFloat d3 = -ab.DotProduct(b), d4 = -ac.DotProduct(b);
+			gFloat d5 = -ab.DotProduct(c), d6 = -ac.DotProduct(c);
+			gFloat va = d3*d6 - d5*d4, vb = d5*d2 - d1*d6, vc = d1*d4 - d3*d2;
+
+			if(d1 <= gFloat(0.0f) && d2 <= gFloat(0.0f))									// Vertex a
+				l[0] = gFloat(1.0f);
+			else if(d3 >= gFloat(0.0f) && d4 <= d3)											// Vertex b
+				l[1] = gFloat(1.0f);
+			else if(d6 >= gFloat(0.0f) && d5 <= d6)											// Vertex c
+				l[2] = gFloat(1.0f);
+			else if(vc <= gFloat(0.0f) && d1 >= gFloat(0.0f) && d3 <= gFloat(0.0f))			// Edge ab
+			{ l[1] = d1 / (d1 - d3); l[0] = gFloat(1.0f) - l[1]; }
+			else if(vb <= gFloat(0.0f) && d2 >= gFloat(0.0f) && d6 <= gFloat(0.0f))			// Edge ac
+			{ l[2] = d2 / (d2 - d6); l[0] = gFloat(1.0f) - l[2]; }
+			else if(va <= gFloat(0.0f) && (d4 - d3) >= gFloat(0.0f) && (d5 - d6) >= gFloat(0.0f))	// Edge bc
+			{ l[2] = (d4 - d3) / ((d4 - d3) + (d5 - d6)); l[1] = gFloat(1.0f) - l[2]; }
+			else																			// Face
 			{
-				dist = d;
-				face = iter;
+				gFloat denom = gFloat(1.0f) / (va + vb + vc);
+				l[1] = vb * denom;
+				l[2] = vc * denom;
+				l[0] = gFloat(1.0f) - l[1] - l[2];
 			}
+			break;
 		}
+		case 4:		// 3-Simplex - Tetrahedron
+		{
+			// Closest point is on one of the faces the origin is outside of
+			// If origin is outside of none of them, it is inside the Tetrahedron
+			static const unsigned int faces[4][4] = { {0,1,2,3}, {0,3,1,2}, {0,2,3,1}, {1,3,2,0} };
+			gFloat best = G_MAX, dist, faceLambda[4];
+			bool outside = false;
+			for(unsigned int f = 0; f < 4; ++f)
+			{
+				const unsigned int* i = faces[f];
+				Vector n = (simplex[i[1]].p - simplex[i[0]].p).CrossProduct(simplex[i[2]].p - simplex[i[0]].p);
+				gFloat signOrigin = -simplex[i[0]].p.DotProduct(n);
+				gFloat signOpposite = (simplex[i[3]].p - simplex[i[0]].p).DotProduct(n);
+				if(signOrigin * signOpposite >= gFloat(0.0f))
+					continue;
+				outside = true;
+
+				SupportPoint face[4] = { simplex[i[0]], simplex[i[1]], simplex[i[2]] };
+				unsigned int faceSize = 3;
+				Vector p = GJKClosestPointOnSimplex(face, faceSize, faceLambda);
+				dist = p.SquaredMagnitude();
+				if(dist < best)
+				{
+					best = dist;
+					for(unsigned int j = 0; j < 4; ++j)	l[j] = gFloat(0.0f);
+					for(unsigned int j = 0; j < faceSize; ++j)
+						for(unsigned int k = 0; k < 3; ++k)
+							if(face[j] == simplex[i[k]]) { l[i[k]] = faceLambda[j]; break; }
+				}
+			}
+
+			if(!outside)
+			{
+				for(unsigned int i = 0; i < 4; ++i) lambda[i] = gFloat(0.25f);
+				return Vector();
+			}
+			break;
+		}
+		default: { AssertMsg(false, "Invalid GJK Simplex"); return Vector(); }
+	}
+
+	// Keep only the vertices that contribute to the closest point
+	unsigned int size = 0;
+	for(unsigned int i = 0; i < simplexSize; ++i)
+	{
+		if(l[i] <= gFloat(0.0f)) continue;
+		simplex[size] = simplex[i];
+		lambda[size] = l[i];
+		closest += simplex[size].p * l[i];
+		++size;
+	}
+
+	// Closest point right on a vertex with zero weight everywhere else can't happen, but be safe
+	if(size == 0)
+	{
+		lambda[0] = gFloat(1.0f);
+		size = 1;
+		closest = simplex[0].p;
+	}
+	simplexSize = size;
+	return closest;
+}
+
+void CollisionTests::SetEPADistanceThreshold(gFloat dist) { EPADistanceThreshold = dist; }
+template<class A, class B>
+int CollisionTests::EPA(A* _a, B* _b, SupportPoint simplex[4], Contact* contacts, unsigned int& iterations)
+{
+	// Polytope lives on the stack, EPA never allocates. Faces are never reused, a removed face
+	// stays in the heap and is skipped when it comes up
+	EPAPolytope poly;
+	poly.numVertices = poly.numFaces = poly.heapSize = 0;
+
+	// Start from GJK's Tetrahedron, wound so every face's normal points away from the 4th vertex
+	for(unsigned int i = 0; i < 4; ++i)
+		poly.vertices[poly.numVertices++] = simplex[i];
+	if((simplex[2] - simplex[3]).CrossProduct(simplex[1] - simplex[3]).DotProduct(simplex[0] - simplex[3]) > gFloat(0.0f))
+		std::swap(poly.vertices[0], poly.vertices[1]);
+
+	EPAAddFace(poly, 3, 2, 1);
+	EPAAddFace(poly, 3, 1, 0);
+	EPAAddFace(poly, 3, 0, 2);
+	EPAAddFace(poly, 2, 0, 1);
+
+	// Connect each face to the faces sharing its edges
+	for(unsigned int f1 = 0; f1 < 4; ++f1)
+		for(unsigned int e1 = 0; e1 < 3; ++e1)
+			for(unsigned int f2 = f1 + 1; f2 < 4; ++f2)
+				for(unsigned int e2 = 0; e2 < 3; ++e2)
+					if(poly.faces[f1].v[e1] == poly.faces[f2].v[(e2 + 1) % 3] && poly.faces[f1].v[(e1 + 1) % 3] == poly.faces[f2].v[e2])
+						EPABind(poly, f1, e1, f2, e2);
+
+	auto heapOrder = [&poly](unsigned int f1, unsigned int f2) { return poly.faces[f1].dist > poly.faces[f2].dist; };
+	EPAFace* face = nullptr;
+	SupportPoint newPoint;
+	unsigned int iteration = 0;
+	for(; ; ++iteration)
+	{
+		// Pick closest face to origin still on the polytope
+		while(poly.heapSize > 1 && poly.faces[poly.heap[0]].removed)
+			std::pop_heap(poly.heap, poly.heap + poly.heapSize--, heapOrder);
+		face = &poly.faces[poly.heap[0]];
+
+		// Out of iterations, closest face so far is the best answer we have
+		if(iteration >= EPA_MAX_ITERATIONS)
+			break;
 
 		// Get new support point from chosen face's normal
-		newPoint.Set(_a, _b, (*face).normal);
+		newPoint.Set(_a, _b, face->normal);
 
 		// New support point isn't any further away, it's on the nearest face
 		// Nearest face must be on edge of Minkowski Difference
-//		if(face->normal.DotProduct(newPoint.p) == dist)
-		if(face->normal.DotProduct(newPoint.p) - dist < EPADistanceThreshold)
+		if(face->normal.DotProduct(newPoint.p) - face->dist < EPADistanceThreshold)
 			break;
 
-		// Add edges of each "seen" face to edges list
-		// If opposite edge already in list, don't add and remove opposite edge
-		// Fancy lambda again to handle testing/adding edges
-		auto addEdgeLambda = [&](const SupportPoint& a, SupportPoint& b){
-						for(auto iter = edges.begin(); iter != edges.end(); ++iter)	{
-							if(iter->a == b && iter->b == a) {
-								edges.erase(iter);
-								return;
-							}
-						}
-						edges.emplace_back(a,b);
-		};
-
-		for(auto iter = triangles.begin(); iter != triangles.end();)
+		// Remove every face the new point can see, starting from the closest face (which it always sees)
+		// and flooding out across shared edges. Edges where it stops make up the horizon
+		unsigned int closest = face - poly.faces;
+		poly.horizonSize = 0;
+		face->removed = true;
+		bool valid = true;
+		for(unsigned int e = 0; e < 3 && valid; ++e)
+			valid = EPASilhouette(poly, face->adj[e], face->adjEdge[e], newPoint.p);
+
+		// Ran out of room, or the horizon is too small to close the hole (numerical trouble)
+		// Stop here and use the closest face
+		if(!valid || poly.horizonSize < 3 || poly.numFaces + poly.horizonSize > EPA_MAX_FACES)
+			break;
+
+		// Add new faces to cover the "hole" made from the removed faces. The flood fill walks
+		// the horizon in order, so each new face shares an edge with the one before it
+		unsigned int w = poly.numVertices, first = poly.numFaces, f;
+		poly.vertices[poly.numVertices++] = newPoint;
+		for(unsigned int h = 0; h < poly.horizonSize && valid; ++h)
 		{
-			if(iter->normal.DotProduct(newPoint.p - iter->a.p) > 0)
+			EPAHorizonEdge& edge = poly.horizon[h];
+			EPAFace& kept = poly.faces[edge.face];
+			f = EPAAddFace(poly, kept.v[(edge.edge + 1) % 3], kept.v[edge.edge], w);
+			EPABind(poly, f, 0, edge.face, edge.edge);
+			if(h > 0)
 			{
-				addEdgeLambda(iter->a, iter->b);
-				addEdgeLambda(iter->b, iter->c);
-				addEdgeLambda(iter->c, iter->a);
-				iter = triangles.erase(iter);
-				continue;
+				valid = poly.faces[f - 1].v[1] == poly.faces[f].v[0];
+				EPABind(poly, f - 1, 1, f, 2);
 			}
-			iter++;
 		}
+		valid = valid && poly.faces[f].v[1] == poly.faces[first].v[0];
+		EPABind(poly, f, 1, first, 2);
 
-		// Add new faces to cover the "hole" made from the removed faces
-		for(auto iter = edges.begin(); iter != edges.end(); ++iter)
-			triangles.emplace_back(newPoint, iter->a, iter->b);
-
-		// Clear edge list for next iteration
-		edges.clear();
-		dist = G_MAX;
+		// Horizon wasn't a single loop, polytope is broken. Closest face is still the best answer
+		if(!valid)
+		{
+			face = &poly.faces[closest];
+			break;
+		}
 	}
 
+	iterations = iteration;
+
 	// Polytope fully expanded, extract collision info
 	// Get barycentric coordinates of origin projected onto nearest face
 	// Taken from "Real Time Collision Detection" by Christer Ericson, p47-48
-	Vector v0 = face->b - face->a, v1 = face->c - face->a, v2 = face->normal * dist - face->a.p;
+	const SupportPoint& fa = poly.vertices[face->v[0]];
+	const SupportPoint& fb = poly.vertices[face->v[1]];
+	const SupportPoint& fc = poly.vertices[face->v[2]];
+	gFloat dist = face->dist;
+	Vector v0 = fb - fa, v1 = fc - fa, v2 = face->normal * dist - fa.p;
 	gFloat d00 = v0.DotProduct(v0);
 	gFloat d01 = v0.DotProduct(v1);
 	gFloat d11 = v1.DotProduct(v1);
@@ -1323,11 +2322,71 @@ int CollisionTests::EPA(Collider* _a, Collider* _b, SupportPoint simplex[4], Con
 
 	contacts->SetNewContact(_a->attachedBody, _b->attachedBody, GetCoeffOfRestitution(_a, _b),
 							GetStaticFriction(_a, _b), GetDynamicFriction(_a, _b), face->normal,
-							face->a.suppA*u + face->b.suppA*v + face->c.suppA*w,
+							fa.suppA*u + fb.suppA*v + fc.suppA*w,
 							dist);
 	return 1;
 }
 
+unsigned int CollisionTests::EPAAddFace(EPAPolytope& poly, unsigned int a, unsigned int b, unsigned int c)
+{
+	unsigned int f = poly.numFaces++;
+	EPAFace& face = poly.faces[f];
+	face.v[0] = a;
+	face.v[1] = b;
+	face.v[2] = c;
+	face.removed = false;
+
+	// Degenerate (sliver) faces can't give a normal, keep them at the bottom of the heap
+	Vector n = (poly.vertices[b] - poly.vertices[a]).CrossProduct(poly.vertices[c] - poly.vertices[a]);
+	gFloat len = n.Magnitude();
+	if(len > G_FLT_SMALL)
+	{
+		face.normal = n / len;
+		face.dist = face.normal.DotProduct(poly.vertices[a].p);
+	}
+	else
+	{
+		face.normal = n;
+		face.dist = G_MAX;
+	}
+
+	poly.heap[poly.heapSize++] = f;
+	std::push_heap(poly.heap, poly.heap + poly.heapSize,
+		[&poly](unsigned int f1, unsigned int f2) { return poly.faces[f1].dist > poly.faces[f2].dist; });
+	return f;
+}
+
+void CollisionTests::EPABind(EPAPolytope& poly, unsigned int f1, unsigned int e1, unsigned int f2, unsigned int e2)
+{
+	poly.faces[f1].adj[e1] = f2;
+	poly.faces[f1].adjEdge[e1] = e2;
+	poly.faces[f2].adj[e2] = f1;
+	poly.faces[f2].adjEdge[e2] = e1;
+}
+
+bool CollisionTests::EPASilhouette(EPAPolytope& poly, unsigned int f, unsigned int e, const Vector& w)
+{
+	EPAFace& face = poly.faces[f];
+	if(face.removed)
+		return true;
+
+	if(face.normal.DotProduct(w - poly.vertices[face.v[0]].p) <= gFloat(0.0f))
+	{
+		// Can't see this face, the edge we came across is on the horizon
+		if(poly.horizonSize >= EPA_MAX_HORIZON)
+			return false;
+		poly.horizon[poly.horizonSize].face = f;
+		poly.horizon[poly.horizonSize].edge = e;
+		++poly.horizonSize;
+		return true;
+	}
+
+	// Visible, remove it and carry on across its other 2 edges (in winding order, so the horizon comes out in order)
+	face.removed = true;
+	return EPASilhouette(poly, face.adj[(e + 1) % 3], face.adjEdge[(e + 1) % 3], w) &&
+		   EPASilhouette(poly, face.adj[(e + 2) % 3], face.adjEdge[(e + 2) % 3], w);
+}
+
 #pragma region Utility Functions
 Vector CollisionTests::ClosestPointOnOOBB(Vector p, Vector c, Vector u[3], Vector e)
 {
@@ -1403,6 +2462,97 @@ void CollisionTests::ClosestPointsOnEdges(Vector a, Vector ua, Vector b, Vector
 	}
 }
 
+Vector CollisionTests::ClosestPointOnTriangle(Vector p, Vector a, Vector b, Vector c)
+{
+	// Source: 'Real Time Collision Detection' by Christer Ericson, p-141-142
+	// Check which Voronoi region of the Triangle 'p' is in
+	Vector ab = b - a, ac = c - a, ap = p - a;
+	gFloat d1 = ab.DotProduct(ap), d2 = ac.DotProduct(ap);
+	if(d1 <= gFloat(0.0f) && d2 <= gFloat(0.0f)) return a;	// Vertex 'a'
+
+	Vector bp = p - b;
+	gFloat d3 = ab.DotProduct(bp), d4 = ac.DotProduct(bp);
+	if(d3 >= gFloat(0.0f) && d4 <= d3) return b;			// Vertex 'b'
+
+	gFloat vc = d1*d4 - d3*d2;
+	if(vc <= gFloat(0.0f) && d1 >= gFloat(0.0f) && d3 <= gFloat(0.0f))
+		return a + ab * (d1 / (d1 - d3));					// Edge 'ab'
+
+	Vector cp = p - c;
+	gFloat d5 = ab.DotProduct(cp), d6 = ac.DotProduct(cp);
+	if(d6 >= gFloat(0.0f) && d5 <= d6) return c;			// Vertex 'c'
+
+	gFloat vb = d5*d2 - d1*d6;
+	if(vb <= gFloat(0.0f) && d2 >= gFloat(0.0f) && d6 <= gFloat(0.0f))
+		return a + ac * (d2 / (d2 - d6));					// Edge 'ac'
+
+	gFloat va = d3*d6 - d5*d4;
+	if(va <= gFloat(0.0f) && (d4 - d3) >= gFloat(0.0f) && (d5 - d6) >= gFloat(0.0f))
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));	// Edge 'bc'
+
+	// Inside face, use barycentric coordinates
+	gFloat denom = gFloat(1.0f) / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+gFloat CollisionTests::ClosestPointsOnSegments(Vector p1, Vector q1, Vector p2, Vector q2, Vector& c1, Vector& c2)
+{
+	// Source: 'Real Time Collision Detection' by Christer Ericson, p-149-151
+	Vector d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+	gFloat a = d1.DotProduct(d1), e = d2.DotProduct(d2), f = d2.DotProduct(r);
+	gFloat s, t;
+
+	if(a <= G_FLT_SMALL && e <= G_FLT_SMALL)
+	{
+		// Both segments are points
+		s = t = gFloat(0.0f);
+	}
+	else if(a <= G_FLT_SMALL)
+	{
+		// First segment is a point
+		s = gFloat(0.0f);
+		t = f / e;
+		Clamp(t, gFloat(0.0f), gFloat(1.0f));
+	}
+	else
+	{
+		gFloat c = d1.DotProduct(r);
+		if(e <= G_FLT_SMALL)
+		{
+			// Second segment is a point
+			t = gFloat(0.0f);
+			s = -c / a;
+			Clamp(s, gFloat(0.0f), gFloat(1.0f));
+		}
+		else
+		{
+			// Closest point on first segment's line to second's, unless they are parallel
+			gFloat b = d1.DotProduct(d2), denom = a*e - b*b;
+			s = denom != gFloat(0.0f) ? (b*f - c*e) / denom : gFloat(0.0f);
+			Clamp(s, gFloat(0.0f), gFloat(1.0f));
+
+			// Closest point on second segment to that, clamping and recomputing 's' if it falls off the end
+			t = (b*s + f) / e;
+			if(t < gFloat(0.0f))
+			{
+				t = gFloat(0.0f);
+				s = -c / a;
+				Clamp(s, gFloat(0.0f), gFloat(1.0f));
+			}
+			else if(t > gFloat(1.0f))
+			{
+				t = gFloat(1.0f);
+				s = (b - c) / a;
+				Clamp(s, gFloat(0.0f), gFloat(1.0f));
+			}
+		}
+	}
+
+	c1 = p1 + d1 * s;
+	c2 = p2 + d2 * t;
+	return (c1 - c2).SquaredMagnitude();
+}
+
 int CollisionTests::IntersectRectQuad(gFloat h[2], gFloat p[8], gFloat ret[16])
 {
 	// q and r contain nq and nr coordinate points for current and chopped polygons
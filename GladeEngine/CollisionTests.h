@@ -8,6 +8,9 @@
 #ifndef GLADE_CONTACT_H
 #include "Contacts\Contact.h"
 #endif
+#ifndef GLADE_CONTACT_STREAM_H
+#include "Contacts\ContactStream.h"
+#endif
 #ifndef GLADE_VECTOR_H
 #include "Math\Vector.h"
 #endif
@@ -20,33 +23,146 @@
 #ifndef GLADE_CONFIG_H
 #include "GladeConfig.h"
 #endif
-#include <list>
 #include <algorithm>
+#include <atomic>
+
+// Storage limits of the polytope EPA expands. Storage is fixed size so EPA never allocates
+#define EPA_MAX_ITERATIONS	32							// Support points added before settling for the closest face found so far
+#define EPA_MAX_VERTICES	(EPA_MAX_ITERATIONS + 4)	// Starting Tetrahedron plus one per iteration
+#define EPA_MAX_FACES		(EPA_MAX_VERTICES * 8)		// Every face made. Removed faces are not reused
+#define EPA_MAX_HORIZON		64							// Edges around the faces removed in one iteration
 
 namespace Glade {
+// Collision Test state kept for a pair of Colliders from one step to the next
+// Pairs move little between steps, so whatever separated them last step almost always still does
+struct CollisionWarmStart
+{
+	CollisionWarmStart() : valid(false), axis(0), gjkIterations(0), epaIterations(0) { }
+
+	// GJK
+	Vector direction;	// Last separating direction (or Contact normal if they intersected) of the Minkowski Difference
+	bool valid;
+	unsigned int gjkIterations;	// Support points GJK and EPA added in the last test, for profiling
+	unsigned int epaIterations;	// EPA's is 0 if GJK found the Colliders separated
+
+	// Box-Box
+	int axis;			// Last separating axis (or axis of least penetration), numbered like BoxBoxTest's contact codes. 0 if none
+};
+
+// Support point of a Collider in direction 'd'
+// Given a concrete Collider type the call is picked at compile time and can be inlined, instead of going through the vtable
+template<class T> inline Vector GetSupport(T* c, const Vector& d) { return c->T::GetSupportPoint(d); }
+inline Vector GetSupport(Collider* c, const Vector& d) { return c->GetSupportPoint(d); }
+
+// Scalar batched Sphere tests run in. See MIXED_PRECISION_BATCHES in GladeConfig.h
+#ifdef MIXED_PRECISION_BATCHES
+typedef float gBatchFloat;
+#else
+typedef gFloat gBatchFloat;
+#endif
+
+// Sphere-Sphere (or Sphere-Plane) pairs gathered up to be tested together
+// Each value is kept in its own array, so the batched tests can work on several pairs at once with SIMD
+struct SphereBatch
+{
+	void Clear();
+	unsigned int GetSize() const { return colliders1.size(); }
+
+	// Inputs, one entry per pair. Collider 1 is always a Sphere
+	// Each pair is tested relative to its own origin, the Sphere's center, so everything else is a small offset
+	std::vector<Collider*>		colliders1, colliders2;
+	std::vector<Vector>			origins;			// Sphere's center
+	std::vector<gBatchFloat>	ar;					// Sphere's radius
+	std::vector<gBatchFloat>	bx, by, bz, bw;		// Other Sphere's center and radius, or Plane's normal and distance from origin
+	std::vector<gFloat>			margins;			// Pairs closer than this get a (Speculative) Contact
+
+	// Results, filled in by the batched test
+	std::vector<gBatchFloat>	nx, ny, nz;			// Contact normal
+	std::vector<gBatchFloat>	px, py, pz;			// Contact point, relative to origin
+	std::vector<gBatchFloat>	depths;				// Penetration depth, negative if separated
+};
+
 class CollisionTests
 {
 public:
+	// Collision Test for one pair of Collider shapes
+	typedef int (*Kernel)(Collider*, Collider*, Contact*, CollisionWarmStart*);
+
+	// Pick the Collision Test for a pair of Colliders. Every pair of Colliders with the same shapes uses the same
+	// test, so it can be picked once and called directly for as many pairs with those shapes as needed
+	static Kernel SelectKernel(Collider* a, Collider* b);
+
 	static int TestCollision(Collider* a, Collider* b, Contact* contacts);
+	// Same as above. If the Colliders are tested with GJK or Box-Box SAT, the test starts from (and updates) 'warmStart'
+	static int TestCollision(Collider* a, Collider* b, Contact* contacts, CollisionWarmStart* warmStart);
+
+	// Rough relative cost of calling TestCollision on these Colliders
+	// Used to balance narrowphase work across threads
+	static unsigned int EstimateCost(Collider* a, Collider* b);
+
+	// Generate a Contact with negative penetration (separation) for Colliders that are not touching,
+	// but are closer than 'margin'. Returns number of Contacts generated
+	static int SpeculativeTest(Collider* a, Collider* b, gFloat margin, Contact* contacts);
+
+	// Distance between 2 convex Colliders and the closest point on each. Returns 0 if they intersect
+	static gFloat GJKDistance(Collider* _a, Collider* _b, Vector& pointA, Vector& pointB);
+	// GJK (and EPA if they intersect) on any 2 convex Colliders, whichever Collision Test their shapes normally use
+	// Support points go through the vtable, so this is slower than the tests in Kernels. Meant for comparing against them
+	static int GJKCollision(Collider* a, Collider* b, Contact* contacts, CollisionWarmStart* warmStart);
+
+	// Batched Sphere-Sphere and Sphere-Plane tests
+	// Pairs are added to a batch, the whole batch is tested at once, then each pair's Contact is read back out
+	// 'margin' works the same as SpeculativeTest's. Returns index of the pair in the batch
+	static unsigned int AddSpherePair(SphereBatch& batch, Collider* sphere, Collider* other, gFloat margin);
+	static void SphereSphereBatchTest(SphereBatch& batch);
+	static void SpherePlaneBatchTest(SphereBatch& batch);
+	// Write Contact of pair 'i' of a tested batch. Returns number of Contacts generated
+	static int GetBatchContact(const SphereBatch& batch, unsigned int i, Contact* contacts);
 	
 	static void SetAABBTestEpsilon(gFloat e);
 	static bool AABBTest(AABB a, AABB b);
+	static bool AABBTest(AABB a, AABB b, gFloat margin);
 
 	static bool RaySphereTest(Ray ray, Vector cen, gFloat r, gFloat& t);
 	static bool RayAABBTest(Ray ray, AABB b, gFloat& t);
 	static bool RayPlaneTest(Ray ray, Plane p, gFloat t, Vector& v);
+	// Ray against the triangles of a TriangleMeshCollider, using the mesh's BVH
+	static bool RayTriangleMeshTest(Ray ray, Collider* mesh, gFloat& t);
+	// Ray against the triangles of a HeightFieldCollider, walking the cells under the ray
+	static bool RayHeightFieldTest(Ray ray, Collider* field, gFloat& t);
+	// Ray against the faces of a ConvexHullCollider
+	static bool RayConvexHullTest(Ray ray, Collider* hull, gFloat& t);
+	// Ray against any Collider. Meshes, heightfields and hulls are tested face by face, everything else against its bounds
+	static bool RayColliderTest(Ray ray, Collider* c, gFloat& t);
+
+	// Times Colliders shaped 'a' and 'b' were tested though there is no Collision Test between them (they pass
+	// through each other), or 0 if there is one. Safe to read while other threads are testing
+	static unsigned int GetUnsupportedTestCount(Collider::ColliderShape a, Collider::ColliderShape b);
 
 private:
-	// Array of pointers to each Collision Test function
-	typedef int (*FP)(Collider*, Collider*, Contact*);
-	static const FP Tests[28];
-	
-	// Utility array. Stores indices in the Tests array.
-	// Used to select index of correct function in Tests array
-	// for Collider's being tested
-	static const int helperIndices[7];
+	// Collision Test for each pair of shapes (indexed by ColliderShape) and its rough relative cost
+	struct KernelEntry
+	{
+		Kernel test;
+		unsigned int cost;
+	};
+	static const KernelEntry Kernels[10][10];
+	// Counted by shape pair, smaller ColliderShape first
+	static std::atomic<unsigned int> UnsupportedTests[10][10];
+
+	// Collision Test for Colliders shaped A and B (A <= B). Specialized for each pair of shapes with its own test,
+	// every other pair goes through GJK on the concrete Collider types
+	template<Collider::ColliderShape A, Collider::ColliderShape B> struct PairTest;
+	// PairTest for A and B in whichever order it is defined, with the Colliders swapped to match
+	// Picked by specialization, so the order that isn't used is never instantiated
+	template<Collider::ColliderShape A, Collider::ColliderShape B, bool Ordered = (A <= B)> struct OrderedPairTest;
+
+	// Entry in Kernels. Puts the Colliders in the order PairTest expects
+	template<Collider::ColliderShape A, Collider::ColliderShape B>
+	static int PairKernel(Collider* _a, Collider* _b, Contact* contacts, CollisionWarmStart* warmStart);
 
 	static gFloat AABBTestEpsilon;
+	static unsigned int GJKMaxIterations;
 	static gFloat EPADistanceThreshold;
 
 	inline static gFloat GetCoeffOfRestitution(Collider* _a, Collider* _b) { return _a->physicMaterial->GetCombinedBounciness(_b->physicMaterial); }
@@ -60,7 +176,11 @@ private:
 	static int SphereConeTest(Collider* _a, Collider* _b, Contact* contacts);
 	static int SpherePlaneTest(Collider* _a, Collider* _b, Contact* contacts);
 
-	static int BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts);
+	static int BoxBoxTest(Collider* _a, Collider* _b, Contact* contacts, CollisionWarmStart* warmStart);
+	// Whether one axis of the Separating Axis Test, numbered like BoxBoxTest's contact codes, separates 2 Boxes
+	// Uses the same separation and threshold as BoxBoxTest for that axis
+	// 'R' and 'AbsR' express b2's axes in b1's frame, 't' is b1 to b2 in b1's frame
+	static bool BoxBoxAxisSeparates(BoxCollider* b1, BoxCollider* b2, const Matrix& R, const Matrix& AbsR, const Vector& t, int axis);
 	static int BoxCapsuleTest(Collider* _a, Collider* _b, Contact* contacts);
 	static int BoxCylinderTest(Collider* _a, Collider* _b, Contact* contacts);
 	static int BoxConeTest(Collider* _a, Collider* _b, Contact* contacts);
@@ -80,21 +200,41 @@ private:
 
 	static int PlanePlaneTest(Collider* _a, Collider* _b, Contact* contacts);
 	static int PlaneMeshTest(Collider* _a, Collider* _b, Contact* contacts);
+	static int PlaneConvexHullTest(Collider* _a, Collider* _b, Contact* contacts);
+
+	// Tests against a TriangleMeshCollider or HeightFieldCollider '_b' are done in its local space, one triangle at a time,
+	// against only the triangles its BVH or grid finds near the other Collider. 'T' is the TriangleMesh or HeightField
+	template<class T> static int SphereTrianglesTest(Collider* _a, Collider* _b, const T* triangles, Contact* contacts);
+	template<class T> static int BoxTrianglesTest(Collider* _a, Collider* _b, const T* triangles, Contact* contacts);
+	template<class T> static int CapsuleTrianglesTest(Collider* _a, Collider* _b, const T* triangles, Contact* contacts);
+
+	// Contacts found against the triangles of a mesh or heightfield, in its local space
+	// Only the deepest MAX_CONTACTS_PER_TEST are kept
+	struct MeshContacts
+	{
+		MeshContacts() : count(0) { }
+		void Add(const Vector& n, const Vector& p, gFloat depth);
+
+		Vector normals[MAX_CONTACTS_PER_TEST];
+		Vector points[MAX_CONTACTS_PER_TEST];
+		gFloat depths[MAX_CONTACTS_PER_TEST];
+		unsigned int count;
+	};
+	// Convert kept Contacts to world space and write them out. Returns number of Contacts generated
+	static int WriteMeshContacts(const MeshContacts& found, Collider* _a, Collider* _b, Contact* contacts);
 
 // ~~~~ GJK Collision Detection ~~~~ 
 struct SupportPoint
 {
 	SupportPoint() {}
-	SupportPoint(Collider* _a, Collider* _b, const Vector& d)
+	template<class A, class B> SupportPoint(A* _a, B* _b, const Vector& d)
 	{
-		suppA = _a->GetSupportPoint(d);
-		suppB = _b->GetSupportPoint(-d);
-		p = suppA - suppB;
+		Set(_a, _b, d);
 	}
-	void Set(Collider* _a, Collider* _b, const Vector& d)
+	template<class A, class B> void Set(A* _a, B* _b, const Vector& d)
 	{
-		suppA = _a->GetSupportPoint(d);
-		suppB = _b->GetSupportPoint(-d);
+		suppA = GetSupport(_a, d);
+		suppB = GetSupport(_b, -d);
 		p = suppA - suppB;
 	}
 	Vector p;				// Minkowski difference point
@@ -105,27 +245,49 @@ struct SupportPoint
 	Vector operator-(const SupportPoint& other) const { return p - other.p; }
 };
 
-struct Triangle
+// Face of the polytope expanded by EPA
+struct EPAFace
 {
-	Triangle(const SupportPoint& _a, const SupportPoint& _b, const SupportPoint& _c) : a(_a), b(_b), c(_c) { normal = (b-a).CrossProduct(c-a).Normalized(); }
-	SupportPoint a, b, c;
+	unsigned int v[3];			// Vertex indices, counter-clockwise seen from outside. Edge i runs from v[i] to v[(i+1)%3]
+	unsigned int adj[3];		// Face on the other side of each edge
+	unsigned int adjEdge[3];	// Which edge of that face is shared
 	Vector normal;
+	gFloat dist;				// Distance from origin to face's plane
+	bool removed;				// No longer part of the polytope (still in the heap until popped)
 };
 
-struct Edge
+// Edge around the faces removed in an EPA iteration, given as an edge of the face that stays
+struct EPAHorizonEdge
 {
-	Edge() {}
-	Edge(SupportPoint _a, SupportPoint _b) : a(_a), b(_b) { }
-	void Set(SupportPoint _a, SupportPoint _b) { a = _a; b = _b; }
-	bool operator==(const Edge& other) { return a == other.a && b == other.b; }
-	SupportPoint a, b;
+	unsigned int face;
+	unsigned int edge;
 };
 
-	static int GJKTest(Collider* _a, Collider* _b, Contact* contacts);
+struct EPAPolytope
+{
+	SupportPoint	vertices[EPA_MAX_VERTICES];
+	EPAFace			faces[EPA_MAX_FACES];
+	unsigned int	heap[EPA_MAX_FACES];		// Indices of faces, min-heap by distance from origin
+	EPAHorizonEdge	horizon[EPA_MAX_HORIZON];
+	unsigned int	numVertices, numFaces, heapSize, horizonSize;
+};
+
+	// 'A' and 'B' are the concrete Collider types, so support points don't go through the vtable
+	template<class A, class B> static int GJKTest(A* _a, B* _b, Contact* contacts, CollisionWarmStart* warmStart);
 	static bool GJKDoSimplex(SupportPoint simplex[4], unsigned int& simplexIndex, Vector& d);
-	static int EPA(Collider* _a, Collider* _b, SupportPoint simplex[4], Contact* contacts);
+	// 'iterations' is set to the number of support points added to the polytope
+	template<class A, class B> static int EPA(A* _a, B* _b, SupportPoint simplex[4], Contact* contacts, unsigned int& iterations);
+	static unsigned int EPAAddFace(EPAPolytope& poly, unsigned int a, unsigned int b, unsigned int c);
+	static void EPABind(EPAPolytope& poly, unsigned int f1, unsigned int e1, unsigned int f2, unsigned int e2);
+	// Remove face 'f' if 'w' can see it and carry on to its neighbours, otherwise edge 'e' of 'f' is on the horizon
+	// Returns false if the horizon has more edges than it can hold
+	static bool EPASilhouette(EPAPolytope& poly, unsigned int f, unsigned int e, const Vector& w);
 	static void SetEPADistanceThreshold(gFloat dist);
 
+	// Find point in Simplex closest to origin, with its barycentric coordinates 'lambda'
+	// Simplex is reduced to only the vertices needed to describe that point
+	static Vector GJKClosestPointOnSimplex(SupportPoint simplex[4], unsigned int& simplexSize, gFloat lambda[4]);
+
 // ~~~~ Utility Functions for Collision Detection ~~~~
 	// Calculate the Closest Point on/in an OOBB to a Point p in space
 	static Vector ClosestPointOnOOBB(Vector p, Vector c, Vector u[3], Vector e);
@@ -140,6 +302,12 @@ struct Edge
 	// calculate distance along 2 edges (s/t) to the points on each edge closest to the other edge
 	static void ClosestPointsOnEdges(Vector a, Vector ua, Vector b, Vector ub, gFloat& s, gFloat &t);
 
+	// Calculate closest point on Triangle 'abc' to Point 'p'
+	static Vector ClosestPointOnTriangle(Vector p, Vector a, Vector b, Vector c);
+
+	// Calculate closest points 'c1' on Line Segment 'p1q1' and 'c2' on Line Segment 'p2q2'. Returns squared distance between them
+	static gFloat ClosestPointsOnSegments(Vector p1, Vector q1, Vector p2, Vector q2, Vector& c1, Vector& c2);
+
 	// Find all intersection points between 2D rectangle with vertices at (+/-h[0], +/-h[1])
 	// and 2D quadrilateral with vertices (p[0],p[1]), (p[2],p[3]), (p[4],p[5]), (p[6],p[7])
 	// Intersection points returned as x,y pairs in 'ret' array
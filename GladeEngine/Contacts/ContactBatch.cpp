@@ -2,7 +2,12 @@
 
 using namespace Glade;
 
-ContactBatch::ContactBatch() : numContacts(0) 
+unsigned int ContactBatch::nextSerial = 0;
+
+ContactBatch::ContactBatch() : head(nullptr), tail(nullptr), numContacts(0), serial(++nextSerial)
+#ifdef SOLVE_PENETRATION_SIMULTANEOUS
+			, major(nullptr)
+#endif
 { }
 
 ContactBatch::~ContactBatch() 
@@ -18,64 +23,83 @@ ContactBatch::~ContactBatch()
 
 void ContactBatch::CalculateInternals()
 {
+#ifdef SOLVE_PENETRATION_SIMULTANEOUS
+	// Nodes in list order, and the nodes touching each RigidBody: bodyNodes[bodyStarts[b]..bodyStarts[b+1])
+	std::vector<unsigned int> bodyStarts(bodies.size() + 1, 0), bodyNodes(numContacts * 2);
 	ContactBatchNode* temp = head;
-	do
+	nodes.clear();
+	for(unsigned int i = 0; i < numContacts; ++i)
 	{
-		temp->CalculateInternals();
-#ifdef SOLVE_PENETRATION_SIMULTANEOUS
-		nodes.insert(temp);
-#endif
+		temp->index = i;
+		nodes.push_back(temp);
+		++bodyStarts[temp->contact.b1->solverIndex + 1];
+		++bodyStarts[temp->contact.b2->solverIndex + 1];
 		temp = temp->GetNext();
-	} while (temp != head);
+	}
+	for(unsigned int b = 0; b < bodies.size(); ++b)
+		bodyStarts[b + 1] += bodyStarts[b];
+	std::vector<unsigned int> next(bodyStarts.begin(), bodyStarts.end() - 1);
+	for(unsigned int i = 0; i < numContacts; ++i)
+	{
+		bodyNodes[next[nodes[i]->contact.b1->solverIndex]++] = i;
+		bodyNodes[next[nodes[i]->contact.b2->solverIndex]++] = i;
+	}
 
-#ifdef SOLVE_PENETRATION_SIMULTANEOUS
+	// Breadth-first from the "most major" Contact. Contacts sharing a node's b1 go to its left, its b2 to its right
+	std::vector<bool> visited(numContacts, false);
+	unsigned int remaining = numContacts - 1;
+	if(remaining == 0)
+		return;
 	std::queue<ContactBatchNode*> queue;
-	auto nodes2 = nodes;
-	nodes2.erase(major);
-	ContactBatchNode* current;
+	ContactBatchNode* current, *other;
+	visited[major->index] = true;
 	queue.push(major);
 	while(queue.size() > 0)
 	{
 		current = queue.front();
 		queue.pop();
 
-		for(auto iter = nodes2.begin(); iter != nodes2.end();)
+		RigidBody* sides[2] = { current->contact.b1, current->contact.b2 };
+		for(unsigned int s = 0; s < 2; ++s)
 		{
-			if(current->contact.b1 == (*iter)->contact.b1 || current->contact.b1 == (*iter)->contact.b2)
+			unsigned int b = sides[s]->solverIndex;
+			for(unsigned int k = bodyStarts[b]; k < bodyStarts[b + 1]; ++k)
 			{
-				if(current->contact.b1 == (*iter)->contact.b2)
-					(*iter)->contact.ReverseContact();
-				current->AddLeft(*iter);
-				queue.push(*iter);
-				nodes2.erase(iter++);
-				if(nodes2.size() == 0)
-					return;
-			}
-			else if(current->contact.b2 == (*iter)->contact.b1 || current->contact.b2 == (*iter)->contact.b2)
-			{
-				if(current->contact.b2 == (*iter)->contact.b1)
-					(*iter)->contact.ReverseContact();
-				current->AddRight(*iter);
-				queue.push(*iter);
-				nodes2.erase(iter++);
-				if(nodes2.size() == 0)
+				other = nodes[bodyNodes[k]];
+				if(visited[other->index])
+					continue;
+
+				// Shared RigidBody is on the same side in both Contacts
+				if(s == 0)
+				{
+					if(sides[0] == other->contact.b2)
+						other->contact.ReverseContact();
+					current->AddLeft(other);
+				}
+				else
+				{
+					if(sides[1] == other->contact.b1)
+						other->contact.ReverseContact();
+					current->AddRight(other);
+				}
+				visited[other->index] = true;
+				queue.push(other);
+				if(--remaining == 0)
 					return;
 			}
-			else
-				++iter;
 		}
 	}
 #endif
 }
 
 // Add a new Contact to this Batch
-void ContactBatch::AddContact(Contact c)
+void ContactBatch::AddContact(const Contact& c)
 {
 	ContactBatchNode* node = new ContactBatchNode(c);
 #ifdef SOLVE_PENETRATION_SIMULTANEOUS
-	if(major == nullptr || c.HasInfiniteMass() ||		// Any Contact with an infinitely massed body is "most major"
-		(!major->contact.HasInfiniteMass() && c.relativeVelocity > major->contact.relativeVelocity) || // If no infinitely massed body, then the Contact with the highest relative velocity
-		(!major->contact.HasInfiniteMass() && c.relativeVelocity == major->contact.relativeVelocity && c.point.y > major->contact.point.y))	// Otherwise, the highest Contact position
+	// Relative velocity is only known once ContactConstraints are prepared, so it can't be used to pick the "most major" Contact
+	if(major == nullptr || node->contact.HasInfiniteMass() ||		// Any Contact with an infinitely massed body is "most major"
+		(!major->contact.HasInfiniteMass() && c.point.y > major->contact.point.y))	// Otherwise, the highest Contact position
 	{
 		major = node;
 	}
@@ -104,21 +128,24 @@ void ContactBatch::AddContact(Contact c)
 	}
 
 	++numContacts;
-	ids.insert(c.b1->GetID());
-	ids.insert(c.b2->GetID());
+	AddBody(c.b1);
+	AddBody(c.b2);
 }
 
-void ContactBatch::MergeBatch(ContactBatch* batch)
+void ContactBatch::AddBody(RigidBody* body)
 {
-#ifdef SOLVE_PENETRATION_SIMULTANEOUS
-	if(batch->major->contact.HasInfiniteMass() ||		// Any Contact with an infinitely massed body is "most major"
-		(!batch->major->contact.HasInfiniteMass() && major->contact.relativeVelocity > batch->major->contact.relativeVelocity) || // If no infinitely massed body, then the Contact with the highest relative velocity
-		(!batch->major->contact.HasInfiniteMass() && major->contact.relativeVelocity == batch->major->contact.relativeVelocity && major->contact.point.y > batch->major->contact.point.y))	// Otherwise, the highest Contact position
-	{
-		major = batch->major;
-	}
-#endif
+	if(body->solverBatch == serial)
+		return;
+	body->solverBatch = serial;
+	body->solverIndex = bodies.size();
+	bodies.push_back(body);
+}
 
+void ContactBatch::MergeBatch(ContactBatch* batch)
+{
+	// Contacts are copied into new nodes, and AddContact picks the "most major" one out of them as they go
+	// (keeping 'batch's major node would leave it pointing into 'batch' once that is deleted)
+	// Their RigidBodies are given indices in this Batch
 	ContactBatchNode* head = batch->GetHead();
 	ContactBatchNode* temp = head;
 	do
@@ -134,4 +161,6 @@ ContactBatchNode* ContactBatch::GetTail() { return tail; }
 ContactBatchNode* ContactBatch::GetMajor() { return major; }
 #endif
 unsigned int ContactBatch::GetNumContacts() { return numContacts; }
-unsigned int ContactBatch::ContainsRigidBodies(unsigned int id1, unsigned int id2) { return ids.count(id1) + ids.count(id2); }
\ No newline at end of file
+unsigned int ContactBatch::ContainsRigidBodies(RigidBody* b1, RigidBody* b2) { return (b1->solverBatch == serial) + (b2->solverBatch == serial); }
+unsigned int ContactBatch::GetNumBodies() { return bodies.size(); }
+RigidBody* ContactBatch::GetBody(unsigned int i) { return bodies[i]; }
\ No newline at end of file
@@ -6,7 +6,6 @@
 #include "Contact.h"
 #endif
 
-#include <set>
 #include <vector>
 #include <queue>
 
@@ -15,12 +14,11 @@ namespace Glade {
 class ContactBatchNode
 {
 public:
-	ContactBatchNode() : next(nullptr), previous(nullptr) { }
-	ContactBatchNode(Contact c) : contact(c), next(nullptr), previous(nullptr) { }
+	ContactBatchNode() : index(0), next(nullptr), previous(nullptr) { }
+	ContactBatchNode(const Contact& c) : contact(c), index(0), next(nullptr), previous(nullptr) { }
 
-	void CalculateInternals() { contact.CalculateInternals(); }
-
-	Contact GetContact() { return contact; }
+	Contact& GetContact() { return contact; }
+	unsigned int GetIndex() { return index; }
 	ContactBatchNode* GetNext() { return next; }
 	ContactBatchNode* GetPrevious() { return previous; }
 	void SetNext(ContactBatchNode* n) { next = n; }
@@ -35,9 +33,11 @@ public:
 #endif
 
 	friend class ContactResolver;
+	friend class ContactConstraints;
 
 private:
 	Contact				contact;
+	unsigned int		index;		// Index of this Contact's solver data in ContactConstraints
 	ContactBatchNode*	next;
 	ContactBatchNode*	previous;
 #ifdef SOLVE_PENETRATION_SIMULTANEOUS
@@ -59,14 +59,14 @@ public:
 	ContactBatch();
 	~ContactBatch();
 
-	// Iterate through all Contacts and call their 'CalculateInternals' function
+	// Prepare Contacts for resolution. Solver data itself is built afterwards by ContactConstraints
 	// If/When using Simultaneous Interpenetration Resolution, this generates the Graph of Contacts
 	// with the root being the 'most major' Contact
 	void CalculateInternals();
 
 	// Add a new Contact to this Batch
 	// If/When using Simultaneous Interpenetration Resolution, tests if new Contact should be the 'most major' Contact in the Batch
-	void AddContact(Contact c);
+	void AddContact(const Contact& c);
 
 	// Adds all Contacts in another Batch to this Batch
 	// If/When using Simultaneous Interpenetration Resolution, chooses the new 'most major' Contact
@@ -79,17 +79,28 @@ public:
 	ContactBatchNode* GetMajor();
 #endif
 	unsigned int GetNumContacts();
-	unsigned int ContainsRigidBodies(unsigned int id1, unsigned int id2);
+	// Number of 'b1' and 'b2' (0, 1 or 2) already in this Batch
+	unsigned int ContainsRigidBodies(RigidBody* b1, RigidBody* b2);
+
+	// RigidBodies touched by this Batch's Contacts. Each RigidBody's solverIndex is its index here,
+	// so per-body solver data can be kept in flat arrays instead of looked up by pointer
+	unsigned int GetNumBodies();
+	RigidBody* GetBody(unsigned int i);
 	friend class ContactResolver;
 
 private:
+	// Give 'body' the next index in this Batch if it doesn't have one yet
+	void AddBody(RigidBody* body);
+
 	ContactBatchNode* head;
 	ContactBatchNode* tail;
 	unsigned int numContacts;
-	std::set<unsigned int> ids;
+	std::vector<RigidBody*> bodies;
+	unsigned int serial;				// Unique to this Batch, stamped on its RigidBodies as their solverBatch
+	static unsigned int nextSerial;
 
 #ifdef SOLVE_PENETRATION_SIMULTANEOUS
-	std::set<ContactBatchNode*> nodes;
+	std::vector<ContactBatchNode*> nodes;	// In list order, so each node's index is its place here
 	ContactBatchNode* major;
 #endif
 };
@@ -0,0 +1,878 @@
+#include "ContactConstraints.h"
+
+using namespace Glade;
+
+ContactConstraints::ContactConstraints() : size(0)
+#ifdef PARALLEL_CONTACT_SOLVE
+			, numColors(0)
+#endif
+{ }
+
+void ContactConstraints::Prepare(ContactBatch* batch)
+{
+	size = batch->GetNumContacts();
+	if(contacts.size() < size)
+	{
+		contacts.resize(size);
+		normals.resize(size);
+		tangents1.resize(size);
+		tangents2.resize(size);
+		relativeVelocities.resize(size);
+		desiredDeltaVels.resize(size);
+		penetrations.resize(size);
+		b1ContactPoints.resize(size);
+		b2ContactPoints.resize(size);
+		for(unsigned int j = 0; j < 2; ++j)
+		{
+			linearInertias[j].resize(size);
+			angularInertias[j].resize(size);
+		}
+#ifdef SOLVE_VELOCITY_PGS
+		accumulatedImpulses.resize(size);
+		effectiveMasses.resize(size);
+		targetVelocities.resize(size);
+		for(unsigned int j = 0; j < 2; ++j)
+			for(unsigned int k = 0; k < 3; ++k)
+				impulseRotations[j][k].resize(size);
+#endif
+	}
+
+	// Constraints are in the same order as the Batch's list of Contacts
+	ContactBatchNode* node = batch->GetHead();
+	for(unsigned int i = 0; i < size; ++i)
+	{
+		node->index = i;
+		contacts[i] = &node->contact;
+		CalculateInternals(i);
+#ifdef SOLVE_VELOCITY_PGS
+		PrepareSequentialImpulse(i);
+#endif
+		node = node->GetNext();
+	}
+
+#ifdef SOLVE_WORST_CONTACT_FIRST
+	BuildBodyAdjacency(batch);
+#endif
+#ifdef PARALLEL_CONTACT_SOLVE
+	ColorConstraints(batch);
+#endif
+}
+
+unsigned int ContactConstraints::GetSize() const { return size; }
+
+#ifdef SOLVE_WORST_CONTACT_FIRST
+void ContactConstraints::BuildBodyAdjacency(ContactBatch* batch)
+{
+	// Counting sort of Contacts by their RigidBodies' solverIndex. Group g belongs to RigidBody g of the Batch
+	unsigned int numBodies = batch->GetNumBodies();
+	bodyStarts.assign(numBodies + 1, 0);
+	contactBodyGroups[0].resize(size);
+	contactBodyGroups[1].resize(size);
+	for(unsigned int i = 0; i < size; ++i)
+	{
+		RigidBody* bodies[2] = { contacts[i]->b1, contacts[i]->b2 };
+		for(unsigned int b = 0; b < 2; ++b)
+		{
+			contactBodyGroups[b][i] = NO_BODY_GROUP;
+			if(bodies[b] != nullptr && bodies[b]->GetInverseMass() != gFloat(0.0f))
+			{
+				contactBodyGroups[b][i] = bodies[b]->solverIndex;
+				++bodyStarts[bodies[b]->solverIndex + 1];
+			}
+		}
+	}
+	for(unsigned int g = 0; g < numBodies; ++g)
+		bodyStarts[g + 1] += bodyStarts[g];
+
+	bodyContacts.resize(bodyStarts[numBodies]);
+	bodyNext.assign(bodyStarts.begin(), bodyStarts.end() - 1);
+	for(unsigned int i = 0; i < size; ++i)
+		for(unsigned int b = 0; b < 2; ++b)
+			if(contactBodyGroups[b][i] != NO_BODY_GROUP)
+				bodyContacts[bodyNext[contactBodyGroups[b][i]]++] = i;
+}
+#endif
+
+#ifdef PARALLEL_CONTACT_SOLVE
+void ContactConstraints::ColorConstraints(ContactBatch* batch)
+{
+	bodyColors.assign(batch->GetNumBodies(), 0);
+	colorStarts.assign(MAX_CONTACT_COLORS + 2, 0);
+	contactColors.resize(size);
+	numColors = 0;
+
+	// Lowest colour neither of the Contact's movable RigidBodies has yet
+	for(unsigned int i = 0; i < size; ++i)
+	{
+		RigidBody* bodies[2] = { contacts[i]->b1, contacts[i]->b2 };
+		unsigned long long used = 0;
+		for(unsigned int b = 0; b < 2; ++b)
+			if(bodies[b] != nullptr && bodies[b]->GetInverseMass() != gFloat(0.0f))
+				used |= bodyColors[bodies[b]->solverIndex];
+
+		unsigned int color = 0;
+		while(color < MAX_CONTACT_COLORS && (used & (1ull << color)))
+			++color;
+		if(color < MAX_CONTACT_COLORS)
+		{
+			for(unsigned int b = 0; b < 2; ++b)
+				if(bodies[b] != nullptr && bodies[b]->GetInverseMass() != gFloat(0.0f))
+					bodyColors[bodies[b]->solverIndex] |= 1ull << color;
+		}
+		contactColors[i] = color;
+		++colorStarts[color + 1];
+		if(color >= numColors)
+			numColors = color + 1;
+	}
+
+	// Counting sort by colour, keeping Batch order within each colour
+	for(unsigned int c = 0; c < numColors; ++c)
+		colorStarts[c + 1] += colorStarts[c];
+	colorContacts.resize(size);
+	colorNext.assign(colorStarts.begin(), colorStarts.begin() + numColors);
+	for(unsigned int i = 0; i < size; ++i)
+		colorContacts[colorNext[contactColors[i]]++] = i;
+}
+#endif
+
+void ContactConstraints::CalculateInternals(unsigned int i)
+{
+	Contact& contact = *contacts[i];
+	if(contact.b1 == nullptr) contact.ReverseContact();
+
+	normals[i] = contact.normal;
+	penetrations[i] = contact.penetrationDepth;
+	CalculateContactBasis(i);
+
+	// Calculate relative position of Contact Point to each RigidBody
+	b1ContactPoints[i] = (contact.point - contact.b1->GetCentroid()).Cleanse();
+	if(contact.b2 != nullptr)	b2ContactPoints[i] = (contact.point - contact.b2->GetCentroid()).Cleanse();
+
+	// Calculate relative velocity of RigidBodies at Contact Point
+	relativeVelocities[i] = CalculateLocalVelocity(i, 1);
+	if(contact.b2 != nullptr) relativeVelocities[i] -= CalculateLocalVelocity(i, 2);
+
+	// Calculate desired change in velocity to resolve Contact
+	CalculateDesiredDeltaVelocity(i);
+}
+
+void ContactConstraints::ResolveImpulse(unsigned int i, Vector (&deltaVel)[2], Vector (&deltaAngVel)[2])
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	const Vector& b1ContactPoint = b1ContactPoints[i];
+	const Vector& b2ContactPoint = b2ContactPoints[i];
+	Vector contactImpulse;
+	Matrix inverseInertiaTensorWorld[2];
+	b1->GetInverseInertiaTensorWorld(&inverseInertiaTensorWorld[0]);
+	if(b2 != nullptr) b2->GetInverseInertiaTensorWorld(&inverseInertiaTensorWorld[1]);
+
+	if(contacts[i]->staticFriction == gFloat(0.0f) ||	// static always larger than dynamic, so only need to check if static is 0
+		penetrations[i] < gFloat(0.0f))	// Speculative Contacts aren't touching yet, so no friction
+		contactImpulse = CalcImpulseNoFriction(i, inverseInertiaTensorWorld);
+	else
+		contactImpulse = CalcImpulseFriction(i, inverseInertiaTensorWorld);
+
+	// Convert impulse to World space
+	Vector impulse = ContactToWorld(i, contactImpulse);
+
+	ResolveImpulse2(i, deltaVel, deltaAngVel);
+
+	// Split impulse into linear and rotational components
+	Vector impulsiveTorque = b1ContactPoint.CrossProduct(impulse);
+//	Vector impulsiveTorque = impulse.CrossProduct(b1ContactPoint);
+	deltaAngVel[0] = impulsiveTorque * inverseInertiaTensorWorld[0];
+//	deltaAngVel[0] *= DEG2RAD;
+	deltaVel[0] = impulse * b1->GetInverseMass();
+
+	// Apply
+	b1->ForceAddVelocity(deltaVel[0]);
+	b1->ForceAddAngularVelocity(deltaAngVel[0]);
+
+	if(b2 != nullptr)
+	{
+		//impulsiveTorque = b2ContactPoint.CrossProduct(impulse);
+		impulsiveTorque = impulse.CrossProduct(b2ContactPoint);
+		deltaAngVel[1] = impulsiveTorque * inverseInertiaTensorWorld[1];
+		deltaVel[1] = impulse * -b2->GetInverseMass();
+
+		b2->ForceAddVelocity(deltaVel[1]);
+		b2->ForceAddAngularVelocity(deltaAngVel[1]);
+	}
+
+	if(b1->GetInverseMass() == 0 || (b2 != nullptr) && b2->GetInverseMass() != 0)
+	{
+		b1->SetSolved();
+		b2->SetSolved();
+	}
+}
+
+void ContactConstraints::ResolveImpulse2(unsigned int i, Vector (&deltaVel)[2], Vector (&deltaAngVel)[2])
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	const Vector& normal = normals[i];
+	const Vector& b1ContactPoint = b1ContactPoints[i];
+	const Vector& b2ContactPoint = b2ContactPoints[i];
+	Vector j = (relativeVelocities[i] * -(1.0f + contacts[i]->coeffRestitution)) / 
+			(b1->GetInverseMass() + b2->GetInverseMass() + 
+			((b1ContactPoint.CrossProduct(normal)*b1->GetInverseInertiaTensorWorld()).CrossProduct(b1ContactPoint) + 
+			(b2ContactPoint.CrossProduct(normal)*b2->GetInverseInertiaTensorWorld()).CrossProduct(b2ContactPoint)).DotProduct(normal)
+			);
+	
+	Vector tangent = (relativeVelocities[i] - normal * (relativeVelocities[i].DotProduct(normal))).Normalized();
+	Vector impulseVec = normal * j.DotProduct(normal);
+	Vector frictionVec = tangent * j.DotProduct(tangent);
+	gFloat frictionMax = impulseVec.Magnitude() * contacts[i]->staticFriction;
+	if(frictionVec.Magnitude() > frictionMax)
+	{
+		frictionVec.NormalizeInPlace();
+		// gFloat mu = Sqrt(b1->DynamicFriction^2 + b2->DynamicFriction^2)
+		frictionVec *= impulseVec.Magnitude() * contacts[i]->dynamicFriction;
+	}
+
+	j = frictionVec + -impulseVec;
+// ~~~~ NO FRICTION ~~~~
+	deltaVel[0] = (j) * b1->GetInverseMass();
+	deltaVel[1] = (j) * b2->GetInverseMass();
+	deltaAngVel[0] = (b1ContactPoint.CrossProduct(j)) * b1->GetInverseInertiaTensorWorld();
+	deltaAngVel[1] = (b2ContactPoint.CrossProduct(j)) * b2->GetInverseInertiaTensorWorld();
+// ~~~~~~~~~~~~~~~~~~~~~
+
+
+
+
+//	b1->ForceAddVelocity(deltaVel[0]);
+//	b1->ForceAddAngularVelocity(deltaAngVel[0]);
+//	b2->ForceAddVelocity(deltaVel[1]);
+//	b2->ForceAddAngularVelocity(deltaAngVel[1]);
+}
+
+#ifdef SOLVE_VELOCITY_PGS
+void ContactConstraints::PrepareSequentialImpulse(unsigned int i)
+{
+	RigidBody* bodies[2] = { contacts[i]->b1, contacts[i]->b2 };
+	Vector relativeContactPoint[2] = { b1ContactPoints[i], b2ContactPoints[i] };
+	Vector axes[3] = { tangents1[i], normals[i], tangents2[i] };
+	Matrix inverseInertiaTensorWorld;
+	gFloat deltaVel[3] = { gFloat(0.0f), gFloat(0.0f), gFloat(0.0f) };
+
+	// Change in relative velocity along each axis per unit of impulse along it, from both RigidBodies
+	for(unsigned int b = 0; b < 2; ++b)
+	{
+		if(bodies[b] == nullptr)
+		{
+			for(unsigned int k = 0; k < 3; ++k)
+				impulseRotations[b][k][i].Zero();
+			continue;
+		}
+
+		bodies[b]->GetInverseInertiaTensorWorld(&inverseInertiaTensorWorld);
+		for(unsigned int k = 0; k < 3; ++k)
+		{
+			impulseRotations[b][k][i] = relativeContactPoint[b].CrossProduct(axes[k]) * inverseInertiaTensorWorld;
+			deltaVel[k] += bodies[b]->GetInverseMass() + impulseRotations[b][k][i].CrossProduct(relativeContactPoint[b]).DotProduct(axes[k]);
+		}
+	}
+	effectiveMasses[i] = Vector(deltaVel[0] > gFloat(0.0f) ? gFloat(1.0f) / deltaVel[0] : gFloat(0.0f),
+								deltaVel[1] > gFloat(0.0f) ? gFloat(1.0f) / deltaVel[1] : gFloat(0.0f),
+								deltaVel[2] > gFloat(0.0f) ? gFloat(1.0f) / deltaVel[2] : gFloat(0.0f));
+
+	// Speculative Contacts may close their gap this step. Touching Contacts stop, or bounce by the same
+	// restitution the desired velocity change uses
+	if(penetrations[i] < gFloat(0.0f))
+		targetVelocities[i] = -penetrations[i] / PHYSICS_TIMESTEP;
+	else
+		targetVelocities[i] = Min(relativeVelocities[i].y + desiredDeltaVels[i], gFloat(0.0f));
+
+	accumulatedImpulses[i].Zero();
+}
+
+Vector ContactConstraints::CalculateRelativeVelocity(unsigned int i) const
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	Vector velocity = b1->GetVelocity() + b1->GetAngularVelocity().CrossProduct(b1ContactPoints[i]);
+	if(b2 != nullptr)
+		velocity -= b2->GetVelocity() + b2->GetAngularVelocity().CrossProduct(b2ContactPoints[i]);
+	return WorldToContact(i, velocity);
+}
+
+void ContactConstraints::ApplyImpulse(unsigned int i, unsigned int axis, gFloat impulse)
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	Vector direction = axis == 0 ? tangents1[i] : (axis == 1 ? normals[i] : tangents2[i]);
+
+	// RigidBodies with infinite mass wouldn't change anyway. Leaving them alone means Contacts solved on other
+	// threads can share them
+	if(b1->GetInverseMass() != gFloat(0.0f))
+	{
+		b1->ForceAddVelocity(direction * (-impulse * b1->GetInverseMass()));
+		b1->ForceAddAngularVelocity(impulseRotations[0][axis][i] * -impulse);
+	}
+	if(b2 != nullptr && b2->GetInverseMass() != gFloat(0.0f))
+	{
+		b2->ForceAddVelocity(direction * (impulse * b2->GetInverseMass()));
+		b2->ForceAddAngularVelocity(impulseRotations[1][axis][i] * impulse);
+	}
+}
+
+void ContactConstraints::SolveSequentialImpulse(unsigned int i)
+{
+	Vector& accumulated = accumulatedImpulses[i];
+	const Vector& masses = effectiveMasses[i];
+	Vector velocity = CalculateRelativeVelocity(i);
+	gFloat old;
+
+	// Friction - stop sliding, but the total can't leave the cone the normal impulse so far allows
+	// Speculative Contacts aren't touching yet, so no friction
+	if(penetrations[i] >= gFloat(0.0f) && contacts[i]->dynamicFriction > gFloat(0.0f))
+	{
+		Vector oldFriction(accumulated.x, gFloat(0.0f), accumulated.z);
+		accumulated.x += velocity.x * masses.x;
+		accumulated.z += velocity.z * masses.z;
+		gFloat maxFriction = accumulated.y * contacts[i]->dynamicFriction;
+		gFloat friction = Sqrt(accumulated.x * accumulated.x + accumulated.z * accumulated.z);
+		if(friction > maxFriction)
+		{
+			accumulated.x *= maxFriction / friction;
+			accumulated.z *= maxFriction / friction;
+		}
+		ApplyImpulse(i, 0, accumulated.x - oldFriction.x);
+		ApplyImpulse(i, 2, accumulated.z - oldFriction.z);
+		velocity.y = CalculateRelativeVelocity(i).y;
+	}
+
+	// Normal - the total may only push the RigidBodies apart
+	old = accumulated.y;
+	accumulated.y = Max(old + (velocity.y - targetVelocities[i]) * masses.y, gFloat(0.0f));
+	ApplyImpulse(i, 1, accumulated.y - old);
+}
+#endif
+
+void ContactConstraints::ResolveInterpenetration(unsigned int i, Vector (&deltaPos)[2], Vector (&deltaOrient)[2], gFloat pen)
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	const Vector& normal = normals[i];
+	const Vector& b1ContactPoint = b1ContactPoints[i];
+	const Vector& b2ContactPoint = b2ContactPoints[i];
+	const gFloat angularLimit = (gFloat)0.2f;
+	gFloat angularMove[2];
+	gFloat linearMove[2];
+	gFloat totalInertia = 0;
+	gFloat linearInertia[2];
+	gFloat angularInertia[2];
+
+	// Work out inertia of each RigidBody due to angular inertia in direction of Contact normal
+	RigidBody* bodies[2] = { b1, b2 };
+	Vector relativeContactPoint[2] = { b1ContactPoint, b2ContactPoint };
+	for(unsigned int b = 0; b < 2; ++b) if(bodies[b])
+	{
+		Matrix inverseInertiaTensor = bodies[b]->GetInverseInertiaTensorWorld();
+
+		// Use same procedure for calculating frictionless velocity change to work out angular inertia
+		Vector angularInertiaWorld = relativeContactPoint[b].CrossProduct(normal);
+		angularInertiaWorld *= inverseInertiaTensor;
+		angularInertiaWorld = angularInertiaWorld.CrossProduct(relativeContactPoint[b]);
+//		Vector angularInertiaWorld = normal.CrossProduct(relativeContactPoint[b]);
+//		angularInertiaWorld *= inverseInertiaTensor;
+//		angularInertiaWorld = relativeContactPoint[b].CrossProduct(angularInertiaWorld);
+		angularInertia[b] = angularInertiaWorld.DotProduct(normal);
+
+		// Linear component is simply inverse mass
+		linearInertia[b] = bodies[b]->GetInverseMass();
+
+		// Track total inertia from all components
+		totalInertia += linearInertia[b] + angularInertia[b];
+	}
+
+	// Calculate and apply changes
+	for(unsigned int b = 0; b < 2; ++b) if(bodies[b])
+	{
+		gFloat sign = (b == 0) ? -1 : 1;
+
+		angularMove[b] = sign * pen * (angularInertia[b] / totalInertia);
+		linearMove[b] = sign * pen * (linearInertia[b] / totalInertia);
+
+		// Limit angular move to avoid angular projections that are too great
+		// (when mass is large, but inertia tensor is small)
+		Vector projection = relativeContactPoint[b] + (normal * (-relativeContactPoint[b].DotProduct(normal)));
+
+		// Use small angle approximation for the sine of the angle
+		// (i.e. magnitude would be sin(angularLimit) * projection.Magitude(), but we 
+		//		approximate sin(angularLimit) to angularLimit
+		gFloat maxMagnitude = angularLimit * projection.Magnitude();
+
+		if(angularMove[b] < -maxMagnitude)
+		{
+			gFloat totalMove = angularMove[b] + linearMove[b];
+			angularMove[b] = -maxMagnitude;
+			linearMove[b] = totalMove - angularMove[b];
+		}
+		else if(angularMove[b] > maxMagnitude)
+		{
+			gFloat totalMove = angularMove[b] + linearMove[b];
+			angularMove[b] = maxMagnitude;
+			linearMove[b] = totalMove - angularMove[b];
+		}
+
+		// We have linear amount of movement required by turning the RigidBody in angularMove[b]
+		// We now need to calculate desired rotation to achieve that
+		if(angularMove[b] == 0)
+			deltaOrient[b].Zero();
+		else // Work out the direction to rotate
+			deltaOrient[b] = (relativeContactPoint[b].CrossProduct(normal) * bodies[b]->GetInverseInertiaTensorWorld()) * (angularMove[b] / angularInertia[b]);
+		
+		// Position change is just linear movement along Contact normal
+		deltaPos[b] = normal * linearMove[b];
+
+		// Apply
+		bodies[b]->ForceAddPosition(deltaPos[b]);
+		bodies[b]->ForceAddOrientation(deltaOrient[b]);
+
+		// Recalculate derived data for sleeping RigidBodies now that the changes are applied
+		//  (Awake bodies will automatically do this after Integration)
+		if(!bodies[b]->GetAwake())
+			bodies[b]->CalcDerivedData();
+	}
+}
+
+void ContactConstraints::CalculateInertia(unsigned int i)
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	const Vector& normal = normals[i];
+	const Vector& b1ContactPoint = b1ContactPoints[i];
+	const Vector& b2ContactPoint = b2ContactPoints[i];
+	// Body 1 Inertia
+	// Work out inertia of RigidBody due to angular inertia in direction of Contact normal
+	Vector angularInertiaWorld = b1ContactPoint.CrossProduct(normal);
+	angularInertiaWorld *= b1->GetInverseInertiaTensorWorld();
+	angularInertiaWorld = angularInertiaWorld.CrossProduct(b1ContactPoint);
+	angularInertias[0][i] = angularInertiaWorld.DotProduct(normal);
+	linearInertias[0][i] = b1->GetInverseMass();		// Linear component is simply inverse mass
+		
+	// Body 2 Inertia
+	angularInertiaWorld = b2ContactPoint.CrossProduct(normal);
+	angularInertiaWorld *= b2->GetInverseInertiaTensorWorld();
+	angularInertiaWorld = angularInertiaWorld.CrossProduct(b2ContactPoint);
+	angularInertias[1][i] = angularInertiaWorld.DotProduct(normal);
+	linearInertias[1][i] = b2->GetInverseMass();
+}
+
+void ContactConstraints::CalculatePenetrationResolution(unsigned int i, Vector (&deltaPos)[2], Vector (&deltaOrient)[2], gFloat pen)
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	const Vector& normal = normals[i];
+	const Vector& b1ContactPoint = b1ContactPoints[i];
+	const Vector& b2ContactPoint = b2ContactPoints[i];
+	const gFloat angularLimit = gFloat(0.2f);
+	gFloat angularMove[2];
+	gFloat linearMove[2];
+	RigidBody* bodies[2] = { b1, b2 };
+	Vector relativeContactPoint[2] = { b1ContactPoint, b2ContactPoint };
+
+	// Nothing to push apart (Speculative Contact)
+	if(pen <= gFloat(0.0f))
+	{
+		deltaPos[0].Zero(); deltaPos[1].Zero();
+		deltaOrient[0].Zero(); deltaOrient[1].Zero();
+		return;
+	}
+	
+	// Total Inertia of RigidBodies is simply sum of their linear and angular inertia
+	gFloat totalInertia = linearInertias[0][i] + linearInertias[1][i] + angularInertias[0][i] + angularInertias[1][i];
+
+	// Calculate and apply changes
+	for(unsigned int b = 0; b < 2; ++b) if(bodies[b])
+	{
+		gFloat sign = (b == 0) ? -1 : 1;
+
+		angularMove[b] = sign * pen * (angularInertias[b][i] / totalInertia);
+		linearMove[b] = sign * pen * (linearInertias[b][i] / totalInertia);
+
+		// Limit angular move to avoid angular projections that are too great
+		// (when mass is large, but inertia tensor is small)
+		Vector projection = relativeContactPoint[b] + (normal * (-relativeContactPoint[b].DotProduct(normal)));
+
+		// Use small angle approximation for the sine of the angle
+		// (i.e. magnitude would be sin(angularLimit) * projection.Magitude(), but we 
+		//		approximate sin(angularLimit) to angularLimit
+		gFloat maxMagnitude = angularLimit * projection.Magnitude();
+
+		if(angularMove[b] < -maxMagnitude)
+		{
+			gFloat totalMove = angularMove[b] + linearMove[b];
+			angularMove[b] = -maxMagnitude;
+			linearMove[b] = totalMove - angularMove[b];
+		}
+		else if(angularMove[b] > maxMagnitude)
+		{
+			gFloat totalMove = angularMove[b] + linearMove[b];
+			angularMove[b] = maxMagnitude;
+			linearMove[b] = totalMove - angularMove[b];
+		}
+
+		// We have linear amount of movement required by turning the RigidBody in angularMove[b]
+		// We now need to calculate desired rotation to achieve that
+		if(angularMove[b] != gFloat(0.0f))
+			deltaOrient[b] = (relativeContactPoint[b].CrossProduct(normal) * bodies[b]->GetInverseInertiaTensorWorld()) * (angularMove[b] / angularInertias[b][i]);
+		
+		// Position change is just linear movement along Contact normal
+		deltaPos[b] = normal * linearMove[b];
+
+		/* DO NOT DO THIS UNTIL ALL RESOLUTIONS ARE CALCULATED
+		// Apply
+		bodies[b]->ForceAddPosition(deltaPos[b]);
+		bodies[b]->ForceAddOrientation(deltaOrient[b]);
+
+		// Recalculate derived data for sleeping RigidBodies now that the changes are applied
+		//  (Awake bodies will automatically do this after Integration)
+		if(!bodies[b]->GetAwake())
+			bodies[b]->CalcDerivedData();
+		*/
+	}
+}
+
+// Assuming B2 is Infinite Mass/Inertia because it has already been solved
+
+void ContactConstraints::CalculatePenetrationResolutionB1(unsigned int i, Vector& deltaPos, Vector& deltaOrient, gFloat pen)
+{
+	RigidBody* b1 = contacts[i]->b1;
+	const Vector& normal = normals[i];
+	const Vector& b1ContactPoint = b1ContactPoints[i];
+	const gFloat angularLimit = gFloat(0.2f);
+
+	// Nothing to push apart (Speculative Contact)
+	if(pen <= gFloat(0.0f))
+	{
+		deltaPos.Zero();
+		deltaOrient.Zero();
+		return;
+	}
+	
+	// Total Inertia of RigidBody is sum of linear and angular inertia
+	gFloat totalInertia = linearInertias[0][i] + angularInertias[0][i];
+
+	// Calculate and apply changes
+	gFloat angularMove = gFloat(-1.0f) * pen * (angularInertias[0][i] / totalInertia);
+	gFloat linearMove = gFloat(-1.0f) * pen * (linearInertias[0][i] / totalInertia);
+
+	// Limit angular move to avoid angular projections that are too great
+	//	(when mass is large, but inertia tensor is small)
+	Vector projection = b1ContactPoint + (normal * (-b1ContactPoint.DotProduct(normal)));
+
+	// Use small angle approximation for the sine of the angle
+	// (i.e. magnitude would be sine(angularLimit) * projection.Magnitude(), but we
+	//		approximate sin(angularLimit) to angularLimit
+	gFloat maxMagnitude = angularLimit * projection.Magnitude();
+
+	if(angularMove < -maxMagnitude)
+	{
+		gFloat totalMove = angularMove + linearMove;
+		angularMove = -maxMagnitude;
+		linearMove = totalMove - angularMove;
+	}
+	else if(angularMove > maxMagnitude)
+	{
+		gFloat totalMove = angularMove + linearMove;
+		angularMove = maxMagnitude;
+		linearMove = totalMove - angularMove;
+	}
+
+	// We have linear amount of movement require by turning the RigidBody in angularMove
+	// We node need to calculate desired rotation to achieve that
+	if(angularMove != gFloat(0.0f))
+		deltaOrient = (b1ContactPoint.CrossProduct(normal) * b1->GetInverseInertiaTensorWorld()) * (angularMove / angularInertias[0][i]);
+
+	// Position change is just linear movement along Contact normal
+	deltaPos = normal * linearMove;
+
+	// Apply
+	b1->ForceAddPosition(deltaPos);
+	b1->ForceAddOrientation(deltaOrient);
+
+	// Recalculate derived data fro sleeping RigidBodies now that the changes are applied
+	//	(Awake bodies will automatically do this after integration)
+	if(!b1->GetAwake())
+		b1->CalcDerivedData();
+}
+
+void ContactConstraints::CalculatePenetrationResolutionB2(unsigned int i, Vector& deltaPos, Vector& deltaOrient, gFloat pen)
+{
+	RigidBody* b2 = contacts[i]->b2;
+	const Vector& normal = normals[i];
+	const Vector& b2ContactPoint = b2ContactPoints[i];
+	const gFloat angularLimit = gFloat(0.2f);
+
+	// Nothing to push apart (Speculative Contact)
+	if(pen <= gFloat(0.0f))
+	{
+		deltaPos.Zero();
+		deltaOrient.Zero();
+		return;
+	}
+	
+	// Total Inertia of RigidBody is sum of linear and angular inertia
+	gFloat totalInertia = linearInertias[1][i] + angularInertias[1][i];
+
+	// Calculate and apply changes
+	gFloat angularMove = pen * (angularInertias[1][i] / totalInertia);
+	gFloat linearMove = pen * (linearInertias[1][i] / totalInertia);
+
+	// Limit angular move to avoid angular projections that are too great
+	//	(when mass is large, but inertia tensor is small)
+	Vector projection = b2ContactPoint + (normal * (-b2ContactPoint.DotProduct(normal)));
+
+	// Use small angle approximation for the sine of the angle
+	// (i.e. magnitude would be sine(angularLimit) * projection.Magnitude(), but we
+	//		approximate sin(angularLimit) to angularLimit
+	gFloat maxMagnitude = angularLimit * projection.Magnitude();
+
+	if(angularMove < -maxMagnitude)
+	{
+		gFloat totalMove = angularMove + linearMove;
+		angularMove = -maxMagnitude;
+		linearMove = totalMove - angularMove;
+	}
+	else if(angularMove > maxMagnitude)
+	{
+		gFloat totalMove = angularMove + linearMove;
+		angularMove = maxMagnitude;
+		linearMove = totalMove - angularMove;
+	}
+
+	// We have linear amount of movement require by turning the RigidBody in angularMove
+	// We node need to calculate desired rotation to achieve that
+	if(angularMove != gFloat(0.0f))
+		deltaOrient = (b2ContactPoint.CrossProduct(normal) * b2->GetInverseInertiaTensorWorld()) * (angularMove / angularInertias[0][i]);
+
+	// Position change is just linear movement along Contact normal
+	deltaPos = normal * linearMove;
+
+	// Apply
+	b2->ForceAddPosition(deltaPos);
+	b2->ForceAddOrientation(deltaOrient);
+
+	// Recalculate derived data fro sleeping RigidBodies now that the changes are applied
+	//	(Awake bodies will automatically do this after integration)
+	if(!b2->GetAwake())
+		b2->CalcDerivedData();
+}
+
+void ContactConstraints::CalculateContactBasis(unsigned int i)
+{
+	const Vector& normal = normals[i];
+	Vector tangent1, tangent2;
+	if(Abs(normal.y) > Abs(normal.x))
+	{	// Assuming world X-Axis as second axis
+		const gFloat s = (gFloat)1.0f / Sqrt(normal.z*normal.z + normal.y*normal.y);
+		
+		// New Z-Axis (z = x.Cross(y))
+		tangent2.x = 0;
+		tangent2.y = -normal.z * s;
+		tangent2.z = normal.y * s;
+
+		// New X-Axis (x = y.Cross(z))
+		tangent1.x = normal.y * tangent2.z;
+		tangent1.y = normal.z * tangent2.x - normal.x*tangent2.z;
+		tangent1.z = -normal.y * tangent2.x;
+	}
+	else
+	{	// Assuming world Z-Axis as second axis
+		const gFloat s = (gFloat)1.0f / Sqrt(normal.z*normal.z + normal.x*normal.x);
+
+		// New Z-Axis (z = x.Cross(y))
+		tangent2.x = -normal.z * s;
+		tangent2.y = 0;
+		tangent2.z = normal.x * s;
+
+		// New X-Axis (x = (y.Cross(z))
+		tangent1.x = normal.y * tangent2.z;
+		tangent1.y = normal.z * tangent2.x - normal.x * tangent2.z;
+		tangent1.z = -normal.y * tangent2.x;
+	}
+	tangents1[i] = tangent1;
+	tangents2[i] = tangent2;
+}
+
+Vector ContactConstraints::CalculateLocalVelocity(unsigned int i, unsigned int body)
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	const Vector& b1ContactPoint = b1ContactPoints[i];
+	const Vector& b2ContactPoint = b2ContactPoints[i];
+	RigidBody* rb = ((body == 1) ? b1 : b2);
+
+	// Get linear velocity of Contact point
+	Vector velocity = rb->GetVelocity() +
+				rb->GetAngularVelocity().CrossProduct(((body == 1) ? b1ContactPoint : b2ContactPoint));
+				//((body == 1) ? b1ContactPoint.CrossProduct(rb->GetAngularVelocity()) :
+				//b2ContactPoint.CrossProduct(rb->GetAngularVelocity()));
+
+	// Turn velocity into contact-coordinates
+	Vector contactVelocity = WorldToContact(i, velocity);
+
+	// Get velocity due to acceleration this frame
+	Vector accVelocity = rb->GetLastFrameAcceleration() * PHYSICS_TIMESTEP;
+	accVelocity = WorldToContact(i, accVelocity);
+
+	// Ignore y-component because it is in direction of Contact normal
+	// (In ContactBasis, the y-axis is set to be the direction of the Contact normal)
+	accVelocity.y = 0;
+	
+	// 
+	return contactVelocity + accVelocity;
+}
+
+void ContactConstraints::CalculateDesiredDeltaVelocity(unsigned int i)
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	const Vector& normal = normals[i];
+//	const static gFloat velocityLimit = (gFloat)0.25f;
+
+	// Speculative Contact - bodies are still apart by -penetrations[i]
+	// They are allowed to close that gap this step, only remove closing velocity beyond that
+	// Never pull them together and no restitution since they haven't hit yet
+	if(penetrations[i] < gFloat(0.0f))
+	{
+		gFloat allowedVel = -penetrations[i] / PHYSICS_TIMESTEP;
+		desiredDeltaVels[i] = relativeVelocities[i].y > allowedVel ? allowedVel - relativeVelocities[i].y : gFloat(0.0f);
+		return;
+	}
+
+	// Calculate acceleration induced velocity accumulated this frame
+	gFloat velocityFromAccel = (gFloat)0.0f;
+
+	if(b1->GetAwake())
+		velocityFromAccel += (b1->GetLastFrameAcceleration() * PHYSICS_TIMESTEP).DotProduct(normal);
+	if(b2 != nullptr && b2->GetAwake())
+		velocityFromAccel -= (b2->GetLastFrameAcceleration() * PHYSICS_TIMESTEP).DotProduct(normal);
+
+	// If the veloctiy is very low, limit restitution
+	gFloat rest = contacts[i]->coeffRestitution;
+	if(relativeVelocities[i].y < (gFloat)0.25f)
+		rest = (gFloat)0.0f;
+
+	desiredDeltaVels[i] = -relativeVelocities[i].y - (rest * (relativeVelocities[i].y - velocityFromAccel));
+}
+
+Vector ContactConstraints::CalcImpulseNoFriction(unsigned int i, Matrix (&inverseInertiaTensorWorld)[2])
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	const Vector& normal = normals[i];
+	const Vector& b1ContactPoint = b1ContactPoints[i];
+	const Vector& b2ContactPoint = b2ContactPoints[i];
+	// Calc change in velocity in world space per unit of impulse
+//	Vector deltaVelWorld = b1ContactPoint.CrossProduct(normal);	// torque per unit of impulse
+//	deltaVelWorld *= b1->GetInverseInertiaTensorWorld();		// angular velocity per unit of impulse
+//	deltaVelWorld = deltaVelWorld.CrossProduct(b1ContactPoint);	// velocity per unit of impulse
+	Vector deltaVelWorld = normal.CrossProduct(b1ContactPoint);
+	deltaVelWorld *= inverseInertiaTensorWorld[0];
+	deltaVelWorld = b1ContactPoint.CrossProduct(deltaVelWorld);
+
+	// Get change in velocity in Contact coordinates
+	gFloat deltaVel = deltaVelWorld.DotProduct(normal);
+
+	// Add linear component of velocity change
+	deltaVel += b1->GetInverseMass();
+
+	if(b2 != nullptr)
+	{
+		deltaVelWorld = b2ContactPoint.CrossProduct(normal);		// torque per unit of impulse
+		deltaVelWorld *= inverseInertiaTensorWorld[1];				// angular velocity per unit of impulse
+		deltaVelWorld = deltaVelWorld.CrossProduct(b2ContactPoint);	// velocity per unit of impulse
+//		deltaVelWorld = normal.CrossProduct(b2ContactPoint);
+//		deltaVelWorld *= b2->GetInverseInertiaTensorWorld();
+//		deltaVelWorld = b2ContactPoint.CrossProduct(deltaVelWorld);
+
+
+		deltaVel += deltaVelWorld.DotProduct(normal);
+		deltaVel += b2->GetInverseMass();
+	}
+
+	return Vector(0.0f, desiredDeltaVels[i] / deltaVel, 0.0f); 
+}
+
+Vector ContactConstraints::CalcImpulseFriction(unsigned int i, Matrix (&inverseInertiaTensorWorld)[2])
+{
+	RigidBody* b1 = contacts[i]->b1, *b2 = contacts[i]->b2;
+	const Vector& b1ContactPoint = b1ContactPoints[i];
+	const Vector& b2ContactPoint = b2ContactPoints[i];
+	// Built matrix to convert Contact impulse to change in velocity in world coordinates
+	Matrix impulseToTorque = Matrix::SkewSymmetricMatrix(b1ContactPoint);
+	Matrix deltaVelWorld = impulseToTorque;
+	deltaVelWorld *= inverseInertiaTensorWorld[0];// * deltaVelWorld;
+	deltaVelWorld *= impulseToTorque;// * deltaVelWorld;
+	deltaVelWorld *= -1;
+
+	gFloat inverseMass = b1->GetInverseMass();
+
+	if(b2 != nullptr)
+	{
+		impulseToTorque = Matrix::SkewSymmetricMatrix(b2ContactPoint);
+
+		Matrix deltaVelWorld2 = impulseToTorque;
+		deltaVelWorld2 *= inverseInertiaTensorWorld[1];// * deltaVelWorld2;
+		deltaVelWorld2 *= impulseToTorque;// * deltaVelWorld2;
+		deltaVelWorld2 *= -1;
+
+		// Add to total delta velocity
+		deltaVelWorld += deltaVelWorld2;
+		deltaVelWorld(3,3) = 0;
+
+		// Add to total inverse mass
+		inverseMass += b2->GetInverseMass();
+	}
+/*
+TODO: 4/29/2017
+	INVESTIGATE BS MATRIX MULTIPLICATION ORDER
+	
+	Change of basis formula is A^-1 * M * A
+	all my representations of this look like below A.Times3(M).TimesTranspose3(A) or A.Transpose3Times(M).Times3(A)
+	BUT what if it should be something like A.Transpose3Times(M.Times3(A)) or A.Times3(m.TimesTranspose3(A))
+
+	Fairly sure how it is now is correct
+*/
+	// Change of basis to Contact space
+	Matrix contactToWorld;
+	contactToWorld.SetBasis(tangents1[i], normals[i], tangents2[i]);
+	Matrix deltaVelocity = (contactToWorld.Times3(deltaVelWorld)).TimesTranspose3(contactToWorld);
+//	Matrix deltaVelocity = (contactToWorld.Transpose3Times(deltaVelWorld)).Times3(contactToWorld);
+//	Matrix deltaVelocity = deltaVelWorld;
+
+//	Matrix deltaVelocity = contactToWorld.Transpose3();
+//	deltaVelocity *= deltaVelWorld;
+//	deltaVelocity *= contactToWorld;
+
+	// Add in linear velocity change
+	deltaVelocity(0,0) += inverseMass;
+	deltaVelocity(1,1) += inverseMass;
+	deltaVelocity(2,2) += inverseMass;
+
+	// Invert to get impulse needed per unit velocity
+	Matrix impulseMatrix = deltaVelocity.Inverse4();
+
+	// Find the target velocities to kill
+	Vector velKill(relativeVelocities[i].x, desiredDeltaVels[i], relativeVelocities[i].z);
+
+	// Find the impulse to kill target velocities
+	Vector contactImpulse = velKill * impulseMatrix;
+
+	// Check for exceeding friction
+	gFloat planarImpulse = Sqrt(contactImpulse.x*contactImpulse.x + contactImpulse.z*contactImpulse.z);
+	if(planarImpulse > -contactImpulse.y * contacts[i]->staticFriction)
+	{
+		contactImpulse.x /= planarImpulse;
+		contactImpulse.z /= planarImpulse;
+
+		contactImpulse.y = (deltaVelocity(0,1) * contacts[i]->dynamicFriction * contactImpulse.x) + 
+					deltaVelocity(1,1) +
+					(deltaVelocity(2,1) * contacts[i]->dynamicFriction * contactImpulse.z);
+		contactImpulse.y = desiredDeltaVels[i] / contactImpulse.y;
+		contactImpulse.x *= contacts[i]->dynamicFriction * contactImpulse.y;
+		contactImpulse.z *= contacts[i]->dynamicFriction * contactImpulse.y;
+	}
+	else
+	{
+		contactImpulse.x *= -1.0f;
+		contactImpulse.z *= -1.0f;
+	}
+
+	return contactImpulse;
+}
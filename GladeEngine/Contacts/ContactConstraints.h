@@ -0,0 +1,136 @@
+#pragma once
+#ifndef GLADE_CONTACT_CONSTRAINTS_H
+#define GLADE_CONTACT_CONSTRAINTS_H
+
+#ifndef GLADE_CONTACT_BATCH_H
+#include "ContactBatch.h"
+#endif
+#include <vector>
+
+namespace Glade {
+// Solver data for every Contact in the ContactBatch being resolved
+// Contacts only hold what Collision Tests found. Everything the ContactResolver derives from them and updates
+// while resolving lives here instead, one array per value, built by Prepare before the Batch is resolved.
+// The ContactResolver scans whole arrays (desired velocity changes, penetrations) every iteration, so keeping
+// each value packed together touches far less memory than stepping through full Contacts in the Batch's list
+//
+// Contact space is the orthonormal basis (tangent1, normal, tangent2), so a Contact space vector's y is along the normal
+class ContactConstraints
+{
+public:
+	ContactConstraints();
+
+	// Build solver data for every Contact in 'batch'. Each ContactBatchNode is given the index of its Contact's data
+	// Arrays are reused from Batch to Batch and only grow
+	void Prepare(ContactBatch* batch);
+
+	unsigned int GetSize() const;
+
+	friend class ContactResolver;
+
+protected:
+	// Calculate solver data of Contact 'i' from its Contact and RigidBodies
+	void	CalculateInternals(unsigned int i);
+
+	// Calculate orthonormal basis for Contact Point, using the
+	// Contact Normal as one of the principal axes
+	void	CalculateContactBasis(unsigned int i);
+
+	// Calculate and return velocity of Contact Point on given Rigid Body, in Contact space
+	Vector	CalculateLocalVelocity(unsigned int i, unsigned int body);
+
+	// Calculate and save desired change in velocity to resolve the Contact
+	void	CalculateDesiredDeltaVelocity(unsigned int i);
+
+	// Calculate the impulse needed to resolve Contact, assuming no friction.
+	Vector	CalcImpulseNoFriction(unsigned int i, Matrix (&inverseInertiaTensorWorld)[2]);
+
+	// Calculate the impulse needed to resolve Contact, assuming friction
+	Vector	CalcImpulseFriction(unsigned int i, Matrix (&inverseInertiaTensorWorld)[2]);
+
+	void	ResolveImpulse(unsigned int i, Vector (&deltaVel)[2], Vector (&deltaAngVel)[2]);
+	void	ResolveImpulse2(unsigned int i, Vector (&deltaVel)[2], Vector (&deltaAngVel)[2]);
+
+#ifdef SOLVE_VELOCITY_PGS
+	// Calculate effective masses and target normal velocity of Contact 'i' for Sequential Impulses, and clear its impulse
+	void	PrepareSequentialImpulse(unsigned int i);
+	// Apply the change in accumulated impulse that Contact 'i' needs now. Friction first, clamped by the normal
+	// impulse so far, then the normal impulse, clamped so the total never pulls the RigidBodies together
+	void	SolveSequentialImpulse(unsigned int i);
+	// Relative velocity of the RigidBodies at Contact 'i' now, in Contact space
+	Vector	CalculateRelativeVelocity(unsigned int i) const;
+	// Apply 'impulse' along Contact space 'axis' (0 tangent1, 1 normal, 2 tangent2) of Contact 'i', pushing b1 along -axis
+	void	ApplyImpulse(unsigned int i, unsigned int axis, gFloat impulse);
+#endif
+
+	void	ResolveInterpenetration(unsigned int i, Vector (&deltaPos)[2], Vector (&deltaOrient)[2], gFloat pen);
+
+	void	CalculateInertia(unsigned int i);
+	void	CalculatePenetrationResolution(unsigned int i, Vector (&deltaPos)[2], Vector (&deltaOrient)[2], gFloat pen);
+	void	CalculatePenetrationResolutionB1(unsigned int i, Vector& deltaPos, Vector& deltaOrient, gFloat pen);
+	void	CalculatePenetrationResolutionB2(unsigned int i, Vector& deltaPos, Vector& deltaOrient, gFloat pen);
+
+#ifdef SOLVE_WORST_CONTACT_FIRST
+	// Group Contacts by the RigidBodies they touch, so resolving one Contact only updates the Contacts sharing its bodies
+	void	BuildBodyAdjacency(ContactBatch* batch);
+#endif
+
+#ifdef PARALLEL_CONTACT_SOLVE
+	// Colour Contacts so no two of one colour share a RigidBody that can move. Greedy in Batch order, so the
+	// colours only depend on that order
+	void	ColorConstraints(ContactBatch* batch);
+#endif
+
+	// Convert between World space and the Contact space of Contact 'i'
+	inline Vector ContactToWorld(unsigned int i, const Vector& v) const { return tangents1[i] * v.x + normals[i] * v.y + tangents2[i] * v.z; }
+	inline Vector WorldToContact(unsigned int i, const Vector& v) const { return Vector(tangents1[i].DotProduct(v), normals[i].DotProduct(v), tangents2[i].DotProduct(v)); }
+
+private:
+	unsigned int			size;				// Number of Contacts prepared
+
+	std::vector<Contact*>	contacts;			// Contact each constraint was built from
+	std::vector<Vector>		normals;			// Contact normal in world coordinates
+	std::vector<Vector>		tangents1;			// Contact space x-axis in world coordinates
+	std::vector<Vector>		tangents2;			// Contact space z-axis in world coordinates
+	std::vector<Vector>		relativeVelocities;	// Relative Velocity of colliding bodies at point of Contact, in Contact space
+													// Positive y means moving toward each other, negative is moving away
+	std::vector<gFloat>		desiredDeltaVels;	// Required change in velocity for Contact to be resolved
+													// Negative pushes the objects appart, positive pushes together
+	std::vector<gFloat>		penetrations;		// Depth of penetration, updated as other Contacts are resolved
+	std::vector<Vector>		b1ContactPoints;	// World space position of Contact Point relative to b1's Center
+	std::vector<Vector>		b2ContactPoints;	// World space position of Contact Point relative to b2's Center
+
+	std::vector<gFloat>		linearInertias[2];
+	std::vector<gFloat>		angularInertias[2];
+
+#ifdef SOLVE_WORST_CONTACT_FIRST
+	// Contacts touching each RigidBody of the Batch, by solverIndex. Group g is bodyContacts[bodyStarts[g]..bodyStarts[g+1])
+	// RigidBodies with infinite mass never change when a Contact is resolved, so their groups are left empty
+	static const unsigned int NO_BODY_GROUP = ~0u;
+	std::vector<unsigned int>	bodyContacts;
+	std::vector<unsigned int>	bodyStarts;
+	std::vector<unsigned int>	bodyNext;				// Scratch for filling bodyContacts
+	std::vector<unsigned int>	contactBodyGroups[2];	// Group of each Contact's b1 and b2, or NO_BODY_GROUP
+#endif
+
+#ifdef PARALLEL_CONTACT_SOLVE
+	// Each RigidBody's colours are tracked in a 64 bit mask. Contacts that fit none of them all go in one extra
+	// colour (MAX_CONTACT_COLORS) that is always solved on one thread
+	static const unsigned int MAX_CONTACT_COLORS = 64;
+	unsigned int					numColors;
+	std::vector<unsigned int>		colorContacts;		// Contacts by colour. Colour c is colorContacts[colorStarts[c]..colorStarts[c+1])
+	std::vector<unsigned int>		colorStarts;
+	std::vector<unsigned int>		colorNext;			// Scratch for filling colorContacts
+	std::vector<unsigned int>		contactColors;		// Colour of each Contact
+	std::vector<unsigned long long>	bodyColors;			// Colours already used by each RigidBody of the Batch, by solverIndex
+#endif
+
+#ifdef SOLVE_VELOCITY_PGS
+	std::vector<Vector>		accumulatedImpulses;	// Total impulse applied so far, in Contact space. y is never negative
+	std::vector<Vector>		effectiveMasses;		// Impulse per unit of relative velocity along each Contact space axis
+	std::vector<gFloat>		targetVelocities;		// Normal relative velocity the Contact is resolved at (bounce or speculative gap)
+	std::vector<Vector>		impulseRotations[2][3];	// Change in each RigidBody's angular velocity per unit impulse along each axis
+#endif
+};
+}	// namespace
+#endif	// GLADE_CONTACT_CONSTRAINTS_H
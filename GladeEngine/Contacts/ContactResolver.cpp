@@ -1,198 +1,243 @@
 #include "ContactResolver.h"
-#include "../Utils/Trace.h"
+#include <algorithm>
 using namespace Glade;
 
-ContactResolver::ContactResolver(unsigned int iter, gFloat impEp, gFloat penEp) : impulseIterations(iter), penetrationIterations(iter), impulseEpsilon(impEp), penetrationEpsilon(penEp) { }
-ContactResolver::ContactResolver(unsigned int iIter, unsigned int pIter, gFloat impEp, gFloat penEp) : impulseIterations(iIter), penetrationIterations(pIter), impulseEpsilon(impEp), penetrationEpsilon(penEp) { }
+ContactResolver::ContactResolver(unsigned int iter, gFloat impEp, gFloat penEp) : impulseIterations(iter), penetrationIterations(iter), impulseEpsilon(impEp), penetrationEpsilon(penEp), workerStates(1) { }
+ContactResolver::ContactResolver(unsigned int iIter, unsigned int pIter, gFloat impEp, gFloat penEp) : impulseIterations(iIter), penetrationIterations(pIter), impulseEpsilon(impEp), penetrationEpsilon(penEp), workerStates(1) { }
 
 void ContactResolver::SetIterations(unsigned int iter) { impulseIterations = penetrationIterations = iter; }
 void ContactResolver::SetIterations(unsigned int iIter, unsigned int pIter) { impulseIterations = iIter; penetrationIterations = pIter; }
 void ContactResolver::SetEpsilon(gFloat impEp, gFloat penEp) { impulseEpsilon= impEp; penetrationEpsilon = penEp; }
 
-void ContactResolver::ResolveContacts(ContactBatch* contactBatch)
+void ContactResolver::ResolveContacts(ContactBatch* contactBatch, WorkerPool* pool) { ResolveContacts(contactBatch, workerStates[0], pool); }
+
+void ContactResolver::ResolveContacts(const std::vector<ContactBatch*>& contactBatches, WorkerPool& pool)
+{
+	unsigned int numThreads = pool.GetNumThreads();
+	if(workerStates.size() < numThreads)
+		workerStates.resize(numThreads);
+
+#ifdef PARALLEL_CONTACT_BATCHES
+	unsigned int totalContacts = 0;
+	for(unsigned int i = 0; i < contactBatches.size(); ++i)
+		totalContacts += contactBatches[i]->GetNumContacts();
+
+	if(numThreads > 1 && contactBatches.size() > 1 && totalContacts >= MIN_PARALLEL_CONTACT_BATCHES)
+	{
+		// Largest first, so the Batches left at the end are small and threads finish close together
+		sortedBatches.assign(contactBatches.begin(), contactBatches.end());
+		std::stable_sort(sortedBatches.begin(), sortedBatches.end(), [](ContactBatch* a, ContactBatch* b) { return a->GetNumContacts() > b->GetNumContacts(); });
+
+		unsigned int first = 0;
+#ifdef PARALLEL_CONTACT_SOLVE
+		// A Batch with more than an even share of the Contacts would leave the other threads waiting on it.
+		// Resolve those one at a time first, with their colours split across every thread instead
+		while(first < sortedBatches.size() && sortedBatches[first]->GetNumContacts() * numThreads > totalContacts)
+			ResolveContacts(sortedBatches[first++], workerStates[0], &pool);
+#endif
+
+		// Each thread takes the largest Batch left until there are none. Batches share no RigidBodies and each
+		// thread has its own WorkerState, so nothing is written by two threads. Jobs don't hand 'pool' on,
+		// as it is busy running them
+		std::atomic<unsigned int> next(first);
+		pool.ParallelFor(numThreads, [this, &next](unsigned int w)
+		{
+			for(unsigned int b = next++; b < sortedBatches.size(); b = next++)
+				ResolveContacts(sortedBatches[b], workerStates[w], nullptr);
+		});
+		return;
+	}
+#endif
+
+	for(unsigned int i = 0; i < contactBatches.size(); ++i)
+		ResolveContacts(contactBatches[i], workerStates[0], &pool);
+}
+
+void ContactResolver::ResolveContacts(ContactBatch* contactBatch, WorkerState& state, WorkerPool* pool)
 {
 	// Make sure we have things to actually do
 	if(!IsValid()) return;
 
-	// Prepare Contacts for processing
+	// Prepare Contacts for processing and build their solver data
 	contactBatch->CalculateInternals();
+	state.constraints.Prepare(contactBatch);
 
 	// Resolve interpenetration
 #ifdef SOLVE_PENETRATION_SIMULTANEOUS
-//	ResolveInterpenetration4(contactBatch, contactBatch->GetNumContacts());
-	ResolveInterpenetration3(contactBatch, contactBatch->GetNumContacts());
+//	ResolveInterpenetration4(state, contactBatch, contactBatch->GetNumContacts());
+	ResolveInterpenetration3(state, contactBatch, contactBatch->GetNumContacts());
 //	ResolveInterpenetration2(contactBatch->GetHead(), contactBatch->GetNumContacts());
 #else
-	ResolveInterpenetration(contactBatch->GetHead(), contactBatch->GetNumContacts());
+	ResolveInterpenetration(state, contactBatch->GetNumContacts());
 #endif
 
 	// Resolve Velocity
-	ResolveImpulse(contactBatch->GetHead(), contactBatch->GetNumContacts());
+#ifdef SOLVE_VELOCITY_PGS
+	ResolveImpulseSequential(state, contactBatch->GetNumContacts(), pool);
+#else
+	ResolveImpulse(state, contactBatch->GetNumContacts());
+#endif
 }
 
+#ifdef SOLVE_VELOCITY_PGS
+void ContactResolver::ResolveImpulseSequential(WorkerState& state, unsigned int numContacts, WorkerPool* pool)
+{
+	unsigned int i;
+
+	// Match awake state at every Contact before any of them change velocity
+	for(i = 0; i < numContacts; ++i)
+		state.constraints.contacts[i]->MatchAwakeState();
+
+#ifdef PARALLEL_CONTACT_SOLVE
+	// Sweep colour by colour. No two Contacts of a colour share a RigidBody that can move, so a colour's Contacts
+	// can be solved in any order, or at once, and leave the same velocities. Every sweep is identical however many threads run it
+	unsigned int numChunks = pool != nullptr ? pool->GetNumThreads() : 1;
+	unsigned int start, count;
+	std::function<void(unsigned int)> solveChunk = [&state, &start, &count, numChunks](unsigned int c)
+	{
+		unsigned int end = start + count * (c + 1) / numChunks;
+		for(unsigned int k = start + count * c / numChunks; k < end; ++k)
+			state.constraints.SolveSequentialImpulse(state.constraints.colorContacts[k]);
+	};
+	for(state.impulseIterationsUsed = 0; state.impulseIterationsUsed < impulseIterations; ++state.impulseIterationsUsed)
+	{
+		for(unsigned int color = 0; color < state.constraints.numColors; ++color)
+		{
+			start = state.constraints.colorStarts[color];
+			count = state.constraints.colorStarts[color + 1] - start;
 
-void ContactResolver::ResolveImpulse(ContactBatchNode* contactBatch, unsigned int numContacts)
+			// Too little work to be worth splitting up, or the leftover colour whose Contacts may share RigidBodies
+			if(numChunks == 1 || count < MIN_PARALLEL_CONTACT_COLOR || color == ContactConstraints::MAX_CONTACT_COLORS)
+			{
+				for(unsigned int k = start; k < start + count; ++k)
+					state.constraints.SolveSequentialImpulse(state.constraints.colorContacts[k]);
+				continue;
+			}
+			pool->ParallelFor(numChunks, solveChunk);
+		}
+	}
+#else
+	// Sweep every Contact in Batch order. Each one corrects its accumulated impulses against the velocities
+	// the ones before it left, so a fixed number of sweeps costs the same however the Contacts are arranged
+	for(state.impulseIterationsUsed = 0; state.impulseIterationsUsed < impulseIterations; ++state.impulseIterationsUsed)
+		for(i = 0; i < numContacts; ++i)
+			state.constraints.SolveSequentialImpulse(i);
+#endif
+}
+#else
+void ContactResolver::ResolveImpulse(WorkerState& state, unsigned int numContacts)
 {
 	Vector velocityChange[2], angularVelocityChange[2];
 	Vector deltaVel;
-	gFloat max;
-	unsigned int index, i; 
-	ContactBatchNode* selected, *temp;
+	unsigned int index, i, group, k;
+	Contact* selected;
+
+	// Contacts keyed by how much velocity change they need, largest first (desired changes are negative)
+	state.worstContacts.Build(numContacts, [&state](unsigned int c) { return -state.constraints.desiredDeltaVels[c]; });
 
 	// Iteratively handle Contacts in order of severity
-	impulseIterationsUsed = 0;
-	while(impulseIterationsUsed < impulseIterations)
+	state.impulseIterationsUsed = 0;
+	while(state.impulseIterationsUsed < impulseIterations)
 	{
-		// Find Contact with maximum magnitude of probable velocity change
-		max = -impulseEpsilon;
-		index = numContacts;
-		for(i = 0; i < numContacts; ++i)
-		{
-			if(contactBatch->contact.desiredDeltaVel < max)
-			{
-				max = contactBatch->contact.desiredDeltaVel;
-				selected = contactBatch;
-				index = i;
-			}
-
-			// Move to next Contact in Batch
-			contactBatch = contactBatch->GetNext();
-		}
-		
-		if(index == numContacts) break;
+		// Contact with maximum magnitude of probable velocity change
+		if(state.worstContacts.IsEmpty() || state.worstContacts.TopKey() <= impulseEpsilon) break;
+		index = state.worstContacts.Top();
+		selected = state.constraints.contacts[index];
 
 		// Match awake state at Contact
-		selected->contact.MatchAwakeState();
+		selected->MatchAwakeState();
 
 		// Do resolution on selected Contact
-		selected->contact.ResolveImpulse(velocityChange, angularVelocityChange);
+		state.constraints.ResolveImpulse(index, velocityChange, angularVelocityChange);
 		
 		// Update the relative/closing velocities of other Contacts with the
 		// same body(s) as the selected Contact using the saved/returned 
 		// velocity and angular velocity changes
-		temp = contactBatch;	// loop through Batch with new pointer
-   		for(i = 0; i < numContacts; ++i)
+		for(unsigned int b = 0; b < 2; ++b)
 		{
-			if(selected->contact.b1 == temp->contact.b1)
-			{
-				deltaVel = velocityChange[0] + 
-					angularVelocityChange[0].CrossProduct(temp->contact.b1ContactPoint);
-					//temp->contact.b1ContactPoint.CrossProduct(angularVelocityChange[0]);
-				temp->contact.relativeVelocity += temp->contact.contactToWorld.Transpose3Times(deltaVel);
-				temp->contact.CalculateDesiredDeltaVelocity();
-			}
-			else if(selected->contact.b1 == temp->contact.b2)
-			{
-				deltaVel = velocityChange[0] + 
-					angularVelocityChange[0].CrossProduct(temp->contact.b2ContactPoint);
-					//temp->contact.b2ContactPoint.CrossProduct(angularVelocityChange[0]);
-				temp->contact.relativeVelocity -= temp->contact.contactToWorld.Transpose3Times(deltaVel);
-				temp->contact.CalculateDesiredDeltaVelocity();
-			}
-
-			if(selected->contact.b2 != nullptr)
+			group = state.constraints.contactBodyGroups[b][index];
+			if(group == ContactConstraints::NO_BODY_GROUP) continue;
+			RigidBody* body = b == 0 ? selected->b1 : selected->b2;
+			for(k = state.constraints.bodyStarts[group]; k < state.constraints.bodyStarts[group + 1]; ++k)
 			{
-				if(selected->contact.b2 == temp->contact.b1)
+				i = state.constraints.bodyContacts[k];
+				if(body == state.constraints.contacts[i]->b1)
 				{
-					deltaVel = velocityChange[1] +
-						angularVelocityChange[1].CrossProduct(temp->contact.b1ContactPoint);
-						//temp->contact.b1ContactPoint.CrossProduct(angularVelocityChange[1]);
-					temp->contact.relativeVelocity += temp->contact.contactToWorld.Transpose3Times(deltaVel);
-					temp->contact.CalculateDesiredDeltaVelocity();
+					deltaVel = velocityChange[b] + 
+						angularVelocityChange[b].CrossProduct(state.constraints.b1ContactPoints[i]);
+					state.constraints.relativeVelocities[i] += state.constraints.WorldToContact(i, deltaVel);
 				}
-				else if(selected->contact.b2 == temp->contact.b2)
+				else
 				{
-					deltaVel = velocityChange[1] + 
-						angularVelocityChange[1].CrossProduct(temp->contact.b2ContactPoint);
-						//temp->contact.b2ContactPoint.CrossProduct(angularVelocityChange[1]);
-					temp->contact.relativeVelocity -= temp->contact.contactToWorld.Transpose3Times(deltaVel);
-					temp->contact.CalculateDesiredDeltaVelocity();
+					deltaVel = velocityChange[b] + 
+						angularVelocityChange[b].CrossProduct(state.constraints.b2ContactPoints[i]);
+					state.constraints.relativeVelocities[i] -= state.constraints.WorldToContact(i, deltaVel);
 				}
+				state.constraints.CalculateDesiredDeltaVelocity(i);
+				state.worstContacts.Update(i, -state.constraints.desiredDeltaVels[i]);
 			}
-			temp = temp->GetNext();
 		}
 
-		++impulseIterationsUsed;
+		++state.impulseIterationsUsed;
 	}
 }
+#endif
 
 #ifndef SOLVE_PENETRATION_SIMULTANEOUS
-void ContactResolver::ResolveInterpenetration(ContactBatchNode* contactBatch, unsigned int numContacts)
+void ContactResolver::ResolveInterpenetration(WorkerState& state, unsigned int numContacts)
 {
 	Vector linearChange[2], angularChange[2];
 	Vector deltaPos;
 	gFloat max;
-	unsigned int index, i;
-	ContactBatchNode* selected, *temp;
+	unsigned int index, i, group, k;
+	Contact* selected;
+
+	// Contacts keyed by penetration, deepest first
+	state.worstContacts.Build(numContacts, [&state](unsigned int c) { return state.constraints.penetrations[c]; });
 
 	// Iteratively handle Contacts in order of severity
-	penetrationIterationsUsed = 0;
-	while(penetrationIterationsUsed < penetrationIterations)
+	state.penetrationIterationsUsed = 0;
+	while(state.penetrationIterationsUsed < penetrationIterations)
 	{
-		// Find largest interpenetration
-		max = penetrationEpsilon;
-		index = numContacts;
-		for(i = 0; i < numContacts; ++i)
-		{
-			if(contactBatch->contact.penetrationDepth > max)
-			{
-				max = contactBatch->contact.penetrationDepth;
-				selected = contactBatch;
-				index = i;
-			}
-
-			// Move to next Contact in Batch
-			contactBatch = contactBatch->GetNext();
-		}
-		if(index == numContacts) break;
+		// Largest interpenetration
+		if(state.worstContacts.IsEmpty() || state.worstContacts.TopKey() <= penetrationEpsilon) break;
+		index = state.worstContacts.Top();
+		max = state.worstContacts.TopKey();
+		selected = state.constraints.contacts[index];
 
 		// Match awake state at Contact
-		selected->contact.MatchAwakeState();
+		selected->MatchAwakeState();
 
 		// Do resolution on selected Contact
-		selected->contact.ResolveInterpenetration(linearChange, angularChange, max);
+		state.constraints.ResolveInterpenetration(index, linearChange, angularChange, max);
 		
 		// Update the interpenetration of other Contacts with the
 		// same body(s) as the selected Contact using the saved/returned 
 		// linear and angular changes
-		temp = contactBatch;	// loop through Batch with new pointer
-		for(i = 0; i < numContacts; ++i)
+		for(unsigned int b = 0; b < 2; ++b)
 		{
-			if(selected->contact.b1 == temp->contact.b1)
-			{
-				deltaPos = linearChange[0] + 
-					angularChange[0].CrossProduct(temp->contact.b1ContactPoint);
-					//temp->contact.b1ContactPoint.CrossProduct(angularChange[0]);
-				temp->contact.penetrationDepth += deltaPos.DotProduct(temp->contact.normal);
-			}
-			else if(selected->contact.b1 == temp->contact.b2)
+			group = state.constraints.contactBodyGroups[b][index];
+			if(group == ContactConstraints::NO_BODY_GROUP) continue;
+			RigidBody* body = b == 0 ? selected->b1 : selected->b2;
+			for(k = state.constraints.bodyStarts[group]; k < state.constraints.bodyStarts[group + 1]; ++k)
 			{
-				deltaPos = linearChange[0] + 
-					angularChange[0].CrossProduct(temp->contact.b2ContactPoint);
-					//temp->contact.b2ContactPoint.CrossProduct(angularChange[0]);
-				temp->contact.penetrationDepth -= deltaPos.DotProduct(temp->contact.normal);
-			}
-
-			if(selected->contact.b2 != nullptr)
-			{
-				if(selected->contact.b2 == temp->contact.b1)
+				i = state.constraints.bodyContacts[k];
+				if(body == state.constraints.contacts[i]->b1)
 				{
-					deltaPos = linearChange[1] +
-						angularChange[1].CrossProduct(temp->contact.b1ContactPoint);
-						//temp->contact.b1ContactPoint.CrossProduct(angularChange[1]);
-					temp->contact.penetrationDepth += deltaPos.DotProduct(temp->contact.normal);
+					deltaPos = linearChange[b] + 
+						angularChange[b].CrossProduct(state.constraints.b1ContactPoints[i]);
+					state.constraints.penetrations[i] += deltaPos.DotProduct(state.constraints.normals[i]);
 				}
-				else if(selected->contact.b2 == temp->contact.b2)
+				else
 				{
-					deltaPos = linearChange[1] + 
-						angularChange[1].CrossProduct(temp->contact.b2ContactPoint);
-						//temp->contact.b2ContactPoint.CrossProduct(angularChange[1]);
-					temp->contact.penetrationDepth -= deltaPos.DotProduct(temp->contact.normal);
+					deltaPos = linearChange[b] + 
+						angularChange[b].CrossProduct(state.constraints.b2ContactPoints[i]);
+					state.constraints.penetrations[i] -= deltaPos.DotProduct(state.constraints.normals[i]);
 				}
+				state.worstContacts.Update(i, state.constraints.penetrations[i]);
 			}
-			temp = temp->GetNext();
 		}
-		++penetrationIterationsUsed;
+		++state.penetrationIterationsUsed;
 	}
 }
 #endif
@@ -381,42 +426,33 @@ void ContactResolver::ResolveInterpenetration2(ContactBatchNode* contactBatch, u
 			Maybe resolving in reverse causes unrealistic resolutions...perhaps resolve normally, then re-resolve "most major" one last time, then LOCK it, then continue to next iteration
 			TRY RESOLVING IN REVERSE FIRST
 */
-void ContactResolver::ResolveInterpenetration3(ContactBatch* contactBatch, unsigned int numContacts)
+void ContactResolver::ResolveInterpenetration3(WorkerState& state, ContactBatch* contactBatch, unsigned int numContacts)
 {
 	Vector deltaPos[2];
 	Vector deltaOrient[2];
-	gFloat* currentPenetrations = new gFloat[numContacts];
 	ContactBatchNode* major = contactBatch->major, *temp;
 	RigidBody* b1 = major->contact.b1, *b2 = major->contact.b2;	// save "most major" bodies for simplicity
 
 	// Resolutions need to be tracked per RigidBody, not per Contact
-	// Track the resolution per RigidBody with this
-	struct PenResolution { Vector deltaPos; Vector deltaOrient; };
-	std::map<RigidBody*, PenResolution> resolutions;
-	for(auto iter = contactBatch->nodes.begin(); iter != contactBatch->nodes.end(); ++iter)
-	{
-		resolutions.insert(std::pair<RigidBody*, PenResolution>((*iter)->contact.b1, PenResolution()));
-		resolutions.insert(std::pair<RigidBody*, PenResolution>((*iter)->contact.b2, PenResolution()));
-	}
+	// Each RigidBody's resolution is at its solverIndex in the Batch
+	unsigned int numBodies = contactBatch->GetNumBodies();
+	if(state.resolutions.size() < numBodies)
+		state.resolutions.resize(numBodies);
+	for(unsigned int b = 0; b < numBodies; ++b)
+		state.resolutions[b] = PenResolution();
 
 	// Match awake state at major Contact
 	major->contact.MatchAwakeState();
 
 	// Calculate resolution for "most major" Contact
-	major->contact.CalculateInertia();
-	major->contact.CalculatePenetrationResolution(deltaPos, deltaOrient, major->contact.penetrationDepth);
+	state.constraints.CalculateInertia(major->index);
+	state.constraints.CalculatePenetrationResolution(major->index, deltaPos, deltaOrient, state.constraints.penetrations[major->index]);
 
 	// Save calculated resoltuon for "most major" Contact
-	resolutions[major->contact.b1].deltaPos += deltaPos[0];
-	resolutions[major->contact.b1].deltaOrient += deltaOrient[0];
-	resolutions[major->contact.b2].deltaPos += deltaPos[1];
-	resolutions[major->contact.b2].deltaOrient += deltaOrient[1];
-	// These are not going to change...EVER!
-	if(deltaOrient[0] != Vector() || deltaOrient[1] != Vector())
-	{
-		int x = 5;
-		x++;
-	}
+	state.resolutions[major->contact.b1->solverIndex].deltaPos += deltaPos[0];
+	state.resolutions[major->contact.b1->solverIndex].deltaOrient += deltaOrient[0];
+	state.resolutions[major->contact.b2->solverIndex].deltaPos += deltaPos[1];
+	state.resolutions[major->contact.b2->solverIndex].deltaOrient += deltaOrient[1];
 
 	struct ContactGraph
 	{ 
@@ -428,8 +464,8 @@ void ContactResolver::ResolveInterpenetration3(ContactBatch* contactBatch, unsig
 		Contact* parentContact;
 	};
 
-	penetrationIterationsUsed = 0;
-	while(penetrationIterationsUsed < 1)
+	state.penetrationIterationsUsed = 0;
+	while(state.penetrationIterationsUsed < 1)
 	{
 		// Go Left - IGNORING ROTATION FOR NOW
 		std::queue<ContactGraph> queue;
@@ -460,8 +496,8 @@ void ContactResolver::ResolveInterpenetration3(ContactBatch* contactBatch, unsig
 			cg.node->contact.MatchAwakeState();
 
 			// Calculate normal resolution for Contact
-			cg.node->contact.CalculateInertia();
-			cg.node->contact.CalculatePenetrationResolution(deltaPos, deltaOrient, cg.node->contact.penetrationDepth);
+			state.constraints.CalculateInertia(cg.node->index);
+			state.constraints.CalculatePenetrationResolution(cg.node->index, deltaPos, deltaOrient, state.constraints.penetrations[cg.node->index]);
 
 			// MOST MAJOR CANNOT CHANGE IN DIRECTION OF ITS NORMAL
 			// BUT IT CAN CHANGE IN NON-NORMAL DIRECTION
@@ -470,21 +506,21 @@ void ContactResolver::ResolveInterpenetration3(ContactBatch* contactBatch, unsig
 			{
 				deltaPos[1] += -deltaPos[0];
 				Vector blah = 
-				//cg.node->contact.normal * resolutions[cg.node->contact.b1].deltaPos.DotProduct(-major->contact.normal);
-				//cg.normal * resolutions[cg.parentBody].deltaPos.DotProduct(cg.normal);
-				resolutions[cg.parentBody].deltaPos * cg.node->contact.normal.DotProduct(cg.normal);
+				//cg.node->contact.normal * state.resolutions[cg.node->contact.b1->solverIndex].deltaPos.DotProduct(-major->contact.normal);
+				//cg.normal * state.resolutions[cg.parentBody->solverIndex].deltaPos.DotProduct(cg.normal);
+				state.resolutions[cg.parentBody->solverIndex].deltaPos * cg.node->contact.normal.DotProduct(cg.normal);
 				deltaPos[1] += blah;
-				resolutions[cg.node->contact.b2].deltaPos += deltaPos[1];
+				state.resolutions[cg.node->contact.b2->solverIndex].deltaPos += deltaPos[1];
 			}
 			else
 			{
 				deltaPos[0] += -deltaPos[1];
 				Vector blah = 
-				//cg.node->contact.normal * resolutions[cg.node->contact.b2].deltaPos.DotProduct(major->contact.normal);
-				//cg.normal * resolutions[cg.parentBody].deltaPos.DotProduct(cg.normal);
-				resolutions[cg.parentBody].deltaPos * cg.node->contact.normal.DotProduct(cg.normal);
+				//cg.node->contact.normal * state.resolutions[cg.node->contact.b2->solverIndex].deltaPos.DotProduct(major->contact.normal);
+				//cg.normal * state.resolutions[cg.parentBody->solverIndex].deltaPos.DotProduct(cg.normal);
+				state.resolutions[cg.parentBody->solverIndex].deltaPos * cg.node->contact.normal.DotProduct(cg.normal);
 				deltaPos[0] += blah;
-				resolutions[cg.node->contact.b1].deltaPos += deltaPos[0];
+				state.resolutions[cg.node->contact.b1->solverIndex].deltaPos += deltaPos[0];
 			}
 			*/
 
@@ -493,8 +529,8 @@ void ContactResolver::ResolveInterpenetration3(ContactBatch* contactBatch, unsig
 
 			// Movement from parent Contact carried over onto current Contact
 			Vector blah = 
-				//cg.normal * resolutions[cg.parentBody].deltaPos.DotProduct(cg.normal);
-				resolutions[cg.parentBody].deltaPos * cg.node->contact.normal.DotProduct(cg.parentNormal);
+				//cg.normal * state.resolutions[cg.parentBody->solverIndex].deltaPos.DotProduct(cg.normal);
+				state.resolutions[cg.parentBody->solverIndex].deltaPos * cg.node->contact.normal.DotProduct(cg.parentNormal);
 
 			// If 1st body in Contact is the body shared with parent Contact
 			if(cg.node->contact.b1 == cg.parentBody)
@@ -516,13 +552,13 @@ void ContactResolver::ResolveInterpenetration3(ContactBatch* contactBatch, unsig
 					Vector dPos[2], dOri[2];
 					// Calc resolution that would have been resolved via rotation
 					//gFloat pen = deltaOrient[0].CrossProduct(cg.parentContact->b1ContactPoint).DotProduct(cg.node->contact.normal);
-					gFloat pen = cg.node->contact.penetrationDepth + blah + deltaPos[0].DotProduct(cg.node->contact.normal) - deltaPos[1].DotProduct(cg.node->contact.normal);
+					gFloat pen = state.constraints.penetrations[cg.node->index] + blah + deltaPos[0].DotProduct(cg.node->contact.normal) - deltaPos[1].DotProduct(cg.node->contact.normal);
 
 
 					// If Contact normal is in same direction as parent normal (like boxes in a stack)
 					if(Abs(cg.node->contact.normal.DotProduct(cg.parentNormal)) >= gFloat(0.1f))
 					{	// Recalc resolutions for penetration missing from rotation
-						cg.node->contact.CalculatePenetrationResolution(dPos, dOri, pen);
+						state.constraints.CalculatePenetrationResolution(cg.node->index, dPos, dOri, pen);
 
 						// Apply
 					//	deltaPos[1] += cg.node->contact.normal * pen;
@@ -560,8 +596,8 @@ void ContactResolver::ResolveInterpenetration3(ContactBatch* contactBatch, unsig
 				{
 					// Calc resolution that would have been resolved via rotation
 				//	gFloat pen = deltaOrient[1].CrossProduct(cg.parentContact->b1ContactPoint).DotProduct(cg.normal);
-				//	gFloat pen2 = deltaOrient[1].CrossProduct(cg.node->contact.b2ContactPoint).DotProduct(cg.node->contact.normal);
-					gFloat pen = cg.node->contact.penetrationDepth + deltaPos[0].DotProduct(cg.node->contact.normal) - deltaPos[1].DotProduct(cg.node->contact.normal);
+				//	gFloat pen2 = deltaOrient[1].CrossProduct(state.constraints.b2ContactPoints[cg.node->index]).DotProduct(cg.node->contact.normal);
+					gFloat pen = state.constraints.penetrations[cg.node->index] + deltaPos[0].DotProduct(cg.node->contact.normal) - deltaPos[1].DotProduct(cg.node->contact.normal);
 				
 					if(Abs(cg.node->contact.normal.DotProduct(cg.parentNormal)) == gFloat(1.0f))
 					{
@@ -585,46 +621,39 @@ void ContactResolver::ResolveInterpenetration3(ContactBatch* contactBatch, unsig
 			}
 
 
-			gFloat orientPen = cg.node->contact.penetrationDepth
-						+ (resolutions[cg.node->contact.b1].deltaPos + resolutions[cg.node->contact.b1].deltaOrient.CrossProduct(cg.node->contact.b1ContactPoint)).DotProduct(cg.node->contact.normal)
-						- (resolutions[cg.node->contact.b2].deltaPos + resolutions[cg.node->contact.b2].deltaOrient.CrossProduct(cg.node->contact.b2ContactPoint)).DotProduct(cg.node->contact.normal);
+			gFloat orientPen = state.constraints.penetrations[cg.node->index]
+						+ (state.resolutions[cg.node->contact.b1->solverIndex].deltaPos + state.resolutions[cg.node->contact.b1->solverIndex].deltaOrient.CrossProduct(state.constraints.b1ContactPoints[cg.node->index])).DotProduct(cg.node->contact.normal)
+						- (state.resolutions[cg.node->contact.b2->solverIndex].deltaPos + state.resolutions[cg.node->contact.b2->solverIndex].deltaOrient.CrossProduct(state.constraints.b2ContactPoints[cg.node->index])).DotProduct(cg.node->contact.normal);
 		
-			resolutions[cg.node->contact.b1].deltaPos += deltaPos[0];
-			resolutions[cg.node->contact.b2].deltaPos += deltaPos[1];
-			resolutions[cg.node->contact.b1].deltaOrient += deltaOrient[0];
-			resolutions[cg.node->contact.b2].deltaOrient += deltaOrient[1];
-			if(deltaOrient[0] != Vector() || deltaOrient[1] != Vector())
-			{
-				int x = 5;
-				x++;
-			}
+			state.resolutions[cg.node->contact.b1->solverIndex].deltaPos += deltaPos[0];
+			state.resolutions[cg.node->contact.b2->solverIndex].deltaPos += deltaPos[1];
+			state.resolutions[cg.node->contact.b1->solverIndex].deltaOrient += deltaOrient[0];
+			state.resolutions[cg.node->contact.b2->solverIndex].deltaOrient += deltaOrient[1];
 		}
 
 		// ~~~~ END ~~~~
 		// Apply all resolutions now that they have been calculated
-		for(auto iter = resolutions.begin(); iter != resolutions.end(); ++iter)
+		for(unsigned int b = 0; b < numBodies; ++b)
 		{
-			if(iter->first->GetInverseMass() == gFloat(0.0f))
+			RigidBody* body = contactBatch->GetBody(b);
+			if(body->GetInverseMass() == gFloat(0.0f))
 				continue;
-			//TRACE("Object %i Linear Move: (%f, %f, %f)\n", iter->first->GetID(), iter->second.deltaPos.x,iter->second.deltaPos.y,iter->second.deltaPos.z);
-			TRACE("Object %i Angular Move: (%f, %f, %f)\n", iter->first->GetID(), iter->second.deltaOrient.x,iter->second.deltaOrient.y,iter->second.deltaOrient.z);
-			iter->first->ForceAddPosition(iter->second.deltaPos);
-			iter->first->ForceAddOrientation(iter->second.deltaOrient);
+			body->ForceAddPosition(state.resolutions[b].deltaPos);
+			body->ForceAddOrientation(state.resolutions[b].deltaOrient);
 
 			// Recalculate derived data for sleeping RigidBodies now that the changes are applied
 			//  (Awake bodies will automatically do this after Integration)
-			if(!iter->first->GetAwake())
-				iter->first->CalcDerivedData();
+			if(!body->GetAwake())
+				body->CalcDerivedData();
 		}
-		penetrationIterationsUsed++;
+		state.penetrationIterationsUsed++;
 	}
 }
 
-void ContactResolver::ResolveInterpenetration4(ContactBatch* contactBatch, unsigned int numContacts)
+void ContactResolver::ResolveInterpenetration4(WorkerState& state, ContactBatch* contactBatch, unsigned int numContacts)
 {
 	Vector deltaPos[2];
 	Vector deltaOrient[2];
-	gFloat* currentPenetrations = new gFloat[numContacts];
 	ContactBatchNode* major = contactBatch->major, *temp = contactBatch->major;
 	RigidBody* b1 = major->contact.b1, *b2 = major->contact.b2;	// save "most major" bodies for simplicity
 
@@ -634,8 +663,8 @@ void ContactResolver::ResolveInterpenetration4(ContactBatch* contactBatch, unsig
 	Vector deltaPen;
 
 	// Calculate resolution for "most major" Contact
-	temp->contact.CalculateInertia();
-	temp->contact.CalculatePenetrationResolution(deltaPos, deltaOrient, major->contact.penetrationDepth);
+	state.constraints.CalculateInertia(temp->index);
+	state.constraints.CalculatePenetrationResolution(temp->index, deltaPos, deltaOrient, state.constraints.penetrations[major->index]);
 
 	// Apply Resolutions
 	temp->contact.b1->ForceAddPosition(deltaPos[0]);
@@ -652,8 +681,8 @@ void ContactResolver::ResolveInterpenetration4(ContactBatch* contactBatch, unsig
 	for(auto iter = list.begin(); iter != list.end(); ++iter)
 	{
 		deltaPen = deltaPos[0] + 
-			deltaOrient[0].CrossProduct((*iter)->contact.b1ContactPoint);
-		(*iter)->contact.penetrationDepth += deltaPen.DotProduct((*iter)->contact.normal);
+			deltaOrient[0].CrossProduct(state.constraints.b1ContactPoints[(*iter)->index]);
+		state.constraints.penetrations[(*iter)->index] += deltaPen.DotProduct((*iter)->contact.normal);
 
 		queue.push(ContactGraph(*iter, true));
 	}
@@ -662,8 +691,8 @@ void ContactResolver::ResolveInterpenetration4(ContactBatch* contactBatch, unsig
 	for(auto iter = list.begin(); iter != list.end(); ++iter)
 	{
 		deltaPen = deltaPos[1] +
-			deltaOrient[1].CrossProduct((*iter)->contact.b2ContactPoint);
-		(*iter)->contact.penetrationDepth -= deltaPen.DotProduct((*iter)->contact.normal);
+			deltaOrient[1].CrossProduct(state.constraints.b2ContactPoints[(*iter)->index]);
+		state.constraints.penetrations[(*iter)->index] -= deltaPen.DotProduct((*iter)->contact.normal);
 
 		queue.push(ContactGraph(*iter, false));
 	}
@@ -677,33 +706,33 @@ void ContactResolver::ResolveInterpenetration4(ContactBatch* contactBatch, unsig
 		cg = queue.front();
 		queue.pop();
 
-		cg.node->contact.CalculateInertia();
+		state.constraints.CalculateInertia(cg.node->index);
 		if(cg.left)
 		{
-			cg.node->contact.CalculatePenetrationResolutionB2(deltaPos[1], deltaOrient[1], cg.node->contact.penetrationDepth);
+			state.constraints.CalculatePenetrationResolutionB2(cg.node->index, deltaPos[1], deltaOrient[1], state.constraints.penetrations[cg.node->index]);
 
 			// Go Right (Left node can never have a left list)
 			list = cg.node->GetRight();
 			for(auto iter = list.begin(); iter != list.end(); ++iter)
 			{
 				deltaPen = deltaPos[1] +
-					deltaOrient[1].CrossProduct((*iter)->contact.b2ContactPoint);
-				(*iter)->contact.penetrationDepth -= deltaPen.DotProduct((*iter)->contact.normal);
+					deltaOrient[1].CrossProduct(state.constraints.b2ContactPoints[(*iter)->index]);
+				state.constraints.penetrations[(*iter)->index] -= deltaPen.DotProduct((*iter)->contact.normal);
 
 				queue.push(ContactGraph(*iter, false));
 			}
 		}
 		else
 		{
-			cg.node->contact.CalculatePenetrationResolutionB1(deltaPos[0], deltaOrient[0], cg.node->contact.penetrationDepth);
+			state.constraints.CalculatePenetrationResolutionB1(cg.node->index, deltaPos[0], deltaOrient[0], state.constraints.penetrations[cg.node->index]);
 
 			// Go Left (Right node can never have a right list)
 			list = cg.node->GetLeft();
 			for(auto iter = list.begin(); iter != list.end(); ++iter)
 			{
 				deltaPen = deltaPos[0] + 
-					deltaOrient[0].CrossProduct((*iter)->contact.b1ContactPoint);
-				(*iter)->contact.penetrationDepth += deltaPen.DotProduct((*iter)->contact.normal);
+					deltaOrient[0].CrossProduct(state.constraints.b1ContactPoints[(*iter)->index]);
+				state.constraints.penetrations[(*iter)->index] += deltaPen.DotProduct((*iter)->contact.normal);
 
 				queue.push(ContactGraph(*iter, true));
 			}
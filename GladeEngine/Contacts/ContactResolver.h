@@ -5,9 +5,21 @@
 #ifndef GLADE_CONTACT_BATCH_H
 #include "ContactBatch.h"
 #endif
+#ifndef GLADE_CONTACT_CONSTRAINTS_H
+#include "ContactConstraints.h"
+#endif
+#ifndef GLADE_INDEXED_HEAP_H
+#include "../Utils/IndexedHeap.h"
+#endif
+#include "../System/Threads/WorkerPool.h"
 #include <map>
 #include <queue>
 
+// Fewest Contacts of one colour worth splitting across worker threads
+#define MIN_PARALLEL_CONTACT_COLOR	128
+// Fewest Contacts, over every Batch, worth handing Batches out to worker threads
+#define MIN_PARALLEL_CONTACT_BATCHES	64
+
 namespace Glade {
 class ContactResolver
 {
@@ -19,16 +31,45 @@ public:
 	void SetIterations(unsigned int iIter, unsigned int pIter);
 	void SetEpsilon(gFloat impEp, gFloat penEp);
 
-	void ResolveContacts(ContactBatch* contactBatch);
+	// Contacts of one colour may be resolved across 'pool' (PARALLEL_CONTACT_SOLVE). Without one everything runs on this thread
+	void ResolveContacts(ContactBatch* contactBatch, WorkerPool* pool=nullptr);
+	// Resolve every Batch in 'contactBatches'. Batches share no RigidBodies, so with PARALLEL_CONTACT_BATCHES
+	// 'pool's threads take them largest first, each resolving into its own WorkerState
+	void ResolveContacts(const std::vector<ContactBatch*>& contactBatches, WorkerPool& pool);
 
 protected:
-	void ResolveImpulse(ContactBatchNode* contactBatch, unsigned int numContacts);
+#ifdef SOLVE_PENETRATION_SIMULTANEOUS
+	// Movement of one RigidBody of the Batch
+	struct PenResolution { Vector deltaPos; Vector deltaOrient; };
+#endif
+	// Everything resolving one Batch writes besides its RigidBodies. Reused for every Batch a worker thread resolves
+	struct WorkerState
+	{
+		WorkerState() : impulseIterationsUsed(0), penetrationIterationsUsed(0) { }
+
+		ContactConstraints constraints;			// Solver data of the Batch being resolved
+#ifdef SOLVE_PENETRATION_SIMULTANEOUS
+		std::vector<PenResolution> resolutions;	// Movement of each RigidBody in the Batch, by solverIndex
+#endif
+#ifdef SOLVE_WORST_CONTACT_FIRST
+		IndexedHeap worstContacts;				// Contacts of the Batch by how badly they need resolving, for the Iterative resolvers
+#endif
+		unsigned int impulseIterationsUsed;		// Iterations the last Batch resolved took
+		unsigned int penetrationIterationsUsed;
+	};
+
+	void ResolveContacts(ContactBatch* contactBatch, WorkerState& state, WorkerPool* pool);
+#ifdef SOLVE_VELOCITY_PGS
+	void ResolveImpulseSequential(WorkerState& state, unsigned int numContacts, WorkerPool* pool);
+#else
+	void ResolveImpulse(WorkerState& state, unsigned int numContacts);
+#endif
 #ifdef SOLVE_PENETRATION_SIMULTANEOUS
 	//void ResolveInterpenetration2(ContactBatchNode* contactBatch, unsigned int numContacts);
-	void ResolveInterpenetration3(ContactBatch* contactBatch, unsigned int numContacts);
-	void ResolveInterpenetration4(ContactBatch* contactBatch, unsigned int numContacts);
+	void ResolveInterpenetration3(WorkerState& state, ContactBatch* contactBatch, unsigned int numContacts);
+	void ResolveInterpenetration4(WorkerState& state, ContactBatch* contactBatch, unsigned int numContacts);
 #else
-	void ResolveInterpenetration(ContactBatchNode* contactBatch, unsigned int numContacts);
+	void ResolveInterpenetration(WorkerState& state, unsigned int numContacts);
 #endif
 
 public:
@@ -38,9 +79,6 @@ public:
 				impulseEpsilon > 0 && penetrationEpsilon > 0;
 	}
 
-	unsigned int impulseIterationsUsed;
-	unsigned int penetrationIterationsUsed;
-
 protected:
 	unsigned int impulseIterations;
 	unsigned int penetrationIterations;
@@ -48,6 +86,12 @@ protected:
 	gFloat	impulseEpsilon;
 	gFloat	penetrationEpsilon;
 
+	// One per worker thread. The first is also used whenever Batches are resolved on the calling thread
+	std::vector<WorkerState> workerStates;
+#ifdef PARALLEL_CONTACT_BATCHES
+	std::vector<ContactBatch*> sortedBatches;	// Batches being resolved, largest first
+#endif
+
 private:
 	bool	validSettings;
 };
@@ -0,0 +1,176 @@
+#include "ContactStream.h"
+
+using namespace Glade;
+
+ContactStream::ContactStream(unsigned int budget_, OverflowPolicy policy_, unsigned int growthLimit_) :
+			heapBuilt(false), policy(policy_), size(0), budget(budget_), growthLimit(growthLimit_), highWaterMark(0), dropped(0), overflowed(false)
+{
+	AssertMsg(budget > 0, "Contact Stream must be able to hold at least one Contact");
+
+	// Default hard cap when growing is 8x the starting budget
+	if(growthLimit < budget)
+		growthLimit = budget * 8;
+
+	EnsureStorage(budget + MAX_CONTACTS_PER_TEST);
+}
+
+void ContactStream::Clear()
+{
+	size = 0;
+	dropped = 0;
+	overflowed = false;
+	heapBuilt = false;
+}
+
+Contact* ContactStream::Reserve()
+{
+	if(overflowed && policy == OverflowPolicy::REPORT)
+		return nullptr;
+
+	// Tests always write at the end of the stored Contacts. If the stream is full
+	// this is the scratch area past the budget and the results are sorted out in Commit
+	EnsureStorage(size + MAX_CONTACTS_PER_TEST);
+	return &contacts[size];
+}
+
+unsigned int ContactStream::Commit(unsigned int used)
+{
+	AssertMsg(used <= MAX_CONTACTS_PER_TEST, "Collision Test wrote more Contacts than MAX_CONTACTS_PER_TEST");
+	if(used == 0) return 0;
+
+	// Raise the budget to fit, doubling to avoid growing on every test
+	if(policy == OverflowPolicy::GROW && size + used > budget && budget < growthLimit)
+	{
+		budget = budget * 2 < growthLimit ? budget * 2 : growthLimit;
+		if(budget < size + used && size + used <= growthLimit)
+			budget = size + used;
+	}
+
+	// Everything that fits is already in place
+	unsigned int room = budget > size ? budget - size : 0;
+	unsigned int kept = used < room ? used : room;
+	size += kept;
+	if(size > highWaterMark)
+		highWaterMark = size;
+
+	if(kept == used)
+		return kept;
+
+	// Overflow - what to do with the rest depends on the policy
+	overflowed = true;
+	if(policy == OverflowPolicy::REPORT)
+	{
+		dropped += used - kept;
+		return kept;
+	}
+
+	// The Contacts that did not fit are still sitting in scratch space right after the stored Contacts.
+	// Each one either replaces the shallowest stored Contact or is itself dropped
+	unsigned int overflow = used - kept;
+	for(unsigned int i = 0; i < overflow; ++i)
+	{
+		if(Replace(contacts[size + i]))
+			++kept;
+		++dropped;
+	}
+
+	return kept;
+}
+
+void ContactStream::Append(ContactStream& other)
+{
+	Contact* dest;
+	unsigned int n;
+	dropped += other.dropped;
+	for(unsigned int i = 0; i < other.size; i += MAX_CONTACTS_PER_TEST)
+	{
+		if((dest = Reserve()) == nullptr)
+		{
+			dropped += other.size - i;
+			return;
+		}
+
+		n = other.size - i < MAX_CONTACTS_PER_TEST ? other.size - i : MAX_CONTACTS_PER_TEST;
+		for(unsigned int j = 0; j < n; ++j)
+			dest[j] = other.contacts[i + j];
+		Commit(n);
+	}
+	overflowed = overflowed || other.overflowed;
+}
+
+Contact& ContactStream::operator[](unsigned int i)
+{
+	AssertMsg(i < size, "Contact Stream index out of range");
+	return contacts[i];
+}
+
+unsigned int ContactStream::GetSize() const { return size; }
+unsigned int ContactStream::GetBudget() const { return budget; }
+unsigned int ContactStream::GetHighWaterMark() const { return highWaterMark; }
+unsigned int ContactStream::GetDroppedCount() const { return dropped; }
+bool ContactStream::IsOverflowed() const { return overflowed; }
+bool ContactStream::IsFull() const { return size >= budget && (policy != OverflowPolicy::GROW || budget >= growthLimit); }
+
+void ContactStream::SetBudget(unsigned int b)
+{
+	AssertMsg(b > 0, "Contact Stream must be able to hold at least one Contact");
+	AssertMsg(size == 0, "Contact Stream budget can only be changed between steps");
+	budget = b;
+	if(growthLimit < budget)
+		growthLimit = budget;
+	EnsureStorage(budget + MAX_CONTACTS_PER_TEST);
+}
+
+void ContactStream::SetGrowthLimit(unsigned int l) { growthLimit = l < budget ? budget : l; }
+unsigned int ContactStream::GetGrowthLimit() const { return growthLimit; }
+void ContactStream::SetOverflowPolicy(OverflowPolicy p) { policy = p; }
+ContactStream::OverflowPolicy ContactStream::GetOverflowPolicy() const { return policy; }
+
+void ContactStream::EnsureStorage(unsigned int n)
+{
+	// Storage never shrinks, so this only allocates until the high-water mark is reached
+	if(contacts.size() < n)
+		contacts.resize(n);
+}
+
+void ContactStream::BuildHeap()
+{
+	heap.resize(size);
+	for(unsigned int i = 0; i < size; ++i)
+		heap[i] = i;
+	for(int i = (int)size / 2 - 1; i >= 0; --i)
+		SiftDown(i);
+	heapBuilt = true;
+}
+
+void ContactStream::SiftDown(unsigned int i)
+{
+	unsigned int n = heap.size(), smallest, l, r;
+	for(;;)
+	{
+		smallest = i;
+		l = 2 * i + 1;
+		r = l + 1;
+		if(l < n && HeapLess(l, smallest)) smallest = l;
+		if(r < n && HeapLess(r, smallest)) smallest = r;
+		if(smallest == i) return;
+		std::swap(heap[i], heap[smallest]);
+		i = smallest;
+	}
+}
+
+// Put 'c' in place of the shallowest stored Contact if 'c' is deeper
+// Returns true if 'c' was kept
+bool ContactStream::Replace(const Contact& c)
+{
+	if(size == 0) return false;
+	if(!heapBuilt)
+		BuildHeap();
+
+	if(c.penetrationDepth <= Priority(heap[0]))
+		return false;
+
+	contacts[heap[0]] = c;
+	SiftDown(0);
+	return true;
+}
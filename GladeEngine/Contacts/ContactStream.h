@@ -0,0 +1,80 @@
+#pragma once
+#ifndef GLADE_CONTACT_STREAM_H
+#define GLADE_CONTACT_STREAM_H
+
+#ifndef GLADE_CONTACT_H
+#include "Contact.h"
+#endif
+#include <vector>
+
+// Maximum number of Contacts any single Collision Test may write for one pair of Colliders
+#define MAX_CONTACTS_PER_TEST 4
+
+namespace Glade {
+// Per-step stream of all Contacts generated by collision detection
+//
+// Storage is kept between steps and only ever grows, so once the stream has seen its
+// high-water mark it no longer allocates. The budget is the number of Contacts the stream
+// will hold in one step. What happens when a step generates more than that is decided by
+// the Overflow Policy:
+//		GROW				- Budget is raised to fit, up to a hard growth limit. Past that limit, acts as DROP_LOWEST_PRIORITY
+//		DROP_LOWEST_PRIORITY - Stream stays full and a new Contact replaces the shallowest Contact currently held if it is deeper
+//		REPORT				- Extra Contacts are discarded and the stream is flagged as overflowed so collision detection can stop early
+class ContactStream
+{
+public:
+	enum class OverflowPolicy { GROW, DROP_LOWEST_PRIORITY, REPORT };
+
+	ContactStream(unsigned int budget_, OverflowPolicy policy_=OverflowPolicy::DROP_LOWEST_PRIORITY, unsigned int growthLimit_=0);
+
+	// Empty the stream for a new step. Storage and high-water mark are kept
+	void Clear();
+
+	// Get scratch space for one Collision Test to write up to MAX_CONTACTS_PER_TEST Contacts into
+	// Returns nullptr if the stream has overflowed under the REPORT policy
+	Contact* Reserve();
+
+	// Accept the first 'used' Contacts written into the space returned by the last call to Reserve
+	// Returns the number of Contacts that were actually stored
+	unsigned int Commit(unsigned int used);
+
+	// Copy all Contacts of another stream onto the end of this one, following this stream's Overflow Policy
+	void Append(ContactStream& other);
+
+	Contact&		operator[](unsigned int i);
+	unsigned int	GetSize() const;
+	unsigned int	GetBudget() const;
+	unsigned int	GetHighWaterMark() const;
+	unsigned int	GetDroppedCount() const;
+	bool			IsOverflowed() const;
+	bool			IsFull() const;
+
+	void			SetBudget(unsigned int b);
+	void			SetGrowthLimit(unsigned int l);
+	unsigned int	GetGrowthLimit() const;
+	void			SetOverflowPolicy(OverflowPolicy p);
+	OverflowPolicy	GetOverflowPolicy() const;
+
+private:
+	void			EnsureStorage(unsigned int n);
+	void			BuildHeap();
+	void			SiftDown(unsigned int i);
+	bool			Replace(const Contact& c);
+	// Deeper Contacts are more important to keep. Speculative Contacts have negative depth so they always go first
+	inline gFloat	Priority(unsigned int i) { return contacts[i].penetrationDepth; }
+	inline bool		HeapLess(unsigned int a, unsigned int b) { return Priority(heap[a]) < Priority(heap[b]); }
+
+	std::vector<Contact>		contacts;		// Backing storage, sized to high-water mark plus room for one test
+	std::vector<unsigned int>	heap;			// Min-heap of indices into 'contacts' by penetration depth. Only built once the stream is full
+	bool						heapBuilt;
+
+	OverflowPolicy	policy;
+	unsigned int	size;				// Number of Contacts stored this step
+	unsigned int	budget;				// Number of Contacts the stream will hold this step
+	unsigned int	growthLimit;		// Hard cap on the budget when growing
+	unsigned int	highWaterMark;		// Most Contacts stored in any one step
+	unsigned int	dropped;			// Number of Contacts dropped this step
+	bool			overflowed;			// Whether this step generated more Contacts than the stream could keep
+};
+}	// namespace Glade
+#endif	// GLADE_CONTACT_STREAM_H
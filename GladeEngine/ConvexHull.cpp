@@ -0,0 +1,458 @@
+#include "ConvexHull.h"
+#include "Math\MathMisc.h"
+#include "System\GeometryGenerator.h"
+#include <algorithm>
+#include <assert.h>
+
+using namespace Glade;
+
+// Triangle of the hull while quickhull is building it
+struct QuickhullFace
+{
+	unsigned int				v[3];		// Indices into the input points
+	Vector						normal;
+	gFloat						dist;		// Distance from origin to face's plane
+	std::vector<unsigned int>	outside;	// Points above this face that aren't on the hull yet
+	unsigned int				farthest;	// The one farthest above it
+	gFloat						farthestDist;
+	bool						removed;
+};
+
+ConvexHull::ConvexHull(const std::vector<Vector>& points, unsigned int maxVertices)
+{
+	Build(points, maxVertices);
+}
+
+ConvexHull::ConvexHull(SmartPointer<MeshData> mesh, unsigned int maxVertices)
+{
+	std::vector<Vector> points;
+	points.reserve(mesh->vertices.size());
+	for(unsigned int i = 0; i < mesh->vertices.size(); ++i)
+		points.push_back(Vector(mesh->vertices[i].position.x, mesh->vertices[i].position.y, mesh->vertices[i].position.z));
+	Build(points, maxVertices);
+}
+
+void ConvexHull::Build(const std::vector<Vector>& points, unsigned int maxVertices)
+{
+	assert(points.size() >= 4 && maxVertices >= 4);
+
+	// Points farthest along each axis
+	unsigned int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	for(unsigned int i = 1; i < points.size(); ++i)
+	{
+		for(unsigned int j = 0; j < 3; ++j)
+		{
+			if(points[i][j] > points[extremes[j * 2]][j])		extremes[j * 2] = i;
+			if(points[i][j] < points[extremes[j * 2 + 1]][j])	extremes[j * 2 + 1] = i;
+		}
+	}
+
+	// Points closer than this to a face are treated as on it, scaled to the size of the point cloud
+	Vector size(points[extremes[0]].x - points[extremes[1]].x, points[extremes[2]].y - points[extremes[3]].y, points[extremes[4]].z - points[extremes[5]].z);
+	gFloat tolerance = size.Magnitude() * gFloat(0.00001f);
+
+	// Starting tetrahedron: the 2 extreme points farthest apart...
+	unsigned int i0 = extremes[0], i1 = extremes[1];
+	gFloat d, best = gFloat(-1.0f);
+	for(unsigned int a = 0; a < 6; ++a)
+	{
+		for(unsigned int b = a + 1; b < 6; ++b)
+		{
+			d = (points[extremes[a]] - points[extremes[b]]).SquaredMagnitude();
+			if(d > best)
+			{
+				best = d;
+				i0 = extremes[a];
+				i1 = extremes[b];
+			}
+		}
+	}
+
+	// ...the point farthest from the line through them...
+	Vector line = (points[i1] - points[i0]).Normalized(), r;
+	unsigned int i2 = i0;
+	best = gFloat(0.0f);
+	for(unsigned int i = 0; i < points.size(); ++i)
+	{
+		r = points[i] - points[i0];
+		d = (r - line * r.DotProduct(line)).SquaredMagnitude();
+		if(d > best)
+		{
+			best = d;
+			i2 = i;
+		}
+	}
+	bool straight = best <= tolerance * tolerance;
+	bool flat = straight;
+
+	// ...and the point farthest from the plane through all 3
+	Vector normal = (points[i1] - points[i0]).CrossProduct(points[i2] - points[i0]).Normalized();
+	unsigned int i3 = i0;
+	best = gFloat(0.0f);
+	for(unsigned int i = 0; !flat && i < points.size(); ++i)
+	{
+		d = Abs((points[i] - points[i0]).DotProduct(normal));
+		if(d > best)
+		{
+			best = d;
+			i3 = i;
+		}
+	}
+	flat = flat || best <= tolerance;
+
+	if(flat)
+	{
+		// Points all lie in a plane (or on a line), there is no volume to wrap a hull around
+		// Keep the polygon around them instead, each vertex a neighbour of the ones before and after it
+		// Hill climbing around a convex polygon finds the farthest vertex the same as over a hull
+		std::vector<unsigned int> ring;
+		if(straight)
+		{
+			ring.push_back(i0);
+			ring.push_back(i1);
+		}
+		else
+		{
+			// Andrew's monotone chain, on coordinates along 'line' and across it in the plane
+			Vector across = normal.CrossProduct(line);
+			std::vector<gFloat> x(points.size()), y(points.size());
+			std::vector<unsigned int> order(points.size());
+			for(unsigned int i = 0; i < points.size(); ++i)
+			{
+				r = points[i] - points[i0];
+				x[i] = r.DotProduct(line);
+				y[i] = r.DotProduct(across);
+				order[i] = i;
+			}
+			std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return x[a] < x[b] || (x[a] == x[b] && y[a] < y[b]); });
+			auto turn = [&](unsigned int a, unsigned int b, unsigned int c) { return (x[b] - x[a]) * (y[c] - y[a]) - (y[b] - y[a]) * (x[c] - x[a]); };
+
+			// Lower chain left to right, then upper chain right to left, dropping points that don't turn left
+			// Each chain's last point is the first of the next one
+			for(unsigned int pass = 0; pass < 2; ++pass)
+			{
+				unsigned int start = ring.size();
+				for(unsigned int k = 0; k < order.size(); ++k)
+				{
+					unsigned int p = order[pass == 0 ? k : order.size() - 1 - k];
+					while(ring.size() >= start + 2 && turn(ring[ring.size() - 2], ring.back(), p) <= gFloat(0.0f))
+						ring.pop_back();
+					ring.push_back(p);
+				}
+				ring.pop_back();
+			}
+		}
+
+		neighbourStart.push_back(0);
+		for(unsigned int i = 0; i < ring.size(); ++i)
+		{
+			vertices.push_back(points[ring[i]]);
+			neighbours.push_back((i + 1) % ring.size());
+			if(ring.size() > 2)
+				neighbours.push_back((i + ring.size() - 1) % ring.size());
+			neighbourStart.push_back(neighbours.size());
+		}
+	}
+	else
+	{
+		// Every face is wound so its normal points away from a point inside the starting tetrahedron
+		// The hull only ever grows, so that point stays inside it
+		Vector inside = (points[i0] + points[i1] + points[i2] + points[i3]) * gFloat(0.25f);
+		std::vector<QuickhullFace> faces;
+		auto addFace = [&](unsigned int a, unsigned int b, unsigned int c)
+		{
+			QuickhullFace f;
+			f.v[0] = a;	f.v[1] = b;	f.v[2] = c;
+			f.normal = (points[b] - points[a]).CrossProduct(points[c] - points[a]).Normalized();
+			f.dist = f.normal.DotProduct(points[a]);
+			if(f.normal.DotProduct(inside) > f.dist)
+			{
+				Swap<unsigned int>(f.v[1], f.v[2]);
+				f.normal = -f.normal;
+				f.dist = -f.dist;
+			}
+			f.farthestDist = gFloat(0.0f);
+			f.removed = false;
+			faces.push_back(f);
+		};
+
+		// Give a point to the first face from 'first' on that it is above
+		auto assign = [&](unsigned int p, unsigned int first) -> bool
+		{
+			for(unsigned int f = first; f < faces.size(); ++f)
+			{
+				if(faces[f].removed) continue;
+				gFloat dist = faces[f].normal.DotProduct(points[p]) - faces[f].dist;
+				if(dist > tolerance)
+				{
+					faces[f].outside.push_back(p);
+					if(dist > faces[f].farthestDist)
+					{
+						faces[f].farthest = p;
+						faces[f].farthestDist = dist;
+					}
+					return true;
+				}
+			}
+			return false;
+		};
+
+		addFace(i0, i1, i2);
+		addFace(i0, i3, i1);
+		addFace(i1, i3, i2);
+		addFace(i2, i3, i0);
+		for(unsigned int i = 0; i < points.size(); ++i)
+			if(i != i0 && i != i1 && i != i2 && i != i3)
+				assign(i, 0);
+
+		std::vector<unsigned int> visible, horizon, orphans;
+		// One point is added per pass, counting the tetrahedron's 4. Points added earlier can end up inside later
+		// faces, so this bounds the passes, not the number of vertices the hull ends with
+		for(unsigned int pointsAdded = 4; pointsAdded < maxVertices; ++pointsAdded)
+		{
+			// Point farthest outside the hull so far
+			int top = -1;
+			gFloat topDist = gFloat(0.0f);
+			for(unsigned int f = 0; f < faces.size(); ++f)
+			{
+				if(!faces[f].removed && !faces[f].outside.empty() && faces[f].farthestDist > topDist)
+				{
+					top = f;
+					topDist = faces[f].farthestDist;
+				}
+			}
+			if(top < 0) break;	// Every point is on or inside the hull
+			unsigned int p = faces[top].farthest;
+
+			// Faces the point is above at all are replaced, even by less than the tolerance. Any left would bend
+			// inwards where they meet the new faces
+			visible.clear();
+			for(unsigned int f = 0; f < faces.size(); ++f)
+				if(!faces[f].removed && faces[f].normal.DotProduct(points[p]) - faces[f].dist > gFloat(0.0f))
+					visible.push_back(f);
+
+			// Horizon: edges of replaced faces that are shared with a face that stays
+			horizon.clear();
+			for(unsigned int i = 0; i < visible.size(); ++i)
+			{
+				const QuickhullFace& f = faces[visible[i]];
+				for(unsigned int e = 0; e < 3; ++e)
+				{
+					unsigned int a = f.v[e], b = f.v[(e + 1) % 3];
+					bool shared = false;
+					for(unsigned int j = 0; j < visible.size() && !shared; ++j)
+					{
+						const QuickhullFace& g = faces[visible[j]];
+						for(unsigned int e2 = 0; e2 < 3; ++e2)
+							if(g.v[e2] == b && g.v[(e2 + 1) % 3] == a) shared = true;
+					}
+					if(!shared)
+					{
+						horizon.push_back(a);
+						horizon.push_back(b);
+					}
+				}
+			}
+
+			// Points above the replaced faces have to find new ones
+			orphans.clear();
+			for(unsigned int i = 0; i < visible.size(); ++i)
+			{
+				QuickhullFace& f = faces[visible[i]];
+				f.removed = true;
+				for(unsigned int j = 0; j < f.outside.size(); ++j)
+					if(f.outside[j] != p) orphans.push_back(f.outside[j]);
+				std::vector<unsigned int>().swap(f.outside);
+			}
+
+			// Fan of new faces from the point to the horizon
+			unsigned int first = faces.size();
+			for(unsigned int i = 0; i < horizon.size(); i += 2)
+				addFace(horizon[i], horizon[i + 1], p);
+			// Usually a new face, but it may have been above a face that stays too. Points above none are inside the hull
+			for(unsigned int i = 0; i < orphans.size(); ++i)
+				if(!assign(orphans[i], first))
+					assign(orphans[i], 0);
+		}
+
+		// Keep only the points the final faces use
+		std::vector<int> remap(points.size(), -1);
+		for(unsigned int f = 0; f < faces.size(); ++f)
+		{
+			if(faces[f].removed) continue;
+			for(unsigned int i = 0; i < 3; ++i)
+			{
+				unsigned int v = faces[f].v[i];
+				if(remap[v] < 0)
+				{
+					remap[v] = vertices.size();
+					vertices.push_back(points[v]);
+				}
+				triangles.push_back(remap[v]);
+			}
+		}
+
+		// Vertices that share an edge
+		std::vector<std::vector<unsigned int>> adjacent(vertices.size());
+		for(unsigned int i = 0; i < triangles.size(); i += 3)
+		{
+			for(unsigned int e = 0; e < 3; ++e)
+			{
+				unsigned int a = triangles[i + e], b = triangles[i + (e + 1) % 3];
+				if(std::find(adjacent[a].begin(), adjacent[a].end(), b) == adjacent[a].end()) adjacent[a].push_back(b);
+				if(std::find(adjacent[b].begin(), adjacent[b].end(), a) == adjacent[b].end()) adjacent[b].push_back(a);
+			}
+		}
+		neighbourStart.push_back(0);
+		for(unsigned int i = 0; i < adjacent.size(); ++i)
+		{
+			neighbours.insert(neighbours.end(), adjacent[i].begin(), adjacent[i].end());
+			neighbourStart.push_back(neighbours.size());
+		}
+	}
+
+	CalcMassProperties();
+
+	// Bounds and hill climbing starts, now vertices are relative to the centroid
+	Vector minimum = vertices[0], maximum = vertices[0];
+	for(unsigned int i = 0; i < 6; ++i)
+		axisSupport[i] = 0;
+	for(unsigned int i = 1; i < vertices.size(); ++i)
+	{
+		minimum = Vector::VectorMin(minimum, vertices[i]);
+		maximum = Vector::VectorMax(maximum, vertices[i]);
+		for(unsigned int j = 0; j < 3; ++j)
+		{
+			if(vertices[i][j] > vertices[axisSupport[j * 2]][j])		axisSupport[j * 2] = i;
+			if(vertices[i][j] < vertices[axisSupport[j * 2 + 1]][j])	axisSupport[j * 2 + 1] = i;
+		}
+	}
+	bounds = AABB(minimum, maximum);
+}
+
+void ConvexHull::CalcMassProperties()
+{
+	// Split the hull into tetrahedra from a point inside it to each triangle
+	Vector origin;
+	for(unsigned int i = 0; i < vertices.size(); ++i)
+		origin += vertices[i];
+	origin /= gFloat(vertices.size());
+
+	Vector a, b, c, weighted;
+	gFloat v;
+	volume = gFloat(0.0f);
+	for(unsigned int i = 0; i < GetNumTriangles(); ++i)
+	{
+		GetTriangle(i, a, b, c);
+		a -= origin;	b -= origin;	c -= origin;
+		v = a.DotProduct(b.CrossProduct(c)) / gFloat(6.0f);
+		volume += v;
+		weighted += (a + b + c) * (v * gFloat(0.25f));
+	}
+
+	if(volume <= G_FLT_SMALL)
+	{
+		// Flat, treat it as the box around it
+		centroid = origin;
+		for(unsigned int i = 0; i < vertices.size(); ++i)
+			vertices[i] -= centroid;
+		Vector minimum = vertices[0], maximum = vertices[0];
+		for(unsigned int i = 1; i < vertices.size(); ++i)
+		{
+			minimum = Vector::VectorMin(minimum, vertices[i]);
+			maximum = Vector::VectorMax(maximum, vertices[i]);
+		}
+		unitInertiaTensor = Matrix::CuboidInertiaTensor(gFloat(1.0f), maximum - minimum);
+		return;
+	}
+
+	centroid = origin + weighted / volume;
+	for(unsigned int i = 0; i < vertices.size(); ++i)
+		vertices[i] -= centroid;
+
+	// Second moments of volume around the centroid. For a tetrahedron with one corner at the origin and the others at a, b, c:
+	//		integral of x_i * x_j = (volume / 20) * (a_i*a_j + b_i*b_j + c_i*c_j + s_i*s_j), where s = a + b + c
+	gFloat cov[3][3] = { { 0 } };
+	Vector s;
+	for(unsigned int i = 0; i < GetNumTriangles(); ++i)
+	{
+		GetTriangle(i, a, b, c);
+		v = a.DotProduct(b.CrossProduct(c)) / gFloat(6.0f);
+		s = a + b + c;
+		for(unsigned int j = 0; j < 3; ++j)
+			for(unsigned int k = 0; k < 3; ++k)
+				cov[j][k] += v / gFloat(20.0f) * (a[j] * a[k] + b[j] * b[k] + c[j] * c[k] + s[j] * s[k]);
+	}
+
+	// Inertia Tensor = trace(cov) * I - cov, divided by volume for a mass of 1
+	gFloat trace = cov[0][0] + cov[1][1] + cov[2][2];
+	gFloat inertia[16] = {
+		(trace - cov[0][0]) / volume,	-cov[0][1] / volume,			-cov[0][2] / volume,			0.0f,
+		-cov[1][0] / volume,			(trace - cov[1][1]) / volume,	-cov[1][2] / volume,			0.0f,
+		-cov[2][0] / volume,			-cov[2][1] / volume,			(trace - cov[2][2]) / volume,	0.0f,
+		0.0f,							0.0f,							0.0f,							1.0f
+	};
+	unitInertiaTensor = Matrix(inertia);
+}
+
+unsigned int ConvexHull::Support(const Vector& d) const
+{
+	// Start from the vertex farthest along whichever axis 'd' is closest to
+	unsigned int axis = 0;
+	if(Abs(d.y) > Abs(d[axis])) axis = 1;
+	if(Abs(d.z) > Abs(d[axis])) axis = 2;
+	unsigned int best = axisSupport[axis * 2 + (d[axis] < gFloat(0.0f) ? 1 : 0)], current;
+	gFloat bestDot = vertices[best].DotProduct(d), dot;
+
+	// Climb to a neighbour farther along 'd' until there are none. On a convex hull that vertex is the farthest of all
+	do
+	{
+		current = best;
+		for(unsigned int i = neighbourStart[current]; i < neighbourStart[current + 1]; ++i)
+		{
+			dot = vertices[neighbours[i]].DotProduct(d);
+			if(dot > bestDot)
+			{
+				bestDot = dot;
+				best = neighbours[i];
+			}
+		}
+	} while(best != current);
+
+	return best;
+}
+
+bool ConvexHull::RayCast(const Ray& ray, gFloat& t) const
+{
+	if(triangles.empty())
+		return false;
+
+	// Clip the ray to the inside of every triangle's plane
+	gFloat tEnter = gFloat(0.0f), tExit = ray.len, len, denom, dist;
+	Vector a, b, c, n;
+	for(unsigned int i = 0; i < GetNumTriangles(); ++i)
+	{
+		GetTriangle(i, a, b, c);
+		n = (b - a).CrossProduct(c - a);
+		len = n.Magnitude();
+		if(len < G_FLT_SMALL) continue;	// Degenerate Triangle
+		n /= len;
+
+		denom = n.DotProduct(ray.dir);
+		dist = n.DotProduct(ray.origin - a);	// Positive outside
+		if(Abs(denom) < EPSILON)
+		{
+			// Parallel to the plane, entirely outside it or entirely inside
+			if(dist > gFloat(0.0f)) return false;
+			continue;
+		}
+		if(denom < gFloat(0.0f))
+			tEnter = Max(tEnter, -dist / denom);
+		else
+			tExit = Min(tExit, -dist / denom);
+		if(tEnter > tExit) return false;
+	}
+
+	t = tEnter;
+	return true;
+}
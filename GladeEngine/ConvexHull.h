@@ -0,0 +1,77 @@
+#pragma once
+#ifndef GLADE_CONVEX_HULL_H
+#define GLADE_CONVEX_HULL_H
+
+#include "GladeConfig.h"
+#ifndef GLADE_VECTOR_H
+#include "Math\Vector.h"
+#endif
+#ifndef GLADE_MATRIX_H
+#include "Math\Matrix.h"
+#endif
+#include "Math\AABB.h"
+#include "Math\Ray.h"
+#include "Utils\SmartPointer\SmartPointer.h"
+#include <vector>
+
+// Most vertices kept on a ConvexHull unless asked for more
+#define CONVEX_HULL_MAX_VERTICES	64
+
+namespace Glade {
+class MeshData;
+
+// Convex hull of a cloud of points, built with quickhull. Shared by ConvexHullColliders
+// Quickhull adds the point farthest outside the hull so far each iteration, so stopping once 'maxVertices' points have been
+// added keeps the points that matter most to its shape and drops the fine detail. The hull ends with at most that many vertices.
+//
+// Vertices are stored relative to the hull's centroid, with the triangles between them and the vertices each one shares an
+// edge with. Support points are found by hill climbing over those neighbours: start from a vertex already far along the
+// query direction and step to any neighbour farther along it until none is. On a convex hull that is the farthest vertex,
+// and the walk only crosses part of the hull (about sqrt(n) vertices) instead of testing all of them
+class ConvexHull
+{
+public:
+	// Hull of 'points'. If they all lie in a plane the hull is the flat polygon around them, with no triangles
+	ConvexHull(const std::vector<Vector>& points, unsigned int maxVertices=CONVEX_HULL_MAX_VERTICES);
+	// Hull of the vertex buffer of a rendered mesh
+	ConvexHull(SmartPointer<MeshData> mesh, unsigned int maxVertices=CONVEX_HULL_MAX_VERTICES);
+
+	unsigned int GetNumVertices() const { return vertices.size(); }
+	const Vector& GetVertex(unsigned int i) const { return vertices[i]; }
+	unsigned int GetNumTriangles() const { return triangles.size() / 3; }
+	void GetTriangle(unsigned int i, Vector& a, Vector& b, Vector& c) const
+	{
+		a = vertices[triangles[i * 3]];
+		b = vertices[triangles[i * 3 + 1]];
+		c = vertices[triangles[i * 3 + 2]];
+	}
+	const AABB& GetBounds() const { return bounds; }
+
+	// Where the centroid was among the original points. Vertices are relative to it
+	const Vector& GetCentroid() const { return centroid; }
+	gFloat GetVolume() const { return volume; }
+	// Inertia Tensor around the centroid for a mass of 1
+	const Matrix& GetUnitInertiaTensor() const { return unitInertiaTensor; }
+
+	// Index of the vertex farthest along 'd'
+	unsigned int Support(const Vector& d) const;
+
+	// Find where 'ray' enters the hull within ray.len. 't' is set to the distance along ray.dir
+	bool RayCast(const Ray& ray, gFloat& t) const;
+
+private:
+	void Build(const std::vector<Vector>& points, unsigned int maxVertices);
+	void CalcMassProperties();
+
+	std::vector<Vector>			vertices;
+	std::vector<unsigned int>	triangles;		// 3 vertex indices per triangle, counter-clockwise seen from outside
+	std::vector<unsigned int>	neighbourStart;	// Neighbours of vertex i are neighbours[neighbourStart[i]] to neighbours[neighbourStart[i + 1] - 1]
+	std::vector<unsigned int>	neighbours;
+	unsigned int				axisSupport[6];	// Vertex farthest along +x, -x, +y, -y, +z, -z. Where hill climbing starts
+	AABB						bounds;
+	Vector						centroid;
+	gFloat						volume;
+	Matrix						unitInertiaTensor;
+};
+}	// namespace
+#endif	// GLADE_CONVEX_HULL_H
@@ -26,6 +26,38 @@
 #define SOLVE_PENETRATION_ITERATIVE
 #endif
 
+// Define which method of velocity resolution is used during Contact Resolution
+// Iterative resolves the Contact needing the largest change in velocity on each iteration, then updates
+//		every other Contact sharing its RigidBodies
+// Sequential Impulses (Projected Gauss-Seidel) sweeps every Contact in the Batch in order, PGS_ITERATIONS
+//		times, accumulating each Contact's normal and friction impulses and clamping the totals:
+//		the normal impulse never pulls and friction stays inside its cone
+// Comment out the following line to use Iterative. Leave following line to use Sequential Impulses
+//#define SOLVE_VELOCITY_PGS
+#ifdef SOLVE_VELOCITY_PGS
+// Sweeps over every Contact in a Batch, when the World calculates iterations itself
+#define PGS_ITERATIONS 10
+#endif
+// Define whether Sequential Impulses resolve a Batch's Contacts in parallel (ignored without SOLVE_VELOCITY_PGS)
+// Contacts are coloured so no two of one colour share a RigidBody that can move (infinite mass RigidBodies
+//		are ignored), then each colour is split across PHYSICS_THREADS. Contacts are swept colour by colour
+//		whatever the number of threads, so results only depend on the order Contacts were added in
+// Comment out the following line to sweep Contacts in Batch order on one thread
+#define PARALLEL_CONTACT_SOLVE
+#if defined(PARALLEL_CONTACT_SOLVE) && !defined(SOLVE_VELOCITY_PGS)
+#undef PARALLEL_CONTACT_SOLVE
+#endif
+// Define whether independent ContactBatches are resolved at the same time on PHYSICS_THREADS
+// Batches share no RigidBodies, so each is resolved whole by one thread, largest first. With PARALLEL_CONTACT_SOLVE
+//		a Batch holding more than its share of the step's Contacts is instead resolved before the rest, across every thread
+// Comment out the following line to resolve Batches one after another
+#define PARALLEL_CONTACT_BATCHES
+// Iterative velocity or interpenetration resolution picks the worst Contact each iteration from a heap,
+//		and only updates the Contacts sharing its RigidBodies
+#if !defined(SOLVE_VELOCITY_PGS) || defined(SOLVE_PENETRATION_ITERATIVE)
+#define SOLVE_WORST_CONTACT_FIRST
+#endif
+
 // Define whether Bounding Spheres or AABB are used for Frustum Culling tests for rendering
 // Comment out the following line to use AABBs. Leave the following line to use Spheres
 //#define FRUSTUM_CULLING_SPHERES
@@ -69,6 +101,74 @@
 #define SLEEP_TEST_ENERGY
 #endif
 
+// Define whether RigidBodies are put to sleep on their own or as Islands
+// Islands are groups of RigidBodies connected by Contacts. A RigidBody passing the sleep test only marks itself
+//		ready to sleep, and the whole Island is put to sleep once all of its RigidBodies are ready. A sleeping Island
+//		is skipped by integration, broadphase and Contact resolution until an awake RigidBody touches it
+// Comment out the following line to put each RigidBody to sleep as soon as it passes the sleep test
+#define SLEEP_ISLANDS
+
+// Define whether RigidBodies that are close, but not touching, generate Speculative Contacts
+// Pairs within the distance they could close in one step (from their relative velocity) get a Contact with
+//		negative penetration. The Contact only removes the velocity that would make them penetrate, which
+//		stops fast RigidBodies from passing through each other without needing smaller timesteps
+// Comment out the following line to only generate Contacts for touching Colliders
+#define SPECULATIVE_CONTACTS
+
+// Define whether RigidBodies can turn on Continuous Collision Detection (CCD)
+// A RigidBody with CCD on is swept from where it started each step to where it ended up. Its swept AABB is used by
+//		broadphase, and if it would have hit something along the way it is moved back to the Time of Impact (TOI)
+//		before Contacts are generated, so fast RigidBodies can't pass through thin ones between steps
+//		Only RigidBodies with CCD turned on pay for it. The Speculative Contact at the TOI is what stops the RigidBody,
+//		so this needs SPECULATIVE_CONTACTS
+// Comment out the following line to only test RigidBodies where they end each step
+#define CONTINUOUS_COLLISION
+#if defined(CONTINUOUS_COLLISION) && !defined(SPECULATIVE_CONTACTS)
+#undef CONTINUOUS_COLLISION
+#endif
+
+// Define whether narrowphase results are kept for each pair of RigidBodies between steps
+// If a pair has barely moved relative to each other since it was last fully tested, the Contacts from that test
+//		are moved along with the RigidBodies instead of running the Collision Tests again. Tolerances are in World.h
+// Comment out the following line to fully test every pair every step
+#define NARROWPHASE_CACHE
+
+// Define whether Collision Tests start from what separated each pair of Colliders last step
+// GJK starts its search from last step's separating direction, Box-Box tests last step's separating axis first
+//		Most pairs are separated the same way as last step, so most tests can stop right away
+//		This is kept with each pair's narrowphase cache, so this needs NARROWPHASE_CACHE
+// Comment out the following line to always run Collision Tests from scratch
+#define COLLISION_WARM_START
+#if defined(COLLISION_WARM_START) && !defined(NARROWPHASE_CACHE)
+#undef COLLISION_WARM_START
+#endif
+
+// Define whether Sphere-Sphere and Sphere-Plane pairs are tested in batches
+// RigidBodies with a single Sphere Collider (debris, particles) are gathered by narrowphase and tested together,
+//		several pairs at a time with SIMD where available, instead of one at a time through the Collision Test table
+// Comment out the following line to test every pair on its own
+#define BATCH_SPHERE_TESTS
+
+// Define whether batched Sphere tests run in float when gFloat is double
+// Each pair is tested relative to its Sphere's center, which stays in gFloat, so only the small offsets between
+//		the pair's shapes are floats. Precision doesn't depend on how far from the world origin the pair is,
+//		and SIMD tests 4 pairs at a time instead of 2. Has no effect with SINGLE_PRECISION
+// Comment out the following line to run batched Sphere tests in gFloat
+#define MIXED_PRECISION_BATCHES
+#if defined(MIXED_PRECISION_BATCHES) && !defined(BATCH_SPHERE_TESTS)
+#undef MIXED_PRECISION_BATCHES
+#endif
+
+// Define whether RigidBodies that moved this step move their Colliders together after all of them have integrated
+// Sphere and Box Colliders are moved several at a time with SIMD (see ColliderUpdateBatch.h), and the work is
+//		split across PHYSICS_THREADS like narrowphase
+// Comment out the following line to move each RigidBody's Colliders as soon as it integrates
+#define BATCH_COLLIDER_UPDATE
+
+// Number of threads physics work (narrowphase) is split across, including the thread calling World::PhysicsUpdate
+// Set to 0 to use one thread per hardware thread. Set to 1 to keep all physics on the calling thread
+#define PHYSICS_THREADS 0
+
 #ifdef _MSC_VER
 #pragma warning (disable: 4800)
 #pragma warning (disable: 4018)
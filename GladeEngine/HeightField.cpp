@@ -0,0 +1,192 @@
+#include "HeightField.h"
+#include "Math\MathMisc.h"
+#include <assert.h>
+
+using namespace Glade;
+
+HeightField::HeightField(const std::vector<gFloat>& heights, unsigned int nX, unsigned int nZ, gFloat s) : numX(nX), numZ(nZ), spacing(s)
+{
+	assert(numX >= 2 && numZ >= 2 && heights.size() >= numX * numZ);
+
+	// Quantize heights between the lowest and highest sample
+	gFloat maxHeight = -G_MAX;
+	minHeight = G_MAX;
+	for(unsigned int i = 0; i < numX * numZ; ++i)
+	{
+		minHeight = Min(minHeight, heights[i]);
+		maxHeight = Max(maxHeight, heights[i]);
+	}
+	heightScale = maxHeight - minHeight > EPSILON ? (maxHeight - minHeight) / gFloat(65535.0f) : gFloat(1.0f);
+	samples.resize(numX * numZ);
+	for(unsigned int i = 0; i < numX * numZ; ++i)
+		samples[i] = (unsigned short)((heights[i] - minHeight) / heightScale + gFloat(0.5f));
+
+	bounds = AABB(Vector(gFloat(0.0f), minHeight, gFloat(0.0f)), Vector((numX - 1) * spacing, maxHeight, (numZ - 1) * spacing));
+
+	// Level 0: height range of each cell's 4 samples
+	unsigned int width = numX - 1, depth = numZ - 1;
+	pyramid.push_back(std::vector<Range>(width * depth));
+	levelWidths.push_back(width);
+	levelDepths.push_back(depth);
+	for(unsigned int z = 0; z < depth; ++z)
+	{
+		for(unsigned int x = 0; x < width; ++x)
+		{
+			const unsigned short* row = &samples[z * numX + x];
+			Range& r = pyramid[0][z * width + x];
+			r.minimum = Min(Min(row[0], row[1]), Min(row[numX], row[numX + 1]));
+			r.maximum = Max(Max(row[0], row[1]), Max(row[numX], row[numX + 1]));
+		}
+	}
+
+	// Each level above covers 2x2 blocks of the one below, until one block covers everything
+	while(width > 1 || depth > 1)
+	{
+		unsigned int level = pyramid.size();
+		unsigned int childWidth = width, childDepth = depth;
+		width = (width + 1) / 2;
+		depth = (depth + 1) / 2;
+		pyramid.push_back(std::vector<Range>(width * depth));
+		levelWidths.push_back(width);
+		levelDepths.push_back(depth);
+
+		for(unsigned int z = 0; z < depth; ++z)
+		{
+			for(unsigned int x = 0; x < width; ++x)
+			{
+				Range& r = pyramid[level][z * width + x];
+				r.minimum = 65535;
+				r.maximum = 0;
+				for(unsigned int cz = z * 2; cz < Min(z * 2 + 2, childDepth); ++cz)
+				{
+					for(unsigned int cx = x * 2; cx < Min(x * 2 + 2, childWidth); ++cx)
+					{
+						const Range& c = pyramid[level - 1][cz * childWidth + cx];
+						r.minimum = Min(r.minimum, c.minimum);
+						r.maximum = Max(r.maximum, c.maximum);
+					}
+				}
+			}
+		}
+	}
+}
+
+void HeightField::GetTriangle(unsigned int i, Vector& a, Vector& b, Vector& c) const
+{
+	unsigned int cell = i / 2;
+	unsigned int x = cell % (numX - 1), z = cell / (numX - 1);
+
+	// Both triangles wind counter-clockwise seen from above, so their normals point up
+	if(i % 2 == 0)
+	{
+		a = Vector(x * spacing, GetHeight(x, z), z * spacing);
+		b = Vector(x * spacing, GetHeight(x, z + 1), (z + 1) * spacing);
+		c = Vector((x + 1) * spacing, GetHeight(x + 1, z), z * spacing);
+	}
+	else
+	{
+		a = Vector((x + 1) * spacing, GetHeight(x + 1, z), z * spacing);
+		b = Vector(x * spacing, GetHeight(x, z + 1), (z + 1) * spacing);
+		c = Vector((x + 1) * spacing, GetHeight(x + 1, z + 1), (z + 1) * spacing);
+	}
+}
+
+unsigned short HeightField::Quantize(gFloat h, bool roundUp) const
+{
+	gFloat f = (h - minHeight) / heightScale;
+	f = roundUp ? Ceiling(f) : Floor(f);
+	return (unsigned short)Clamp(f, gFloat(0.0f), gFloat(65535.0f));
+}
+
+bool HeightField::RayCast(const Ray& ray, gFloat& t, unsigned int& triangle) const
+{
+	// Clip ray to the heightfield's bounds
+	gFloat tEnter = gFloat(0.0f), tExit = ray.len, t1, t2, inv;
+	for(unsigned int j = 0; j < 3; ++j)
+	{
+		if(Abs(ray.dir[j]) < EPSILON)
+		{
+			if(ray.origin[j] < bounds.minimum[j] || ray.origin[j] > bounds.maximum[j])
+				return false;
+			continue;
+		}
+		inv = gFloat(1.0f) / ray.dir[j];
+		t1 = (bounds.minimum[j] - ray.origin[j]) * inv;
+		t2 = (bounds.maximum[j] - ray.origin[j]) * inv;
+		if(t1 > t2) Swap<gFloat>(t1, t2);
+		tEnter = Max(tEnter, t1);
+		tExit = Min(tExit, t2);
+		if(tEnter > tExit) return false;
+	}
+
+	// Walk the cells under the ray in order (2D DDA), from where it enters the bounds to where it leaves
+	Vector start = ray.origin + ray.dir * tEnter;
+	gFloat f = Floor(start.x / spacing);
+	int x = (int)Clamp(f, gFloat(0.0f), gFloat(numX - 2));
+	f = Floor(start.z / spacing);
+	int z = (int)Clamp(f, gFloat(0.0f), gFloat(numZ - 2));
+
+	int stepX = ray.dir.x > gFloat(0.0f) ? 1 : -1, stepZ = ray.dir.z > gFloat(0.0f) ? 1 : -1;
+	gFloat tDeltaX = G_MAX, tDeltaZ = G_MAX, tMaxX = G_MAX, tMaxZ = G_MAX;
+	if(Abs(ray.dir.x) >= EPSILON)
+	{
+		tDeltaX = spacing / Abs(ray.dir.x);
+		tMaxX = ((x + (stepX > 0 ? 1 : 0)) * spacing - ray.origin.x) / ray.dir.x;
+	}
+	if(Abs(ray.dir.z) >= EPSILON)
+	{
+		tDeltaZ = spacing / Abs(ray.dir.z);
+		tMaxZ = ((z + (stepZ > 0 ? 1 : 0)) * spacing - ray.origin.z) / ray.dir.z;
+	}
+
+	gFloat tCell = tEnter, tNext, y1, y2, tHit;
+	Vector a, b, c;
+	while(true)
+	{
+		// Only test the cell's triangles if the ray's heights over the cell overlap the cell's heights
+		tNext = Min(tExit, Min(tMaxX, tMaxZ));
+		y1 = ray.origin.y + ray.dir.y * tCell;
+		y2 = ray.origin.y + ray.dir.y * tNext;
+		if(y1 > y2) Swap<gFloat>(y1, y2);
+		const Range& r = pyramid[0][z * (numX - 1) + x];
+		if(Quantize(y1, false) <= r.maximum && Quantize(y2, true) >= r.minimum)
+		{
+			// Triangles lie inside their cell's column, so the first hit found is the closest
+			unsigned int cell = z * (numX - 1) + x;
+			gFloat best = G_MAX;
+			for(unsigned int i = cell * 2; i <= cell * 2 + 1; ++i)
+			{
+				GetTriangle(i, a, b, c);
+				if(ray.IntersectTriangle(a, b, c, tHit) && tHit < best)
+				{
+					best = tHit;
+					triangle = i;
+				}
+			}
+			if(best < G_MAX)
+			{
+				t = best;
+				return true;
+			}
+		}
+
+		if(tNext >= tExit) break;
+
+		// Step into the next cell along x or z, whichever boundary the ray crosses first
+		if(tMaxX < tMaxZ)
+		{
+			x += stepX;
+			tCell = tMaxX;
+			tMaxX += tDeltaX;
+		}
+		else
+		{
+			z += stepZ;
+			tCell = tMaxZ;
+			tMaxZ += tDeltaZ;
+		}
+		if(x < 0 || z < 0 || x > (int)numX - 2 || z > (int)numZ - 2) break;
+	}
+
+	return false;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#ifndef GLADE_HEIGHT_FIELD_H
+#define GLADE_HEIGHT_FIELD_H
+
+#include "GladeConfig.h"
+#ifndef GLADE_VECTOR_H
+#include "Math\Vector.h"
+#endif
+#include "Math\AABB.h"
+#include "Math\Ray.h"
+#include <vector>
+
+namespace Glade {
+// Regular grid of heights, for terrain. Shared by HeightFieldColliders
+// Everything is in the heightfield's local space: samples are 'spacing' apart along x and z starting at the origin,
+// and y is up. Each cell between 4 samples is split into 2 triangles, numbered (cell * 2) and (cell * 2 + 1)
+//
+// Heights are quantized to 16 bits between the lowest and highest sample, so each sample takes 2 bytes.
+// A min/max pyramid sits over the cells: level 0 is the height range of each cell, and each level above covers
+// 2x2 of the level below. Cells under a box or along a ray are found directly from their x/z coordinates,
+// and the pyramid throws out whole blocks of cells the query is above or below
+class HeightField
+{
+public:
+	// 'heights' has numX * numZ samples, in rows along x
+	HeightField(const std::vector<gFloat>& heights, unsigned int numX, unsigned int numZ, gFloat spacing);
+
+	unsigned int GetNumTriangles() const { return (numX - 1) * (numZ - 1) * 2; }
+	const AABB& GetBounds() const { return bounds; }
+	gFloat GetSpacing() const { return spacing; }
+	gFloat GetHeight(unsigned int x, unsigned int z) const { return minHeight + samples[z * numX + x] * heightScale; }
+	void GetTriangle(unsigned int i, Vector& a, Vector& b, Vector& c) const;
+
+	// Call 'callback(i)' with the index of every triangle whose cell might overlap 'box'
+	template<class F> void Query(const AABB& box, F callback) const;
+
+	// Find the closest triangle hit by 'ray' within ray.len. 't' is set to the distance along ray.dir
+	bool RayCast(const Ray& ray, gFloat& t, unsigned int& triangle) const;
+
+private:
+	// Quantized height range of a block of cells
+	struct Range
+	{
+		unsigned short minimum;
+		unsigned short maximum;
+	};
+
+	// Visit the cells of block (x, z) of 'level' that overlap cells [x0, x1] by [z0, z1] and quantized heights [qMin, qMax]
+	template<class F> void QueryBlock(unsigned int level, unsigned int x, unsigned int z, unsigned int x0, unsigned int x1,
+									  unsigned int z0, unsigned int z1, unsigned short qMin, unsigned short qMax, F& callback) const;
+
+	// Quantize a local height, rounding down for minimums and up for maximums
+	unsigned short Quantize(gFloat h, bool roundUp) const;
+
+	unsigned int							numX, numZ;		// Samples along each axis
+	gFloat									spacing;
+	gFloat									minHeight;
+	gFloat									heightScale;	// Local height per quantized step
+	std::vector<unsigned short>				samples;
+	std::vector<std::vector<Range>>			pyramid;		// Level 0 has one Range per cell, the top level has one for everything
+	std::vector<unsigned int>				levelWidths;	// Blocks along x in each level
+	std::vector<unsigned int>				levelDepths;	// Blocks along z in each level
+	AABB									bounds;
+};
+
+template<class F> void HeightField::Query(const AABB& box, F callback) const
+{
+	// Nothing to hit outside the heightfield's bounds
+	if(box.maximum.x < bounds.minimum.x || box.minimum.x > bounds.maximum.x ||
+	   box.maximum.y < bounds.minimum.y || box.minimum.y > bounds.maximum.y ||
+	   box.maximum.z < bounds.minimum.z || box.minimum.z > bounds.maximum.z)
+		return;
+
+	// Cells under the box
+	gFloat last = gFloat(numX - 2);
+	gFloat f = Floor(box.minimum.x / spacing);	unsigned int x0 = (unsigned int)Clamp(f, gFloat(0.0f), last);
+	f = Floor(box.maximum.x / spacing);			unsigned int x1 = (unsigned int)Clamp(f, gFloat(0.0f), last);
+	last = gFloat(numZ - 2);
+	f = Floor(box.minimum.z / spacing);			unsigned int z0 = (unsigned int)Clamp(f, gFloat(0.0f), last);
+	f = Floor(box.maximum.z / spacing);			unsigned int z1 = (unsigned int)Clamp(f, gFloat(0.0f), last);
+
+	QueryBlock(pyramid.size() - 1, 0, 0, x0, x1, z0, z1, Quantize(box.minimum.y, false), Quantize(box.maximum.y, true), callback);
+}
+
+template<class F> void HeightField::QueryBlock(unsigned int level, unsigned int x, unsigned int z, unsigned int x0, unsigned int x1,
+											   unsigned int z0, unsigned int z1, unsigned short qMin, unsigned short qMax, F& callback) const
+{
+	const Range& r = pyramid[level][z * levelWidths[level] + x];
+	if(r.maximum < qMin || r.minimum > qMax)
+		return;
+
+	if(level == 0)
+	{
+		unsigned int cell = z * (numX - 1) + x;
+		callback(cell * 2);
+		callback(cell * 2 + 1);
+		return;
+	}
+
+	// Children cover cells [child << level-1, (child + 1) << level-1)
+	unsigned int shift = level - 1;
+	unsigned int cxEnd = Min((x + 1) * 2, levelWidths[level - 1]), czEnd = Min((z + 1) * 2, levelDepths[level - 1]);
+	for(unsigned int cz = z * 2; cz < czEnd; ++cz)
+	{
+		if((cz << shift) > z1 || (((cz + 1) << shift) - 1) < z0) continue;
+		for(unsigned int cx = x * 2; cx < cxEnd; ++cx)
+		{
+			if((cx << shift) > x1 || (((cx + 1) << shift) - 1) < x0) continue;
+			QueryBlock(level - 1, cx, cz, x0, x1, z0, z1, qMin, qMax, callback);
+		}
+	}
+}
+}	// namespace
+#endif	// GLADE_HEIGHT_FIELD_H
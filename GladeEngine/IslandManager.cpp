@@ -0,0 +1,166 @@
+#include "IslandManager.h"
+
+using namespace Glade;
+
+IslandManager::IslandManager() : numSleeping(0) { }
+
+void IslandManager::Update(std::vector<RigidBody*>& bodies, ContactStream& contacts)
+{
+	RigidBody* b1, *b2;
+
+	// Awake Islands are rebuilt from scratch every step
+	for(unsigned int i = 0; i < islands.size(); ++i)
+		if(islands[i].used && islands[i].awake)
+			FreeIsland(i);
+
+	// A RigidBody in a sleeping Island that was woken from outside (forces, user) wakes its whole Island
+	for(unsigned int i = 0; i < bodies.size(); ++i)
+	{
+		b1 = bodies[i];
+		if(b1->island >= 0 && b1->isAwake)
+		{
+			if(islands[b1->island].used && !islands[b1->island].awake)
+				WakeIsland(b1->island);
+			b1->island = -1;
+		}
+	}
+
+	// An awake RigidBody touching a sleeping one wakes the sleeping one's Island
+	for(unsigned int i = 0; i < contacts.GetSize(); ++i)
+	{
+		b1 = contacts[i].GetBody1();
+		b2 = contacts[i].GetBody2();
+		if(b2 == nullptr || b1->inverseMass == gFloat(0.0f) || b2->inverseMass == gFloat(0.0f))
+			continue;
+
+		if(b1->isAwake && !b2->isAwake)			WakeIsland(b2);
+		else if(b2->isAwake && !b1->isAwake)	WakeIsland(b1);
+	}
+
+	// Every awake RigidBody with finite mass is a node in the Contact graph
+	nodes.clear();
+	for(unsigned int i = 0; i < bodies.size(); ++i)
+	{
+		b1 = bodies[i];
+		if(b1->isAwake && b1->inverseMass != gFloat(0.0f))
+		{
+			b1->islandNode = nodes.size();
+			nodes.push_back(b1);
+		}
+		else
+			b1->islandNode = -1;
+	}
+
+	// Join nodes connected by a Contact
+	parent.resize(nodes.size());
+	for(unsigned int i = 0; i < nodes.size(); ++i)
+		parent[i] = i;
+	for(unsigned int i = 0; i < contacts.GetSize(); ++i)
+	{
+		b1 = contacts[i].GetBody1();
+		b2 = contacts[i].GetBody2();
+		if(b2 != nullptr && b1->islandNode >= 0 && b2->islandNode >= 0)
+			Union(b1->islandNode, b2->islandNode);
+	}
+
+	// Each set of joined nodes is an Island
+	std::vector<int> created;
+	rootIsland.assign(nodes.size(), -1);
+	int root, island;
+	for(unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		root = Find(i);
+		if(rootIsland[root] < 0)
+		{
+			rootIsland[root] = NewIsland();
+			created.push_back(rootIsland[root]);
+		}
+		island = rootIsland[root];
+		islands[island].bodies.push_back(nodes[i]);
+		nodes[i]->island = island;
+	}
+
+	// Put to sleep every Island whose RigidBodies are all ready to sleep
+	bool ready;
+	for(unsigned int i = 0; i < created.size(); ++i)
+	{
+		Island& is = islands[created[i]];
+		ready = true;
+		for(unsigned int j = 0; j < is.bodies.size() && ready; ++j)
+			ready = is.bodies[j]->IsReadyToSleep();
+		if(!ready) continue;
+
+		for(unsigned int j = 0; j < is.bodies.size(); ++j)
+			is.bodies[j]->SetAwake(false);
+		is.awake = false;
+		++numSleeping;
+	}
+}
+
+void IslandManager::WakeIsland(RigidBody* rb)
+{
+	if(rb->island >= 0 && islands[rb->island].used && !islands[rb->island].awake)
+		WakeIsland(rb->island);
+	else
+		rb->SetAwake(true);
+}
+
+void IslandManager::WakeIsland(int i)
+{
+	Island& is = islands[i];
+	for(unsigned int j = 0; j < is.bodies.size(); ++j)
+	{
+		is.bodies[j]->SetAwake(true);
+		is.bodies[j]->island = -1;
+	}
+	--numSleeping;
+	FreeIsland(i);
+}
+
+void IslandManager::FreeIsland(int i)
+{
+	islands[i].bodies.clear();
+	islands[i].used = false;
+	freeIslands.push_back(i);
+}
+
+int IslandManager::NewIsland()
+{
+	int i;
+	if(freeIslands.size() > 0)
+	{
+		i = freeIslands.back();
+		freeIslands.pop_back();
+	}
+	else
+	{
+		i = islands.size();
+		islands.push_back(Island());
+	}
+
+	islands[i].used = true;
+	islands[i].awake = true;
+	return i;
+}
+
+int IslandManager::Find(int n)
+{
+	// Path halving keeps the trees flat
+	while(parent[n] != n)
+	{
+		parent[n] = parent[parent[n]];
+		n = parent[n];
+	}
+	return n;
+}
+
+void IslandManager::Union(int n1, int n2)
+{
+	n1 = Find(n1);
+	n2 = Find(n2);
+	if(n1 != n2)
+		parent[n2] = n1;
+}
+
+unsigned int IslandManager::GetNumIslands() const { return islands.size() - freeIslands.size(); }
+unsigned int IslandManager::GetNumSleepingIslands() const { return numSleeping; }
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef GLADE_ISLAND_MANAGER_H
+#define GLADE_ISLAND_MANAGER_H
+
+#include "GladeConfig.h"
+#ifndef GLADE_RIGID_BODY_H
+#include "RigidBody.h"
+#endif
+#ifndef GLADE_CONTACT_STREAM_H
+#include "Contacts\ContactStream.h"
+#endif
+#include <vector>
+
+namespace Glade {
+// Keeps track of Islands - groups of RigidBodies connected to each other through Contacts
+// Infinite mass RigidBodies never connect an Island (everything on the ground would be one Island)
+//
+// Awake Islands are rebuilt every step from that step's Contacts. Sleeping Islands are kept as they are,
+// since a sleeping Island generates no Contacts of its own. When an awake RigidBody touches a RigidBody in
+// a sleeping Island (or a RigidBody in a sleeping Island is woken some other way) the whole Island is woken
+class IslandManager
+{
+public:
+	IslandManager();
+
+	// Wake every sleeping Island that touches something awake, rebuild the awake Islands from 'contacts'
+	// and put to sleep any Island whose RigidBodies are all ready to sleep
+	void Update(std::vector<RigidBody*>& bodies, ContactStream& contacts);
+
+	// Wake every RigidBody in the Island 'rb' belongs to
+	void WakeIsland(RigidBody* rb);
+
+	unsigned int GetNumIslands() const;
+	unsigned int GetNumSleepingIslands() const;
+
+private:
+	struct Island
+	{
+		std::vector<RigidBody*> bodies;
+		bool awake;
+		bool used;
+	};
+
+	void	WakeIsland(int i);
+	void	FreeIsland(int i);
+	int		NewIsland();
+	int		Find(int n);
+	void	Union(int n1, int n2);
+
+	std::vector<Island>			islands;
+	std::vector<int>			freeIslands;	// Indices of unused Islands
+	unsigned int				numSleeping;
+
+	// Scratch data for building Islands, kept to avoid reallocating every step
+	std::vector<RigidBody*>		nodes;			// Awake, finite mass RigidBodies this step
+	std::vector<int>			parent;			// Union-Find parent of each node
+	std::vector<int>			rootIsland;		// Island each root node became
+};
+}	// namespace
+#endif	// GLADE_ISLAND_MANAGER_H
@@ -11,6 +11,29 @@ struct Ray
 
 	Vector GetEndPoint() { return origin + dir*len; }
 
+	// Moller-Trumbore ray/triangle intersection. Either side of the triangle counts as a hit
+	// If hit within [0, len], set 't' to distance along 'dir' to the hit and return true
+	bool IntersectTriangle(const Vector& a, const Vector& b, const Vector& c, gFloat& t) const
+	{
+		Vector e1 = b - a, e2 = c - a;
+		Vector p = dir.CrossProduct(e2);
+		gFloat det = e1.DotProduct(p);
+		if(Abs(det) < EPSILON) return false;	// Ray parallel to triangle
+
+		gFloat inv = gFloat(1.0f) / det;
+		Vector s = origin - a;
+		gFloat u = s.DotProduct(p) * inv;
+		if(u < gFloat(0.0f) || u > gFloat(1.0f)) return false;
+		Vector q = s.CrossProduct(e1);
+		gFloat v = dir.DotProduct(q) * inv;
+		if(v < gFloat(0.0f) || u + v > gFloat(1.0f)) return false;
+
+		gFloat hit = e2.DotProduct(q) * inv;
+		if(hit < gFloat(0.0f) || hit > len) return false;
+		t = hit;
+		return true;
+	}
+
 	Vector origin;
 	Vector dir;
 	gFloat len;
@@ -0,0 +1,82 @@
+#ifndef GLADE_SIMD_H
+#define GLADE_SIMD_H
+
+#include "Precision.h"
+
+// SSE2 is always there on x64, and on x86 when compiling with /arch:SSE2 or higher
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define GLADE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Glade
+{
+#ifdef GLADE_SSE2
+// gLanes holds as many gFloats as fit in one 128-bit register (4 floats or 2 doubles)
+// Used to run the same calculation on several pairs at once, with each pair's values kept in their own arrays
+#ifdef SINGLE_PRECISION
+	typedef __m128 gLanes;
+
+	#define LANE_COUNT		4
+	#define LanesLoad		_mm_loadu_ps	// Load LANE_COUNT values from memory
+	#define LanesStore		_mm_storeu_ps	// Store LANE_COUNT values to memory
+	#define LanesSet		_mm_set1_ps		// Same value in every lane
+	#define LanesAdd		_mm_add_ps
+	#define LanesSub		_mm_sub_ps
+	#define LanesMul		_mm_mul_ps
+	#define LanesDiv		_mm_div_ps
+	#define LanesSqrt		_mm_sqrt_ps
+	#define LanesMax		_mm_max_ps
+	#define LanesAnd		_mm_and_ps
+	#define LanesOr			_mm_or_ps
+	#define LanesAndNot		_mm_andnot_ps	// (~a) & b
+	#define LanesGreater	_mm_cmpgt_ps	// All bits set in lanes where a > b
+#else
+	typedef __m128d gLanes;
+
+	#define LANE_COUNT		2
+	#define LanesLoad		_mm_loadu_pd	// Load LANE_COUNT values from memory
+	#define LanesStore		_mm_storeu_pd	// Store LANE_COUNT values to memory
+	#define LanesSet		_mm_set1_pd		// Same value in every lane
+	#define LanesAdd		_mm_add_pd
+	#define LanesSub		_mm_sub_pd
+	#define LanesMul		_mm_mul_pd
+	#define LanesDiv		_mm_div_pd
+	#define LanesSqrt		_mm_sqrt_pd
+	#define LanesMax		_mm_max_pd
+	#define LanesAnd		_mm_and_pd
+	#define LanesOr			_mm_or_pd
+	#define LanesAndNot		_mm_andnot_pd	// (~a) & b
+	#define LanesGreater	_mm_cmpgt_pd	// All bits set in lanes where a > b
+#endif
+
+	// Absolute value of each lane (clear the sign bit)
+	inline gLanes LanesAbs(gLanes x) { return LanesAndNot(LanesSet(gFloat(-0.0f)), x); }
+
+	// Take 'a' in lanes where 'mask' is set and 'b' everywhere else
+	inline gLanes LanesSelect(gLanes mask, gLanes a, gLanes b) { return LanesOr(LanesAnd(mask, a), LanesAndNot(mask, b)); }
+
+// fLanes always holds 4 floats, whatever gFloat is
+// Used where values are small enough for float, like positions relative to a nearby origin, to fit twice as many lanes as doubles
+	typedef __m128 fLanes;
+
+	#define F_LANE_COUNT	4
+	#define FLanesLoad		_mm_loadu_ps
+	#define FLanesStore		_mm_storeu_ps
+	#define FLanesSet		_mm_set1_ps
+	#define FLanesAdd		_mm_add_ps
+	#define FLanesSub		_mm_sub_ps
+	#define FLanesMul		_mm_mul_ps
+	#define FLanesDiv		_mm_div_ps
+	#define FLanesSqrt		_mm_sqrt_ps
+	#define FLanesMax		_mm_max_ps
+	#define FLanesAnd		_mm_and_ps
+	#define FLanesOr		_mm_or_ps
+	#define FLanesAndNot	_mm_andnot_ps
+	#define FLanesGreater	_mm_cmpgt_ps
+
+	inline fLanes FLanesAbs(fLanes x) { return FLanesAndNot(FLanesSet(-0.0f), x); }
+	inline fLanes FLanesSelect(fLanes mask, fLanes a, fLanes b) { return FLanesOr(FLanesAnd(mask, a), FLanesAndNot(mask, b)); }
+#endif
+}	// namespace
+#endif	// GLADE_SIMD_H
@@ -138,5 +138,5 @@ gFloat Object::GetRadiusSquared() const { return radius * radius; }
 
 void Object::SetHightlightColor(D3DXVECTOR4 c) { highlightColor = c; }
 
-std::set<int> Object::GetHashIndices() { return hashIndices; }
+const std::set<int>& Object::GetHashIndices() const { return hashIndices; }
 void Object::SetHashIndices(std::set<int> indices) { hashIndices = indices; }
\ No newline at end of file
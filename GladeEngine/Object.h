@@ -117,7 +117,7 @@ public:
 
 	void SetHightlightColor(D3DXVECTOR4 c = D3DXVECTOR4(1,1,1,1));
 
-	std::set<int> GetHashIndices();
+	const std::set<int>& GetHashIndices() const;
 	void SetHashIndices(std::set<int> indices);
 
 protected:
@@ -4,6 +4,16 @@ using namespace Glade;
 
 RigidBody::RigidBody()
 {
+#ifdef SLEEP_ISLANDS
+	readyToSleep = false;
+	island = -1;
+#endif
+#ifdef CONTINUOUS_COLLISION
+	continuousCollision = false;
+#endif
+	collisionTypes = collisionMasks = 0;
+	solverBatch = solverIndex = 0;
+	hashedCollisionTypes = hashedCollisionMasks = 0;
 }
 
 RigidBody::RigidBody(Vector pos, Quaternion orient, Vector vel, Vector accel, Vector angVel, Vector angAccel, gFloat lDamp, gFloat aDamp, bool ug, Vector grav) : 
@@ -12,6 +22,16 @@ RigidBody::RigidBody(Vector pos, Quaternion orient, Vector vel, Vector accel, Ve
 			, motion(30.0f), motionBias(Pow(0.5, PHYSICS_TIMESTEP))
 #endif
 {
+#ifdef SLEEP_ISLANDS
+	readyToSleep = false;
+	island = -1;
+#endif
+#ifdef CONTINUOUS_COLLISION
+	continuousCollision = false;
+#endif
+	collisionTypes = collisionMasks = 0;
+	solverBatch = solverIndex = 0;
+	hashedCollisionTypes = hashedCollisionMasks = 0;
 	CalcDerivedData();
 
 #ifdef SLEEP_TEST_BOX
@@ -23,8 +43,18 @@ RigidBody::~RigidBody()
 {
 }
 
-bool RigidBody::Update()
+bool RigidBody::Update(bool moveColliders)
 {
+#ifdef CONTINUOUS_COLLISION
+	// Start of this step's sweep. If the RigidBody doesn't move, the sweep is just where it is
+	if(continuousCollision)
+	{
+		sweepCentroid = centroid;
+		sweepOrientation = orientation;
+		sweptBoundingBox = boundingBox;
+	}
+#endif
+
 	// Don't integrate things with infinite masses (they can't move)
 	if(inverseMass == 0 || !isAwake) return false;
 
@@ -56,7 +86,14 @@ bool RigidBody::Update()
 	angularVelocity *= Pow(angularDamping, PHYSICS_TIMESTEP);
 
 	// Normalize orientation and update transformation matrix and world inertia tensor
-	CalcDerivedData();
+	// If the Colliders are left where they are, the AABB waits for FinishUpdate
+	CalcDerivedData(moveColliders);
+
+#ifdef CONTINUOUS_COLLISION
+	if(continuousCollision && moveColliders)
+		sweptBoundingBox = AABB(Vector::VectorMin(sweptBoundingBox.minimum, boundingBox.minimum),
+								Vector::VectorMax(sweptBoundingBox.maximum, boundingBox.maximum));
+#endif
 
 	// Clear forces/torques for next frame
 	force.Zero();
@@ -75,10 +112,16 @@ bool RigidBody::Update()
 	{
 #ifdef SLEEP_TEST_ENERGY
 		motion = (motionBias * motion) + ((1 - motionBias) * velocity.DotProduct(velocity) * angularVelocity.DotProduct(angularVelocity));
+#ifdef SLEEP_ISLANDS
+		readyToSleep = motion < sleepEpsilon;	// Its Island decides when it actually sleeps
+		if(motion > 10 * sleepEpsilon)
+			motion = 10 * sleepEpsilon;
+#else
 		if(motion < sleepEpsilon)
 			SetAwake(false);
 		else if(motion > 10 * sleepEpsilon)
 			motion = 10 * sleepEpsilon;
+#endif
 #elif defined SLEEP_TEST_BOX
 		// Update sleep boxes after frame of motion
 		Vector sleepBoxPosistions[3] = {position, position + Vector(transformationMatrix(0,0), transformationMatrix(0,1), transformationMatrix(0,2)),
@@ -103,16 +146,31 @@ bool RigidBody::Update()
 			InitializeSleepBoxes();
 		// If its been a sufficient time since the sleep test failed, the object has sufficiently ceased moving - Put it to sleep
 		else if(++sleepSteps >= sleepStepThreshold)
+#ifdef SLEEP_ISLANDS
+			readyToSleep = true;	// Its Island decides when it actually sleeps
+#else
 			SetAwake(false);
+#endif
 #endif
 	}
 
 	return true;
 }
 
+void RigidBody::FinishUpdate()
+{
+	MergeColliderBounds();
+
+#ifdef CONTINUOUS_COLLISION
+	if(continuousCollision)
+		sweptBoundingBox = AABB(Vector::VectorMin(sweptBoundingBox.minimum, boundingBox.minimum),
+								Vector::VectorMax(sweptBoundingBox.maximum, boundingBox.maximum));
+#endif
+}
+
 void RigidBody::Render() { GraphicsLocator::GetGraphics()->Render(shaderResource, 0); }
 
-void RigidBody::CalcDerivedData()
+void RigidBody::CalcDerivedData(bool moveColliders)
 {
 	// Safety - Make sure orientation quaternion is normalized
 	orientation.NormalizeInPlace();
@@ -145,29 +203,32 @@ TODO: 4/29/2017
 	Matrix test4 = transformationMatrix.Transpose3Times((inverseInertiaTensor).Times3(transformationMatrix));
 */
 	// RigidBody is moving was moved by a collision, which means its BoundingBox needs to be updated
-	CalcBoundingBox();
+	if(moveColliders)
+		CalcBoundingBox();
 	solved = false;
 }
 
 void RigidBody::CalcBoundingBox()
+{
+	for(unsigned int i = 0; i < colliders.size(); ++i)
+		colliders[i]->CalcTransformAndDerivedGeometricData(transformationMatrix);
+	MergeColliderBounds();
+}
+
+void RigidBody::MergeColliderBounds()
 {
 	// Calculate Bounding Box from colliders
 	if(colliders.size() > 0)
 	{
-		colliders[0]->CalcTransformAndDerivedGeometricData(transformationMatrix);
 		boundingBox = colliders[0]->GetBounds();
 		AABB colliderBounds;
 		for(unsigned int i = 1; i < colliders.size(); ++i)
 		{
-			colliders[i]->CalcTransformAndDerivedGeometricData(transformationMatrix);
 			colliderBounds = colliders[i]->GetBounds();
-			if(colliderBounds.maximum.x > boundingBox.maximum.x)	boundingBox.maximum.x = colliderBounds.maximum.x;
-			if(colliderBounds.maximum.y > boundingBox.maximum.y)	boundingBox.maximum.x = colliderBounds.maximum.y;
-			if(colliderBounds.maximum.z > boundingBox.maximum.z)	boundingBox.maximum.x = colliderBounds.maximum.z;
-			if(colliderBounds.minimum.x < boundingBox.minimum.x)	boundingBox.minimum.x = colliderBounds.minimum.x;
-			if(colliderBounds.minimum.y < boundingBox.minimum.y)	boundingBox.minimum.x = colliderBounds.minimum.y;
-			if(colliderBounds.minimum.z < boundingBox.minimum.z)	boundingBox.minimum.x = colliderBounds.minimum.z;
+			boundingBox.minimum = Vector::VectorMin(boundingBox.minimum, colliderBounds.minimum);
+			boundingBox.maximum = Vector::VectorMax(boundingBox.maximum, colliderBounds.maximum);
 		}
+		boundingBox.CalcCenter();
 	}
 	else
 	{
@@ -198,6 +259,9 @@ void RigidBody::CalcBoundingBox()
 void RigidBody::InitializeSleepBoxes()
 {
 	sleepSteps = 0;
+#ifdef SLEEP_ISLANDS
+	readyToSleep = false;
+#endif
 	sleepBoxes[0].minimum = sleepBoxes[0].maximum = position;
 	sleepBoxes[1].minimum = sleepBoxes[1].maximum = position + Vector(transformationMatrix(0,0), transformationMatrix(0,1), transformationMatrix(0,2));
 	sleepBoxes[2].minimum = sleepBoxes[2].maximum = position + Vector(transformationMatrix(1,0), transformationMatrix(1,1), transformationMatrix(1,2));
@@ -218,6 +282,8 @@ void RigidBody::AddCollider(Collider* collider)
 		localCentroid = collider->GetPosition();
 		inverseMass = gFloat(0.0f);
 		inverseInertiaTensor = Matrix::INFINITE_MASS_INERTIA_TENSOR;
+		BuildColliderTree();
+		UpdateCollisionLayers();
 		CalcDerivedData();
 		SetAwake(false);	// Infinite Mass can't move by definition, so set to asleep for now
 		return;
@@ -271,10 +337,36 @@ void RigidBody::AddCollider(Collider* collider)
 	// Calculate Inverse Inertia Tensor
 	inverseInertiaTensor = inertia.Inverse3();
 
+	BuildColliderTree();
+	UpdateCollisionLayers();
 	CalcDerivedData();
 	SetAwake(true);
 }
 
+void RigidBody::BuildColliderTree()
+{
+	// Place each Collider with an identity transform to get its bounds in local space
+	// CalcDerivedData afterwards puts them back in world space
+	std::vector<AABB> bounds(colliders.size());
+	Matrix identity;
+	for(unsigned int i = 0; i < colliders.size(); ++i)
+	{
+		colliders[i]->CalcTransformAndDerivedGeometricData(identity);
+		bounds[i] = colliders[i]->GetBounds();
+	}
+	colliderTree.Build(bounds);
+}
+
+void RigidBody::UpdateCollisionLayers()
+{
+	collisionTypes = collisionMasks = 0;
+	for(unsigned int i = 0; i < colliders.size(); ++i)
+	{
+		collisionTypes |= colliders[i]->GetCollisionType();
+		collisionMasks |= colliders[i]->GetCollisionMask();
+	}
+}
+
 void RigidBody::LoadMesh(SmartPointer<MeshData> meshData)
 {
 	shaderResource = GraphicsLocator::GetGraphics()->CreateBuffers(meshData);
@@ -329,7 +421,12 @@ void RigidBody::SetAwake(bool awake/*=true*/)
 	}
 }
 
+#ifdef SLEEP_ISLANDS
+bool RigidBody::IsReadyToSleep() const { return readyToSleep && canSleep; }
+#endif
+
 unsigned int RigidBody::GetColliders(std::vector<Collider*>& c) { c = colliders; return colliders.size(); }
+const std::vector<Collider*>& RigidBody::GetColliders() const { return colliders; }
 
 Vector RigidBody::GetVelocity() const { return velocity; }
 void RigidBody::SetVelocity(const Vector& v)
@@ -376,6 +473,60 @@ Quaternion RigidBody::GetOrientation() const { return orientation; }
 Matrix RigidBody::GetInverseInertiaTensorWorld() const { return inverseInertiaTensorWorld; }
 void RigidBody::GetInverseInertiaTensorWorld(Matrix* m) const { *m = inverseInertiaTensorWorld; }
 
+#ifdef CONTINUOUS_COLLISION
+void RigidBody::SetContinuousCollision(bool ccd)
+{
+	continuousCollision = ccd;
+
+	// Nothing swept yet, start from where it is now
+	sweepCentroid = centroid;
+	sweepOrientation = orientation;
+	sweptBoundingBox = boundingBox;
+}
+
+Matrix RigidBody::GetSweptTransform(gFloat t) const
+{
+	if(!continuousCollision) return transformationMatrix;
+
+	// Normalized linear interpolation of orientation, taking the short way around
+	Vector c = sweepCentroid + (centroid - sweepCentroid) * t;
+	gFloat sign = sweepOrientation.DotProduct(orientation) < gFloat(0.0f) ? gFloat(-1.0f) : gFloat(1.0f);
+	Quaternion q = (sweepOrientation * (gFloat(1.0f) - t) + orientation * (t * sign)).Normalized();
+
+	Matrix m;
+	m.ComposeTransformationMatrix(&c, &q, nullptr);
+	return m;
+}
+
+Vector RigidBody::GetSweptMotion() const
+{
+	return continuousCollision ? centroid - sweepCentroid : Vector();
+}
+
+gFloat RigidBody::GetSweptRotation() const
+{
+	if(!continuousCollision) return gFloat(0.0f);
+
+	gFloat dot = Abs(sweepOrientation.DotProduct(orientation));
+	gFloat angle = gFloat(2.0f) * ACos(Min(dot, gFloat(1.0f)));
+
+	// Interpolated orientation turns fastest half way through the step. Returns that rate, in radians per step,
+	// so it bounds how far any point can turn in part of the step
+	return gFloat(4.0f) * Tan(angle * gFloat(0.25f));
+}
+
+void RigidBody::RewindSweep(gFloat t)
+{
+	if(!continuousCollision) return;
+
+	// Same interpolation as GetSweptTransform. CalcDerivedData normalizes the orientation
+	gFloat sign = sweepOrientation.DotProduct(orientation) < gFloat(0.0f) ? gFloat(-1.0f) : gFloat(1.0f);
+	orientation = sweepOrientation * (gFloat(1.0f) - t) + orientation * (t * sign);
+	centroid = sweepCentroid + (centroid - sweepCentroid) * t;
+	CalcDerivedData();
+}
+#endif
+
 Vector RigidBody::GetLastFrameAcceleration() const { return lastAcceleration; }
 void RigidBody::ForceSetPosition(const Vector& p) { position = p; UpdateCentroidFromPosition(); }
 void RigidBody::ForceSetCentroid(const Vector& c) { centroid = c; UpdatePositionFromCentroid(); }
@@ -6,6 +6,7 @@
 #include "Object.h"
 #endif
 #include "Sleep.h"
+#include "ColliderTree.h"
 #include "Math\MathMisc.h"
 #include <vector>
 
@@ -22,10 +23,12 @@ public:
 	RigidBody(Vector pos, Quaternion orient, Vector vel, Vector accel, Vector angVel, Vector angAccel, gFloat lDamp, gFloat aDamp, bool ug, Vector grav=Vector());
 	virtual ~RigidBody();
 
-	bool Update();				// Perform physics integration and update dynamic state properties
+	bool Update(bool moveColliders=true);			// Perform physics integration and update dynamic state properties
+	void FinishUpdate();							// After Update(false), once the Colliders have been moved (ColliderUpdateBatch)
 	void Render();
-	void CalcDerivedData();		// Calculate internal data from current state.
-	void CalcBoundingBox();		// Calculate and save the AABB that wholly contains this Rigid Body
+	void CalcDerivedData(bool moveColliders=true);	// Calculate internal data from current state.
+	void CalcBoundingBox();							// Calculate and save the AABB that wholly contains this Rigid Body
+	void MergeColliderBounds();						// Same as above, from where the Colliders already are
 #ifdef SLEEP_TEST_BOX
 	void InitializeSleepBoxes();	// Initialize the sleep boxes to have dimensions of 0 and reset sleepSteps
 #endif
@@ -40,11 +43,23 @@ public:
 	void ApplyForceAtLocalPoint(const Vector& f, const Vector& p);	// at another point in local space 
 
 	void SetAwake(bool awake=true);
+#ifdef SLEEP_ISLANDS
+	bool IsReadyToSleep() const;	// Passed its own sleep test, waiting on the rest of its Island
+#endif
 
 	void TurnOnGravity(Vector grav=Vector::GRAVITY);
 	void TurnOffGravity();
 
 	unsigned int GetColliders(std::vector<Collider*>& c);
+	const std::vector<Collider*>& GetColliders() const;
+	const ColliderTree& GetColliderTree() const { return colliderTree; }	// Over GetColliders(), in local space
+
+	// Collision Types and Masks of all its Colliders combined, so BroadPhase can skip RigidBodies none of whose Colliders
+	// could collide without looking at each Collider. Call UpdateCollisionLayers after changing a Collider's Type or Mask
+	// (World::UpdateCollisionLayers once the RigidBody is in a World, so its spatial hash cells are updated as well)
+	int		GetCollisionTypes() const { return collisionTypes; }
+	int		GetCollisionMasks() const { return collisionMasks; }
+	void	UpdateCollisionLayers();
 
 	Vector	GetVelocity() const;
 	void	SetVelocity(const Vector& v);
@@ -60,10 +75,29 @@ public:
 	Matrix	GetInverseInertiaTensorWorld() const;
 	void	GetInverseInertiaTensorWorld(Matrix* m) const;
 
+#ifdef CONTINUOUS_COLLISION
+	// Continuous Collision Detection. Meant for small, fast RigidBodies (projectiles) that could otherwise pass
+	// through thin RigidBodies in one step. Without it, a RigidBody is only tested where it ends each step
+	void	SetContinuousCollision(bool ccd);
+	bool	GetContinuousCollision() const { return continuousCollision; }
+
+	// Sweep over the last step. Without CCD the RigidBody is treated as if it had been where it is for the whole step
+	const AABB&	GetSweptBoundingBox() const { return continuousCollision ? sweptBoundingBox : boundingBox; }
+	Matrix	GetSweptTransform(gFloat t) const;	// Transform 't' of the way (0 to 1) through the step
+	Vector	GetSweptMotion() const;				// How far the centroid moved
+	gFloat	GetSweptRotation() const;			// Angle turned through, in radians
+	void	RewindSweep(gFloat t);				// Move back to 't' of the way through the step
+#endif
+
 private:
 	friend class Contact;
 	friend class ContactResolver;
+	friend class ContactConstraints;
+	friend class IslandManager;
+	friend class ContactBatch;
+	friend class World;
 	Vector	GetLastFrameAcceleration() const;
+	void	BuildColliderTree();	// Rebuild colliderTree after Colliders are added
 	void	ForceSetPosition(const Vector& p);
 	void	ForceSetCentroid(const Vector& c);
 	void	ForceSetOrientation(const Quaternion& o);
@@ -89,6 +123,9 @@ protected:
 	Matrix	inverseInertiaTensorWorld;
 
 	std::vector<Collider*>	colliders;
+	ColliderTree			colliderTree;
+	int						collisionTypes;		// Every Collider's Collision Type combined
+	int						collisionMasks;		// Every Collider's Collision Mask combined
 
 	// Dynamic State Properties
 	Vector	velocity;
@@ -103,6 +140,13 @@ protected:
 
 	bool solved;
 
+#ifdef CONTINUOUS_COLLISION
+	bool		continuousCollision;
+	Vector		sweepCentroid;		// Centroid and orientation at the start of the step
+	Quaternion	sweepOrientation;
+	AABB		sweptBoundingBox;	// Contains the RigidBody at both the start and end of the step
+#endif
+
 private:
 #ifdef SLEEP_TEST_ENERGY
 	gFloat	motion;				// The amount of motion of the Object.
@@ -116,6 +160,15 @@ private:
 							// the RigidBody is put to sleep.
 							// The 1st box represents the linear motion of the RigidBody, the 2nd and 3rd represent the angular motion
 #endif
+	unsigned int solverBatch;	// Serial of the ContactBatch this RigidBody was last added to (0 if none)
+	unsigned int solverIndex;	// Index of this RigidBody in that ContactBatch's bodies, for per-body solver data
+	int hashedCollisionTypes;	// Collision Types and Masks counted in its spatial hash cells, so they are uncounted
+	int hashedCollisionMasks;	//  the same way even if its Colliders changed since (see World::AddToHash)
+#ifdef SLEEP_ISLANDS
+	bool readyToSleep;	// Passed the sleep test. Only goes to sleep once its whole Island is ready
+	int island;			// Index of the Island this RigidBody belongs to (-1 if none)
+	int islandNode;		// Index of this RigidBody while Islands are being built
+#endif
 
 	inline void UpdateCentroidFromPosition() { centroid = transformationMatrix.Times3(localCentroid) + position; }
 	inline void UpdatePositionFromCentroid() { position = transformationMatrix.Times3(-localCentroid) + centroid; }
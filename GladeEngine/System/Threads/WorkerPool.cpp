@@ -0,0 +1,86 @@
+#include "WorkerPool.h"
+using namespace Glade;
+
+WorkerPool::WorkerPool(unsigned int numThreads_) : job(nullptr), nextIndex(0), jobCount(0), busyWorkers(0), generation(0), quit(false)
+{
+	if(numThreads_ == 0)
+		numThreads_ = std::thread::hardware_concurrency();
+	if(numThreads_ == 0)	// hardware_concurrency is allowed to not know
+		numThreads_ = 1;
+
+	for(unsigned int i = 1; i < numThreads_; ++i)
+		workers.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for(unsigned int i = 0; i < workers.size(); ++i)
+		workers[i].join();
+}
+
+unsigned int WorkerPool::GetNumThreads() const { return workers.size() + 1; }
+
+void WorkerPool::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& job_)
+{
+	if(count == 0) return;
+
+	// Not worth waking anybody up
+	if(count == 1 || workers.empty())
+	{
+		for(unsigned int i = 0; i < count; ++i)
+			job_(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &job_;
+		jobCount = count;
+		nextIndex = 0;
+		busyWorkers = workers.size();
+		++generation;
+	}
+	wake.notify_all();
+
+	// Calling thread works too
+	RunJobs();
+
+	// Wait for every worker to leave this set of jobs before 'job_' goes out of scope
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this] { return busyWorkers == 0; });
+	job = nullptr;
+}
+
+void WorkerPool::WorkerLoop()
+{
+	unsigned int lastGeneration = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quit || generation != lastGeneration; });
+			if(quit) return;
+			lastGeneration = generation;
+		}
+
+		RunJobs();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(--busyWorkers == 0)
+				finished.notify_one();
+		}
+	}
+}
+
+void WorkerPool::RunJobs()
+{
+	unsigned int i;
+	while((i = nextIndex++) < jobCount)
+		(*job)(i);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef GLADE_WORKER_POOL_H
+#define GLADE_WORKER_POOL_H
+#include "../../Utils/Assert.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace Glade {
+/*
+	Fixed set of worker threads that run jobs handed out by index
+	The calling thread also takes part in the work, so a pool of N threads starts N-1 workers
+	Jobs must not touch shared state other than what they were given by their index
+*/
+class WorkerPool
+{
+public:
+	// 0 threads uses one per hardware thread
+	WorkerPool(unsigned int numThreads_=0);
+	~WorkerPool();
+
+	// Number of threads that run jobs, including the calling thread
+	unsigned int GetNumThreads() const;
+
+	// Run job(i) for every i in [0, count) and return once all of them have finished
+	// Indices are handed out in order, but may finish in any order
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& job);
+
+private:
+	void WorkerLoop();
+	void RunJobs();
+
+	std::vector<std::thread>	workers;
+	std::mutex					mutex;
+	std::condition_variable		wake;			// Signalled when a new set of jobs is ready (or pool shuts down)
+	std::condition_variable		finished;		// Signalled when the last worker leaves a set of jobs
+
+	const std::function<void(unsigned int)>* job;
+	std::atomic<unsigned int>	nextIndex;		// Next job index to hand out
+	unsigned int				jobCount;		// Number of jobs in current set
+	unsigned int				busyWorkers;	// Workers still inside current set
+	unsigned int				generation;		// Incremented for every set of jobs so workers don't run one twice
+	bool						quit;
+};
+}	// namespace Glade
+#endif	// GLADE_WORKER_POOL_H
@@ -0,0 +1,227 @@
+#include "TriangleMesh.h"
+#include "Math\MathMisc.h"
+#include "System\GeometryGenerator.h"
+#include <algorithm>
+
+using namespace Glade;
+
+TriangleMesh::TriangleMesh(const std::vector<Vector>& verts, const std::vector<unsigned int>& inds) : vertices(verts), indices(inds)
+{
+	Build();
+}
+
+TriangleMesh::TriangleMesh(SmartPointer<MeshData> mesh)
+{
+	vertices.reserve(mesh->vertices.size());
+	for(unsigned int i = 0; i < mesh->vertices.size(); ++i)
+		vertices.push_back(Vector(mesh->vertices[i].position.x, mesh->vertices[i].position.y, mesh->vertices[i].position.z));
+	indices = mesh->indices;
+	Build();
+}
+
+void TriangleMesh::Build()
+{
+	// Drop any partial triangle at the end
+	indices.resize(indices.size() - indices.size() % 3);
+	unsigned int numTris = GetNumTriangles();
+	nodes.clear();
+	if(numTris == 0)
+	{
+		bounds = AABB(Vector(), Vector());
+		return;
+	}
+
+	// Bounds and centroid of each triangle
+	std::vector<AABB> triBounds(numTris);
+	std::vector<Vector> centroids(numTris);
+	std::vector<unsigned int> order(numTris);
+	Vector a, b, c, minimum(G_MAX, G_MAX, G_MAX), maximum(-G_MAX, -G_MAX, -G_MAX);
+	for(unsigned int i = 0; i < numTris; ++i)
+	{
+		GetTriangle(i, a, b, c);
+		triBounds[i] = AABB(Vector::VectorMin(a, Vector::VectorMin(b, c)), Vector::VectorMax(a, Vector::VectorMax(b, c)));
+		centroids[i] = (a + b + c) / gFloat(3.0f);
+		order[i] = i;
+		minimum = Vector::VectorMin(minimum, triBounds[i].minimum);
+		maximum = Vector::VectorMax(maximum, triBounds[i].maximum);
+	}
+	bounds = AABB(minimum, maximum);
+
+	// Flat meshes have no extent along some axis, avoid dividing by 0
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		gFloat extent = bounds.maximum[i] - bounds.minimum[i];
+		quantization[i] = extent > EPSILON ? gFloat(65535.0f) / extent : gFloat(1.0f);
+	}
+
+	nodes.reserve(numTris * 2 - 1);
+	BuildNode(0, numTris, order, triBounds, centroids);
+}
+
+void TriangleMesh::BuildNode(unsigned int start, unsigned int end, std::vector<unsigned int>& order,
+							 const std::vector<AABB>& triBounds, const std::vector<Vector>& centroids)
+{
+	unsigned int index = nodes.size();
+	nodes.push_back(Node());
+
+	// Bounds of all triangles in this node, and of their centroids
+	Vector minimum(G_MAX, G_MAX, G_MAX), maximum(-G_MAX, -G_MAX, -G_MAX);
+	Vector cMin = minimum, cMax = maximum;
+	for(unsigned int i = start; i < end; ++i)
+	{
+		minimum = Vector::VectorMin(minimum, triBounds[order[i]].minimum);
+		maximum = Vector::VectorMax(maximum, triBounds[order[i]].maximum);
+		cMin = Vector::VectorMin(cMin, centroids[order[i]]);
+		cMax = Vector::VectorMax(cMax, centroids[order[i]]);
+	}
+	Quantize(minimum, nodes[index].minimum, false);
+	Quantize(maximum, nodes[index].maximum, true);
+
+	// One triangle per leaf
+	if(end - start == 1)
+	{
+		nodes[index].data = -(int)order[start] - 1;
+		return;
+	}
+
+	// Split along the axis the centroids are most spread out on
+	unsigned int axis = 0;
+	Vector cExtent = cMax - cMin;
+	if(cExtent.y > cExtent[axis]) axis = 1;
+	if(cExtent.z > cExtent[axis]) axis = 2;
+
+	unsigned int mid = start;
+	if(cExtent[axis] > EPSILON)
+	{
+		// Sort triangles into bins by centroid
+		unsigned int counts[TRIANGLE_MESH_SAH_BINS] = { 0 };
+		Vector binMin[TRIANGLE_MESH_SAH_BINS], binMax[TRIANGLE_MESH_SAH_BINS];
+		for(unsigned int i = 0; i < TRIANGLE_MESH_SAH_BINS; ++i)
+		{
+			binMin[i] = Vector(G_MAX, G_MAX, G_MAX);
+			binMax[i] = Vector(-G_MAX, -G_MAX, -G_MAX);
+		}
+		gFloat binScale = gFloat(TRIANGLE_MESH_SAH_BINS) * (gFloat(1.0f) - EPSILON) / cExtent[axis];
+		auto binOf = [&](unsigned int tri) { return (unsigned int)((centroids[tri][axis] - cMin[axis]) * binScale); };
+		for(unsigned int i = start; i < end; ++i)
+		{
+			unsigned int bin = binOf(order[i]);
+			++counts[bin];
+			binMin[bin] = Vector::VectorMin(binMin[bin], triBounds[order[i]].minimum);
+			binMax[bin] = Vector::VectorMax(binMax[bin], triBounds[order[i]].maximum);
+		}
+
+		// Cost of splitting after each bin is (surface area * triangle count) of each side
+		// Sweep from the right to get each right side, then from the left to find the cheapest split
+		auto area = [](const Vector& mn, const Vector& mx) { Vector d = mx - mn; return d.x * d.y + d.y * d.z + d.z * d.x; };
+		gFloat rightCost[TRIANGLE_MESH_SAH_BINS];
+		Vector sideMin(G_MAX, G_MAX, G_MAX), sideMax(-G_MAX, -G_MAX, -G_MAX);
+		unsigned int count = 0;
+		for(unsigned int i = TRIANGLE_MESH_SAH_BINS - 1; i > 0; --i)
+		{
+			sideMin = Vector::VectorMin(sideMin, binMin[i]);
+			sideMax = Vector::VectorMax(sideMax, binMax[i]);
+			count += counts[i];
+			rightCost[i] = count > 0 ? area(sideMin, sideMax) * count : gFloat(0.0f);
+		}
+
+		gFloat cost, bestCost = G_MAX;
+		unsigned int bestBin = 0;
+		sideMin = Vector(G_MAX, G_MAX, G_MAX);
+		sideMax = Vector(-G_MAX, -G_MAX, -G_MAX);
+		count = 0;
+		for(unsigned int i = 0; i < TRIANGLE_MESH_SAH_BINS - 1; ++i)
+		{
+			sideMin = Vector::VectorMin(sideMin, binMin[i]);
+			sideMax = Vector::VectorMax(sideMax, binMax[i]);
+			count += counts[i];
+			if(count == 0 || count == end - start) continue;
+			cost = area(sideMin, sideMax) * count + rightCost[i + 1];
+			if(cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+
+		if(bestCost < G_MAX)
+			mid = std::partition(order.begin() + start, order.begin() + end, [&](unsigned int tri) { return binOf(tri) <= bestBin; }) - order.begin();
+	}
+
+	// Centroids all in the same place (or in the same bin), split in half by count
+	if(mid == start || mid == end)
+	{
+		mid = (start + end) / 2;
+		std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end,
+			[&](unsigned int t1, unsigned int t2) { return centroids[t1][axis] < centroids[t2][axis]; });
+	}
+
+	BuildNode(start, mid, order, triBounds, centroids);
+	BuildNode(mid, end, order, triBounds, centroids);
+	nodes[index].data = nodes.size() - index;
+}
+
+void TriangleMesh::Quantize(const Vector& v, unsigned short (&q)[3], bool roundUp) const
+{
+	gFloat f;
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		f = (v[i] - bounds.minimum[i]) * quantization[i];
+		f = roundUp ? Ceiling(f) : Floor(f);
+		q[i] = (unsigned short)Clamp(f, gFloat(0.0f), gFloat(65535.0f));
+	}
+}
+
+bool TriangleMesh::RayCast(const Ray& ray, gFloat& t, unsigned int& triangle) const
+{
+	gFloat best = ray.len, tNear, tFar, t1, t2, inv, tHit;
+	Vector nodeMin, nodeMax, a, b, c;
+	bool hit = false;
+
+	unsigned int i = 0, numNodes = nodes.size();
+	while(i < numNodes)
+	{
+		const Node& n = nodes[i];
+
+		// Slab test against the node's bounds, only as far as the closest hit so far
+		tNear = gFloat(0.0f);
+		tFar = best;
+		for(unsigned int j = 0; j < 3 && tNear <= tFar; ++j)
+		{
+			nodeMin[j] = bounds.minimum[j] + n.minimum[j] / quantization[j];
+			nodeMax[j] = bounds.minimum[j] + n.maximum[j] / quantization[j];
+			if(Abs(ray.dir[j]) < EPSILON)
+			{
+				if(ray.origin[j] < nodeMin[j] || ray.origin[j] > nodeMax[j])
+					tNear = G_MAX;
+				continue;
+			}
+			inv = gFloat(1.0f) / ray.dir[j];
+			t1 = (nodeMin[j] - ray.origin[j]) * inv;
+			t2 = (nodeMax[j] - ray.origin[j]) * inv;
+			if(t1 > t2) Swap<gFloat>(t1, t2);
+			tNear = Max(tNear, t1);
+			tFar = Min(tFar, t2);
+		}
+		bool overlap = tNear <= tFar;
+
+		if(n.data >= 0)
+		{
+			i += overlap ? 1 : n.data;
+			continue;
+		}
+		++i;
+		if(!overlap) continue;
+
+		GetTriangle(-n.data - 1, a, b, c);
+		if(ray.IntersectTriangle(a, b, c, tHit) && tHit < best)
+		{
+			best = tHit;
+			triangle = -n.data - 1;
+			hit = true;
+		}
+	}
+
+	if(hit) t = best;
+	return hit;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#ifndef GLADE_TRIANGLE_MESH_H
+#define GLADE_TRIANGLE_MESH_H
+
+#include "GladeConfig.h"
+#ifndef GLADE_VECTOR_H
+#include "Math\Vector.h"
+#endif
+#include "Math\AABB.h"
+#include "Math\Ray.h"
+#include "Utils\SmartPointer\SmartPointer.h"
+#include <vector>
+
+// Number of bins triangle centroids are sorted into when looking for the cheapest split of a BVH node
+#define TRIANGLE_MESH_SAH_BINS	16
+
+namespace Glade {
+class MeshData;
+
+// Static soup of triangles with a Bounding Volume Hierarchy (BVH) over them. Shared by TriangleMeshColliders
+// Everything is in the mesh's local space, Colliders bring queries into it
+//
+// The BVH is built top-down, splitting each node where the Surface Area Heuristic (SAH) says testing its children
+// will be cheapest. Node bounds are quantized to 16 bits per axis within the mesh's bounds, so a node is 16 bytes.
+// Nodes are stored depth-first: an internal node's first child comes right after it, and each internal node stores
+// the size of its subtree, so queries walk the array front to back and skip subtrees they miss without a stack
+class TriangleMesh
+{
+public:
+	// Build from vertex positions and 3 indices per triangle
+	TriangleMesh(const std::vector<Vector>& verts, const std::vector<unsigned int>& inds);
+	// Build from the vertex and index buffers of a rendered mesh
+	TriangleMesh(SmartPointer<MeshData> mesh);
+
+	unsigned int GetNumTriangles() const { return indices.size() / 3; }
+	unsigned int GetNumNodes() const { return nodes.size(); }
+	const AABB& GetBounds() const { return bounds; }
+	void GetTriangle(unsigned int i, Vector& a, Vector& b, Vector& c) const
+	{
+		a = vertices[indices[i * 3]];
+		b = vertices[indices[i * 3 + 1]];
+		c = vertices[indices[i * 3 + 2]];
+	}
+
+	// Call 'callback(i)' with the index of every triangle whose bounds might overlap 'box'
+	template<class F> void Query(const AABB& box, F callback) const;
+
+	// Find the closest triangle hit by 'ray' within ray.len. 't' is set to the distance along ray.dir
+	bool RayCast(const Ray& ray, gFloat& t, unsigned int& triangle) const;
+
+private:
+	struct Node
+	{
+		unsigned short minimum[3];	// Quantized bounds
+		unsigned short maximum[3];
+		int data;					// Leaf: -(triangle index + 1). Internal: number of nodes in its subtree, including itself
+	};
+
+	void Build();
+	void BuildNode(unsigned int start, unsigned int end, std::vector<unsigned int>& order,
+				   const std::vector<AABB>& triBounds, const std::vector<Vector>& centroids);
+
+	// Quantize a point in local space, rounding down for minimums and up for maximums so bounds only grow
+	void Quantize(const Vector& v, unsigned short (&q)[3], bool roundUp) const;
+	inline bool Overlaps(const Node& n, const unsigned short (&qMin)[3], const unsigned short (&qMax)[3]) const
+	{
+		return n.minimum[0] <= qMax[0] && n.maximum[0] >= qMin[0] &&
+			   n.minimum[1] <= qMax[1] && n.maximum[1] >= qMin[1] &&
+			   n.minimum[2] <= qMax[2] && n.maximum[2] >= qMin[2];
+	}
+
+	std::vector<Vector>			vertices;
+	std::vector<unsigned int>	indices;		// 3 per triangle
+	std::vector<Node>			nodes;
+	AABB						bounds;
+	Vector						quantization;	// Scale from local space (relative to bounds.minimum) to quantized space
+};
+
+template<class F> void TriangleMesh::Query(const AABB& box, F callback) const
+{
+	// Nothing to hit outside the mesh's bounds
+	if(nodes.empty() ||
+	   box.maximum.x < bounds.minimum.x || box.minimum.x > bounds.maximum.x ||
+	   box.maximum.y < bounds.minimum.y || box.minimum.y > bounds.maximum.y ||
+	   box.maximum.z < bounds.minimum.z || box.minimum.z > bounds.maximum.z)
+		return;
+
+	unsigned short qMin[3], qMax[3];
+	Quantize(box.minimum, qMin, false);
+	Quantize(box.maximum, qMax, true);
+
+	unsigned int i = 0, numNodes = nodes.size();
+	while(i < numNodes)
+	{
+		const Node& n = nodes[i];
+		bool overlap = Overlaps(n, qMin, qMax);
+		if(n.data < 0)
+		{
+			if(overlap)
+				callback((unsigned int)(-n.data - 1));
+			++i;
+		}
+		else
+			i += overlap ? 1 : n.data;	// Step into subtree or skip passed it
+	}
+}
+}	// namespace
+#endif	// GLADE_TRIANGLE_MESH_H
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef GLADE_INDEXED_HEAP_H
+#define GLADE_INDEXED_HEAP_H
+
+#ifndef GLADE_PRECISION_H
+#include "../Math/Precision.h"
+#endif
+#include <vector>
+
+namespace Glade {
+// Max-heap of items 0..n-1 keyed by a gFloat, that knows where each item is in the heap
+// so an item's key can be changed in place (O(log n)) instead of rebuilding or rescanning everything.
+// Storage is reused between Builds and only grows
+class IndexedHeap
+{
+public:
+	IndexedHeap() : size(0) { }
+
+	// Make a heap of items 0..n-1, item i keyed by key(i). O(n)
+	template<class KeyFunc> void Build(unsigned int n, KeyFunc key)
+	{
+		size = n;
+		if(heap.size() < n)
+		{
+			heap.resize(n);
+			positions.resize(n);
+			keys.resize(n);
+		}
+		for(unsigned int i = 0; i < n; ++i)
+		{
+			heap[i] = i;
+			positions[i] = i;
+			keys[i] = key(i);
+		}
+		for(unsigned int i = n / 2; i-- > 0;)
+			SiftDown(i);
+	}
+
+	bool			IsEmpty() const { return size == 0; }
+	// Item with the largest key
+	unsigned int	Top() const { return heap[0]; }
+	gFloat			TopKey() const { return keys[heap[0]]; }
+	gFloat			GetKey(unsigned int item) const { return keys[item]; }
+
+	// Change 'item's key and move it to its new place in the heap
+	void Update(unsigned int item, gFloat key)
+	{
+		gFloat old = keys[item];
+		keys[item] = key;
+		if(key > old)	SiftUp(positions[item]);
+		else			SiftDown(positions[item]);
+	}
+
+private:
+	void SiftUp(unsigned int p)
+	{
+		unsigned int item = heap[p];
+		while(p > 0)
+		{
+			unsigned int parent = (p - 1) / 2;
+			if(keys[heap[parent]] >= keys[item]) break;
+			Place(heap[parent], p);
+			p = parent;
+		}
+		Place(item, p);
+	}
+
+	void SiftDown(unsigned int p)
+	{
+		unsigned int item = heap[p];
+		for(;;)
+		{
+			unsigned int child = 2 * p + 1;
+			if(child >= size) break;
+			if(child + 1 < size && keys[heap[child + 1]] > keys[heap[child]]) ++child;
+			if(keys[heap[child]] <= keys[item]) break;
+			Place(heap[child], p);
+			p = child;
+		}
+		Place(item, p);
+	}
+
+	inline void Place(unsigned int item, unsigned int p) { heap[p] = item; positions[item] = p; }
+
+	unsigned int				size;
+	std::vector<unsigned int>	heap;		// Item at each heap position
+	std::vector<unsigned int>	positions;	// Heap position of each item
+	std::vector<gFloat>			keys;		// Key of each item
+};
+}	// namespace
+#endif	// GLADE_INDEXED_HEAP_H
@@ -1,11 +1,14 @@
-#include "World.h"
+﻿#include "World.h"
 
 using namespace Glade;
 
 World::World(int worldMin, int worldMax, int cellSize_, unsigned int maxContacts_, unsigned int iterations) : 
-			contactResolver(iterations), maxContacts(maxContacts_), worldCoordinateMinimum(worldMin), worldCoordinateMaximum(worldMax), cellSize(cellSize_)
+			contactResolver(iterations), contactStream(maxContacts_), workerPool(PHYSICS_THREADS),
+#ifdef NARROWPHASE_CACHE
+			stepCount(0),
+#endif
+			worldCoordinateMinimum(worldMin), worldCoordinateMaximum(worldMax), cellSize(cellSize_)
 {
-	contacts = new Contact[4];
 	calculateIterations = (iterations == 0);
 
 	AssertMsg((worldMax-worldMin) % cellSize_ == 0, "World cannot be evenly divided into cells with given World size and cell dimensions");
@@ -15,12 +18,17 @@ World::World(int worldMin, int worldMax, int cellSize_, unsigned int maxContacts
 	hashTable = new SpatialHashCell*[numBuckets];
 	for(int i = 0; i < numBuckets; ++i)
 		hashTable[i] = nullptr;
+
+	// Every layer collides with every other until told otherwise
+	for(unsigned int i = 0; i < NUM_COLLISION_LAYERS; ++i)
+		layerMatrix[i] = ~0;
 }
 
 
 World::~World()
 {
-	delete[] contacts;
+	for(unsigned int i = 0; i < chunkStreams.size(); ++i)
+		delete chunkStreams[i];
 	for(int i = 0; i < numBuckets; ++i)
 		delete hashTable[i];
 	delete[] hashTable;
@@ -28,26 +36,147 @@ World::~World()
 
 unsigned int World::GenerateContacts()
 {
-	unsigned int limit = maxContacts;
-	int used;
-	static int tests = 0;
+	contactStream.Clear();
 
 // ~~~~ GENERATE CONTACTS VIA COLLISION DETECTION ~~~~
+	BroadPhase();
+#ifdef CONTINUOUS_COLLISION
+	SweepPairs();
+#endif
+	NarrowPhase();
+
+#ifdef NARROWPHASE_CACHE
+	// Forget pairs broadphase did not find this step
+	for(auto i = pairCache.begin(); i != pairCache.end();)
+	{
+		if(i->second.lastStep != stepCount)	i = pairCache.erase(i);
+		else								++i;
+	}
+	++stepCount;
+#endif
+
+	if(contactStream.IsOverflowed())
+		TRACE("World::GenerateContacts - Contact budget of %u exceeded, %u Contacts dropped\n", contactStream.GetBudget(), contactStream.GetDroppedCount());
+
+#ifdef SLEEP_ISLANDS
+	// Wake Islands touched by awake RigidBodies and put to sleep Islands that have settled
+	islandManager.Update(rigidBodies, contactStream);
+#endif
+
+// ~~~~ SORT CONTACTS INTO BATCHES ~~~~
+	// Done after all collision detection so Contacts dropped by the stream never end up in a batch
+	int batch1, batch2;
+	unsigned int result;
+	ContactBatch* batch = nullptr;
+	RigidBody* b1 = nullptr, *b2 = nullptr;
+	for(unsigned int c = 0; c < contactStream.GetSize(); ++c)
+	{
+		Contact& contact = contactStream[c];
+		contact.DrawDebug();
+
+		// Contacts from the same pair of RigidBodies are next to each other and go in the same batch
+		if(batch != nullptr && contact.GetBody1() == b1 && contact.GetBody2() == b2)
+		{
+			batch->AddContact(contact);
+			continue;
+		}
+		b1 = contact.GetBody1();
+		b2 = contact.GetBody2();
+
+		// Find correct ContactBatch (if it exists) to add Contact to
+		// If correct ContactBatch does not exist, create it.
+		batch1 = -1; batch2 = -1;
+		batch = nullptr;
+		for(unsigned int k = 0; k < contactBatches.size(); ++k)
+		{
+			result = contactBatches[k]->ContainsRigidBodies(b1, b2);
+				
+			// Batch found that contains both Objects already
+			// There's a triangle of collisions (we have A-B and A-C already, now we found B-C)
+			if(result == 2) 
+			{ batch1 = k; batch = contactBatches[k]; break; }
+			// Batch found that contains one of the Objects
+			else if(result == 1)
+			{
+				if(batch1 == -1) { batch1 = k; batch = contactBatches[k]; }
+				else			 batch2 = k;
+			}
+		}
+
+		// Need to create new ContactBatch
+		if(batch1 == -1)
+		{
+			batch = new ContactBatch();
+			contactBatches.push_back(batch);
+		}
+		// Need to MERGE two ContactBatches
+		else if(batch2 != -1)
+		{
+			contactBatches[batch1]->MergeBatch(contactBatches[batch2]);
+			delete contactBatches[batch2];
+			contactBatches.erase(contactBatches.begin() + batch2);
+			batch = contactBatches[batch1];
+		}
+
+		batch->AddContact(contact);
+	}
+
+// ~~~~ GENERATE CONTACTS VIA CONTACT GENERATORS ~~~~
+/*	for(auto i = contactGenerators.begin(); i != contactGenerators.end(); ++i)
+	{
+		used = (*i)->GenerateContact(nextContact, limit);
+		
+		if(used < 0)
+		{
+			delete *i;
+			i = contactGenerators.erase(i);
+			i--;
+			continue;
+		}
+
+		limit -= used;
+		contactsUsedThisFrame += used;
+		nextContact += used;
+
+		if(limit <= 0) break;
+	}
+*/
+	return contactStream.GetSize();
+}
+
+void World::BroadPhase()
+{
 	std::set<RigidBody*> bodies;
 	std::set<std::pair<unsigned int, unsigned int>> testedPairs;
-	std::vector<Collider*> aColliders, bColliders;
 	unsigned int iID, jID;
-	unsigned int aSize, bSize;
+	CollisionPair pair;
+
+	collisionPairs.clear();
 
 	// Loop through each Object/RigidBody in the World
 	for(auto i = rigidBodies.begin(); i != rigidBodies.end(); ++i)
 	{
-		auto indices = (*i)->GetHashIndices();	// Get the indices of the hash cell it's in
+		// Pairs between two sleeping (or infinite mass) RigidBodies never need testing. Pairs with one
+		// awake RigidBody are still found when that RigidBody is the current one
+		if(!(*i)->GetAwake() || (*i)->GetInverseMass() == gFloat(0.0f))
+			continue;
+
+		const auto& indices = (*i)->GetHashIndices();	// Get the indices of the hash cell it's in
+
+		// Layers this RigidBody's Colliders collide with
+		int types = (*i)->GetCollisionTypes(), masks = (*i)->GetCollisionMasks();
+		int layers = LayersCollidingWith(types);
 
 		// Loop through each hash cell it's in
 		for(auto j = indices.begin(); j != indices.end(); ++j)
 		{
-			auto bucket = hashTable[*j]->bucket;	// Get list of Objects/RigidBodies in that cell
+			// Skip cells where nothing is on a layer this RigidBody collides with, or that no mask lets it collide with
+			// Either RigidBody can end up first in the pair, so masks are checked both ways here
+			SpatialHashCell* cell = hashTable[*j];
+			if((cell->collisionTypes & layers) == 0 || ((cell->collisionTypes & masks) == 0 && (cell->collisionMasks & types) == 0))
+				continue;
+
+			const auto& bucket = cell->bucket;	// Get list of Objects/RigidBodies in that cell
 
 			// Loop through each Object/RigidBody in cell, add to master list
 			for(auto k = bucket.begin(); k != bucket.end(); ++k)
@@ -65,106 +194,481 @@ unsigned int World::GenerateContacts()
 			if(!testedPairs.insert(std::make_pair((iID<jID?iID:jID), (iID>jID?iID:jID))).second)
 				continue;
 
-			// Find correct ContactBatch (if it exists) to add possible Contact to
-			// If correct ContactBatch does not exist, create it.
-			// If both Objects already collided (from a previous bucket), ignore them
-			int batch1 = -1, batch2 = -1;
-			unsigned int result;
-			ContactBatch* batch = nullptr;
-			for(unsigned int k = 0; k < contactBatches.size(); ++k)
-			{
-				result = contactBatches[k]->ContainsRigidBodies(iID, jID);
-					
-				// Batch found that contains both Objects already
-				// There's a triangle of collisions (we have A-B and A-C already, now we found B-C)
-				if(result == 2) 
-				{ batch1 = k; batch = contactBatches[k]; break; }
-				// Batch found that contains one of the Objects
-				else if(result == 1)
-				{
-					if(batch1 == -1) { batch1 = k; batch = contactBatches[k]; }
-					else			 batch2 = k;
-				}
-			}
+			// Drop pairs none of whose Colliders could collide before testing their bounds
+			// Lower ID's Colliders' masks are the ones TestPair checks
+			RigidBody* first = iID < jID ? *i : *j, *second = iID < jID ? *j : *i;
+			if((first->GetCollisionMasks() & second->GetCollisionTypes()) == 0 ||
+			   (LayersCollidingWith(first->GetCollisionTypes()) & second->GetCollisionTypes()) == 0)
+				continue;
 
-			// If the AABB intersect, do more rigorous testing (actual collider tests)
-			// TODO - AABB'S NEARLY IN CONTACT BUT NOT QUITE SHOULD BE ADDED TO CONTACT BATCHES
-			// IN CASE INTERPENETRATION RESOLUTION OF NEARBY CONTACTS ENDS UP AFFECTING THEM 
-			// BY PROXY. CREATE CONTACT WITH NEGATIVE PENETRATION
+#ifdef SPECULATIVE_CONTACTS
+			// Distance the pair could close by the end of this step. AABBs that near are tested as well
+			// and generate Speculative Contacts (negative penetration) if their Colliders are that near
+			pair.margin = (((*i)->GetVelocity() - (*j)->GetVelocity()).Magnitude() +
+							(*i)->GetAngularVelocity().Magnitude() * (*i)->GetRadius() +
+							(*j)->GetAngularVelocity().Magnitude() * (*j)->GetRadius()) * PHYSICS_TIMESTEP;
+#ifdef CONTINUOUS_COLLISION
+			// RigidBodies using CCD are tested everywhere they went this step
+			if(CollisionTests::AABBTest((*i)->GetSweptBoundingBox(), (*j)->GetSweptBoundingBox(), pair.margin))
+#else
+			if(CollisionTests::AABBTest((*i)->GetBoundingBox(), (*j)->GetBoundingBox(), pair.margin))
+#endif
+#else
+			// If the AABB intersect, the pair needs more rigorous testing (actual collider tests)
+			pair.margin = gFloat(0.0f);
 			if(CollisionTests::AABBTest((*i)->GetBoundingBox(), (*j)->GetBoundingBox()))
+#endif
 			{
-				// Get Collider(s) of each Object
-				aSize = (*i)->GetColliders(aColliders);
-				bSize = (*j)->GetColliders(bColliders);
+				// Lower ID always first so a pair is always tested the same way around
+				pair.a = iID < jID ? *i : *j;
+				pair.b = iID < jID ? *j : *i;
+				pair.cost = 0;
+				collisionPairs.push_back(pair);
+			}
+		}
 
-				// Test all Colliders of each Object against all Colliders of the other
-				for(unsigned int a = 0; a < aSize; ++a)
-				{
-					// Collider 'a' must be Enabled
-					if(!aColliders[a]->IsEnabled()) continue;
+		bodies.clear();
+	}
 
-					for(unsigned int b = 0; b < bSize; ++b)
-					{
-						// Collider 'b' must be Enabled
-						if(!bColliders[b]->IsEnabled()) continue;
+	// Hash buckets are sets of pointers, so the order pairs are found in changes from run to run
+	// Sort by ID so narrowphase (and everything after it) sees the pairs in the same order every time
+	std::sort(collisionPairs.begin(), collisionPairs.end(), [](const CollisionPair& x, const CollisionPair& y) 
+	{
+		return x.a->GetID() != y.a->GetID() ? x.a->GetID() < y.a->GetID() : x.b->GetID() < y.b->GetID();
+	});
+}
 
-						// Query  Colliders' Collision Mask(s) to ensure these Colliders can collide(r)
-						if(!aColliders[a]->QueryCollisionMask(bColliders[b]->GetCollisionType())) continue; 
+void World::NarrowPhase()
+{
+	unsigned int numPairs = collisionPairs.size();
+	if(numPairs == 0) return;
+
+	// Estimate how much work each pair is
+	unsigned int totalCost = 0;
+#ifdef BATCH_SPHERE_TESTS
+	sphereSphereBatch.Clear();
+	spherePlaneBatch.Clear();
+#endif
+	for(unsigned int i = 0; i < numPairs; ++i)
+	{
+		collisionPairs[i].kernel = nullptr;
+#ifdef BATCH_SPHERE_TESTS
+		collisionPairs[i].batch = nullptr;
+#endif
+#ifdef NARROWPHASE_CACHE
+		// Cache entries are looked up here so narrowphase threads never change 'pairCache'
+		PairCache& cache = pairCache[std::make_pair(collisionPairs[i].a->GetID(), collisionPairs[i].b->GetID())];
+		cache.lastStep = stepCount;
+		collisionPairs[i].cache = &cache;
+		if((cache.reuse = CanReuseCache(collisionPairs[i])))
+		{
+			collisionPairs[i].cost = 1;
+			totalCost += 1;
+			continue;
+		}
+#endif
+#ifdef BATCH_SPHERE_TESTS
+		// Tested below with the rest of its batch, all that's left for TestPair is writing the Contact
+		if(BatchPair(collisionPairs[i]))
+		{
+			collisionPairs[i].cost = 1;
+			totalCost += 1;
+			continue;
+		}
+#endif
+		auto& aColliders = collisionPairs[i].a->GetColliders();
+		auto& bColliders = collisionPairs[i].b->GetColliders();
 
-						// No pre-set reason why Colliders cannot collide - Actually test for intersection now
-						used = CollisionTests::TestCollision(aColliders[a], bColliders[b], contacts);							
-						limit -= used;
+		// Most RigidBodies have a single Collider. Pick the test for those pairs once here instead of in TestPair
+		if(aColliders.size() == 1 && bColliders.size() == 1)
+			collisionPairs[i].kernel = CollisionTests::SelectKernel(aColliders[0], bColliders[0]);
 
-						if(used)
-						{
-							// Need to create new ContactBatch
-							if(batch1 == -1)
-							{
-								batch = new ContactBatch();
-								contactBatches.push_back(batch);
-							}
-							// Need to MERGE two ContactBatches
-							else if(batch2 != -1)
-							{
-								contactBatches[batch1]->MergeBatch(contactBatches[batch2]);
-								delete contactBatches[batch2];
-								contactBatches.erase(contactBatches.begin() + batch2);
-								batch = contactBatches[batch1];
-							}
-
-
-							// Add generated Contacts to ContactBatch
-							for(unsigned int l = 0; l < used; ++l)
-								batch->AddContact(contacts[l]);
-						}
-					}
-				}
-			}
+		for(unsigned int a = 0; a < aColliders.size(); ++a)
+			for(unsigned int b = 0; b < bColliders.size(); ++b)
+				collisionPairs[i].cost += CollisionTests::EstimateCost(aColliders[a], bColliders[b]);
+		totalCost += collisionPairs[i].cost;
+	}
+
+#ifdef BATCH_SPHERE_TESTS
+	CollisionTests::SphereSphereBatchTest(sphereSphereBatch);
+	CollisionTests::SpherePlaneBatchTest(spherePlaneBatch);
+#endif
+
+	// Too little work to be worth splitting up - test everything on this thread straight into the main stream
+	unsigned int numChunks = workerPool.GetNumThreads();
+	if(numChunks == 1 || totalCost < MIN_PARALLEL_NARROWPHASE_COST)
+	{
+		for(unsigned int i = 0; i < numPairs; ++i)
+			if(!TestPair(collisionPairs[i], contactStream))
+				break;
+		return;
+	}
+
+	// Split pair list into contiguous chunks of roughly equal cost, one per thread
+	chunkStart.assign(numChunks + 1, numPairs);
+	chunkStart[0] = 0;
+	unsigned int chunk = 1, runningCost = 0;
+	for(unsigned int i = 0; i < numPairs && chunk < numChunks; ++i)
+	{
+		runningCost += collisionPairs[i].cost;
+		while(chunk < numChunks && runningCost >= (unsigned long long)totalCost * chunk / numChunks)
+			chunkStart[chunk++] = i + 1;
+	}
+
+	// Each chunk writes into its own stream, set up like the main stream
+	while(chunkStreams.size() < numChunks)
+		chunkStreams.push_back(new ContactStream(contactStream.GetBudget()));
+	for(unsigned int i = 0; i < numChunks; ++i)
+	{
+		chunkStreams[i]->Clear();
+		if(chunkStreams[i]->GetBudget() != contactStream.GetBudget())
+			chunkStreams[i]->SetBudget(contactStream.GetBudget());
+		chunkStreams[i]->SetGrowthLimit(contactStream.GetGrowthLimit());
+		chunkStreams[i]->SetOverflowPolicy(contactStream.GetOverflowPolicy());
+	}
+
+	workerPool.ParallelFor(numChunks, [this](unsigned int c)
+	{
+		for(unsigned int i = chunkStart[c]; i < chunkStart[c + 1]; ++i)
+			if(!TestPair(collisionPairs[i], *chunkStreams[c]))
+				break;
+	});
+
+	// Chunks are in pair order, so appending them in chunk order gives the same Contacts in 
+	// the same order no matter how many threads there are or which finished first
+	for(unsigned int i = 0; i < numChunks; ++i)
+		contactStream.Append(*chunkStreams[i]);
+}
+
+bool World::TestPair(const CollisionPair& pair, ContactStream& stream)
+{
+	Contact* contacts;
+	unsigned int used;
+	auto& aColliders = pair.a->GetColliders();
+	auto& bColliders = pair.b->GetColliders();
+
+#ifdef NARROWPHASE_CACHE
+	PairCache& cache = *pair.cache;
+	if(cache.reuse)
+		return ReuseCachedContacts(pair, stream);
+
+	// Only marked complete once every pair of Colliders has been tested
+	cache.complete = false;
+	cache.used.assign(aColliders.size() * bColliders.size(), 0);
+	cache.contacts.resize(cache.used.size() * MAX_CONTACTS_PER_TEST);
+#ifdef COLLISION_WARM_START
+	// Colliders were added or removed, old directions no longer line up with the Colliders
+	if(cache.warmStarts.size() != cache.used.size())
+		cache.warmStarts.assign(cache.used.size(), CollisionWarmStart());
+#endif
+#endif
+
+	// Descend both RigidBodies' Collider trees together, only testing Colliders whose boxes are within the margin
+	bool room = ColliderTree::QueryPair(pair.a->GetColliderTree(), pair.a->GetTransformMatrix(), pair.b->GetColliderTree(), pair.b->GetTransformMatrix(),
+		pair.margin, [&](unsigned int a, unsigned int b) -> bool
+	{
+		// Both Colliders must be Enabled
+		if(!aColliders[a]->IsEnabled() || !bColliders[b]->IsEnabled()) return true;
+
+		// Query  Colliders' Collision Mask(s) and Layers to ensure these Colliders can collide(r)
+		if(!CanCollide(aColliders[a], bColliders[b])) return true;
+
+		// Out of room and told to report rather than make room - stop collision detection for this step
+		if((contacts = stream.Reserve()) == nullptr)
+			return false;
+
+#ifdef BATCH_SPHERE_TESTS
+		// Already tested with the rest of its batch (including Speculative Contacts)
+		if(pair.batch != nullptr)
+			used = CollisionTests::GetBatchContact(*pair.batch, pair.batchIndex, contacts);
+		else
+#endif
+		{
+			// No pre-set reason why Colliders cannot collide - Actually test for intersection now
+#ifdef COLLISION_WARM_START
+			CollisionWarmStart* warmStart = &cache.warmStarts[a * bColliders.size() + b];
+#else
+			CollisionWarmStart* warmStart = nullptr;
+#endif
+			if(pair.kernel != nullptr)
+				used = pair.kernel(aColliders[a], bColliders[b], contacts, warmStart);
+			else
+				used = CollisionTests::TestCollision(aColliders[a], bColliders[b], contacts, warmStart);
+
+#ifdef SPECULATIVE_CONTACTS
+			// Not touching, but maybe close enough to by the end of the step
+			if(used == 0)
+				used = CollisionTests::SpeculativeTest(aColliders[a], bColliders[b], pair.margin, contacts);
+#endif
 		}
+#ifdef NARROWPHASE_CACHE
+		// Before Commit, which may overwrite Contacts that don't fit
+		StoreCachedContacts(cache, a * bColliders.size() + b, contacts, used);
+#endif
+		stream.Commit(used);
+		return true;
+	});
+	if(!room)
+		return false;
+
+#ifdef NARROWPHASE_CACHE
+	// Remember where the RigidBodies were relative to each other for these results
+	Matrix aTransform = pair.a->GetTransformMatrix();
+	cache.relativePosition = aTransform.Transpose3Times(pair.b->GetCentroid() - pair.a->GetCentroid());
+	cache.relativeOrientation = pair.a->GetOrientation().Conjugated() * pair.b->GetOrientation();
+	cache.margin = pair.margin;
+	cache.age = 0;
+	cache.complete = true;
+#endif
+
+	return true;
+}
+
+#ifdef BATCH_SPHERE_TESTS
+bool World::BatchPair(CollisionPair& pair)
+{
+	auto& aColliders = pair.a->GetColliders();
+	auto& bColliders = pair.b->GetColliders();
+	if(aColliders.size() != 1 || bColliders.size() != 1)
+		return false;
+
+	// Same checks TestPair makes, a pair that wouldn't be tested isn't batched
+	Collider* a = aColliders[0], *b = bColliders[0];
+	if(!a->IsEnabled() || !b->IsEnabled() || !CanCollide(a, b))
+		return false;
+
+#ifdef SPECULATIVE_CONTACTS
+	gFloat margin = pair.margin;
+#else
+	gFloat margin = gFloat(0.0f);
+#endif
+
+	// Sphere always goes first, same order TestCollision would use
+	Collider::ColliderShape aShape = a->GetShape(), bShape = b->GetShape();
+	if(aShape == Collider::ColliderShape::SPHERE && bShape == Collider::ColliderShape::SPHERE)
+	{
+		pair.batch = &sphereSphereBatch;
+		pair.batchIndex = CollisionTests::AddSpherePair(sphereSphereBatch, a, b, margin);
+	}
+	else if(aShape == Collider::ColliderShape::SPHERE && bShape == Collider::ColliderShape::PLANE)
+	{
+		pair.batch = &spherePlaneBatch;
+		pair.batchIndex = CollisionTests::AddSpherePair(spherePlaneBatch, a, b, margin);
 	}
+	else if(aShape == Collider::ColliderShape::PLANE && bShape == Collider::ColliderShape::SPHERE)
+	{
+		pair.batch = &spherePlaneBatch;
+		pair.batchIndex = CollisionTests::AddSpherePair(spherePlaneBatch, b, a, margin);
+	}
+	else
+		return false;
 
-// ~~~~ GENERATE CONTACTS VIA CONTACT GENERATORS ~~~~
-/*	for(auto i = contactGenerators.begin(); i != contactGenerators.end(); ++i)
+	return true;
+}
+#endif
+
+#ifdef NARROWPHASE_CACHE
+bool World::CanReuseCache(const CollisionPair& pair)
+{
+	PairCache& cache = *pair.cache;
+	if(!cache.complete || cache.age >= PAIR_CACHE_MAX_AGE)
+		return false;
+
+	// Colliders were added since the last test
+	if(cache.used.size() != pair.a->GetColliders().size() * pair.b->GetColliders().size())
+		return false;
+
+	// Pair can close further this step than it could when tested, so it may need Speculative Contacts it doesn't have
+	if(pair.margin > cache.margin + PAIR_CACHE_LINEAR_TOLERANCE)
+		return false;
+
+	// Compare against the pose of the last full test (not last step) so slow drift still adds up to a retest
+	Matrix aTransform = pair.a->GetTransformMatrix();
+	Vector relativePosition = aTransform.Transpose3Times(pair.b->GetCentroid() - pair.a->GetCentroid());
+	if((relativePosition - cache.relativePosition).SquaredMagnitude() > PAIR_CACHE_LINEAR_TOLERANCE * PAIR_CACHE_LINEAR_TOLERANCE)
+		return false;
+
+	// Angle between two orientations is 2 * acos(|q1 . q2|)
+	Quaternion relativeOrientation = pair.a->GetOrientation().Conjugated() * pair.b->GetOrientation();
+	if(Abs(relativeOrientation.DotProduct(cache.relativeOrientation)) < Cos(PAIR_CACHE_ANGULAR_TOLERANCE * gFloat(0.5f)))
+		return false;
+
+	return true;
+}
+
+void World::StoreCachedContacts(PairCache& cache, unsigned int index, Contact* contacts, unsigned int used)
+{
+	Matrix t1, t2;
+	cache.used[index] = used;
+	for(unsigned int i = 0; i < used; ++i)
 	{
-		used = (*i)->GenerateContact(nextContact, limit);
-		
-		if(used < 0)
+		CachedContact& cached = cache.contacts[index * MAX_CONTACTS_PER_TEST + i];
+		cached.contact = contacts[i];
+
+		// Keep the point on each RigidBody so it can be moved with them
+		contacts[i].b1->GetTransformMatrix(&t1);
+		contacts[i].b2->GetTransformMatrix(&t2);
+		cached.localPoint1 = t1.Transpose3Times(contacts[i].point - contacts[i].b1->GetCentroid());
+		cached.localPoint2 = t2.Transpose3Times(contacts[i].point - contacts[i].b2->GetCentroid());
+		cached.localNormal = t1.Transpose3Times(contacts[i].normal);
+	}
+}
+
+bool World::ReuseCachedContacts(const CollisionPair& pair, ContactStream& stream)
+{
+	Contact* contacts;
+	Matrix t1, t2;
+	Vector p1, p2;
+	unsigned int used;
+	auto& aColliders = pair.a->GetColliders();
+	auto& bColliders = pair.b->GetColliders();
+	PairCache& cache = *pair.cache;
+	++cache.age;
+
+	for(unsigned int a = 0; a < aColliders.size(); ++a)
+	{
+		if(!aColliders[a]->IsEnabled()) continue;
+
+		for(unsigned int b = 0; b < bColliders.size(); ++b)
 		{
-			delete *i;
-			i = contactGenerators.erase(i);
-			i--;
+			// Same checks as a full test, in case a Collider was disabled or its mask changed
+			if(!bColliders[b]->IsEnabled()) continue;
+			if(!CanCollide(aColliders[a], bColliders[b])) continue;
+
+			used = cache.used[a * bColliders.size() + b];
+			if(used == 0) continue;
+
+			if((contacts = stream.Reserve()) == nullptr)
+				return false;
+
+			for(unsigned int i = 0; i < used; ++i)
+			{
+				CachedContact& cached = cache.contacts[(a * bColliders.size() + b) * MAX_CONTACTS_PER_TEST + i];
+				contacts[i] = cached.contact;
+
+				// Where the cached point is on each RigidBody now. Any separation of the two
+				// along the normal since the test comes off the penetration depth
+				cached.contact.b1->GetTransformMatrix(&t1);
+				cached.contact.b2->GetTransformMatrix(&t2);
+				p1 = t1.Times3(cached.localPoint1) + cached.contact.b1->GetCentroid();
+				p2 = t2.Times3(cached.localPoint2) + cached.contact.b2->GetCentroid();
+				contacts[i].normal = t1.Times3(cached.localNormal);
+				contacts[i].point = (p1 + p2) * gFloat(0.5f);
+				contacts[i].penetrationDepth = cached.contact.penetrationDepth - (p2 - p1).DotProduct(contacts[i].normal);
+			}
+			stream.Commit(used);
+		}
+	}
+
+	return true;
+}
+#endif
+
+#ifdef CONTINUOUS_COLLISION
+void World::SweepPairs()
+{
+	// Earliest Time of Impact of each RigidBody using CCD, against everything broadphase paired it with
+	std::map<RigidBody*, gFloat> earliest;
+	for(unsigned int i = 0; i < collisionPairs.size(); ++i)
+	{
+		RigidBody* a = collisionPairs[i].a, *b = collisionPairs[i].b;
+		if(!a->GetContinuousCollision() && !b->GetContinuousCollision())
 			continue;
+
+		gFloat toi = TimeOfImpact(a, b);
+		if(toi >= gFloat(1.0f)) continue;
+		if(a->GetContinuousCollision())
+		{
+			auto e = earliest.insert(std::make_pair(a, toi)).first;
+			e->second = Min(e->second, toi);
 		}
+		if(b->GetContinuousCollision())
+		{
+			auto e = earliest.insert(std::make_pair(b, toi)).first;
+			e->second = Min(e->second, toi);
+		}
+	}
 
-		limit -= used;
-		contactsUsedThisFrame += used;
-		nextContact += used;
+	// Only these RigidBodies are moved back, everything else stays where it ended the step. The Speculative Contacts
+	// narrowphase generates at the Time of Impact stop them, and they carry on from there next step
+	for(auto i = earliest.begin(); i != earliest.end(); ++i)
+	{
+		i->first->RewindSweep(i->second);
+		UpdateHashedObject(i->first);
+	}
+}
 
-		if(limit <= 0) break;
+gFloat World::TimeOfImpact(RigidBody* a, RigidBody* b)
+{
+	// Conservative advancement: step forward by the distance between the Colliders divided by the fastest they could
+	// be closing. They can't have touched before then, so the sweep never steps passed the Time of Impact
+	// Fastest closing speed is the relative motion along the closest points, plus how fast each RigidBody's
+	// furthest point from its centroid turns
+	auto reach = [](RigidBody* r)
+	{
+		const AABB& box = r->GetBoundingBox();
+		Vector c = r->GetCentroid();
+		return Vector(Max(Abs(box.minimum.x - c.x), Abs(box.maximum.x - c.x)),
+					  Max(Abs(box.minimum.y - c.y), Abs(box.maximum.y - c.y)),
+					  Max(Abs(box.minimum.z - c.z), Abs(box.maximum.z - c.z))).Magnitude();
+	};
+	Vector motion = a->GetSweptMotion() - b->GetSweptMotion();
+	gFloat turning = a->GetSweptRotation() * reach(a) + b->GetSweptRotation() * reach(b);
+
+	auto& aColliders = a->GetColliders();
+	auto& bColliders = b->GetColliders();
+	gFloat toi = gFloat(1.0f), t, dist, closing;
+	Vector pointA, pointB, normal;
+	for(unsigned int i = 0; i < aColliders.size(); ++i)
+	{
+		// Only convex Colliders have support points for GJK. Pairs with Planes, meshes and heightfields are left to
+		// Speculative Contacts
+		if(!aColliders[i]->IsEnabled() || !aColliders[i]->IsConvex()) continue;
+
+		for(unsigned int j = 0; j < bColliders.size(); ++j)
+		{
+			if(!bColliders[j]->IsEnabled() || !bColliders[j]->IsConvex()) continue;
+			if(!CanCollide(aColliders[i], bColliders[j])) continue;
+
+			t = gFloat(0.0f);
+			for(unsigned int k = 0; k < CCD_MAX_ITERATIONS && t < toi; ++k)
+			{
+				aColliders[i]->CalcTransformAndDerivedGeometricData(a->GetSweptTransform(t));
+				bColliders[j]->CalcTransformAndDerivedGeometricData(b->GetSweptTransform(t));
+				dist = CollisionTests::GJKDistance(aColliders[i], bColliders[j], pointA, pointB);
+
+				// Already touching at the start of the step, normal Contacts handle it
+				if(k == 0 && dist < CCD_DISTANCE_TOLERANCE)
+					break;
+				if(dist < CCD_DISTANCE_TOLERANCE)
+				{
+					toi = t;
+					break;
+				}
+
+				// Not closing, so they never touch this step
+				normal = (pointB - pointA) / dist;
+				closing = motion.DotProduct(normal) + turning;
+				if(closing <= gFloat(0.0f))
+					break;
+
+				t += (dist - CCD_DISTANCE_TOLERANCE * gFloat(0.5f)) / closing;
+				if(t >= toi)
+					break;
+
+				// Out of steps while still closing in. Stop where the sweep got to
+				if(k == CCD_MAX_ITERATIONS - 1)
+					toi = t;
+			}
+		}
 	}
-*/
-	return maxContacts - limit;
+
+	// Put Colliders back where their RigidBodies ended the step
+	a->CalcBoundingBox();
+	b->CalcBoundingBox();
+	return toi;
 }
+#endif
 
 void World::PhysicsUpdate(gFloat dt)
 {
@@ -174,6 +678,10 @@ void World::PhysicsUpdate(gFloat dt)
 	while(timeAccumulator >= PHYSICS_TIMESTEP)
 	{
 		// Apply Force Generators and Integrate
+#ifdef BATCH_COLLIDER_UPDATE
+		colliderUpdate.Clear();
+		movedBodies.clear();
+#endif
 		for(auto i = rigidBodies.begin(); i != rigidBodies.end(); ++i)
 		{
 			//auto ids = (*i)->GetRegistedForceGenerators();
@@ -181,21 +689,37 @@ void World::PhysicsUpdate(gFloat dt)
 				//forceGeneratos[*j]->GenerateForce(*i);
 
 			// Integrate - If Object is moving, rehash it in the Spatial Hash
+#ifdef BATCH_COLLIDER_UPDATE
+			// Once its Colliders have moved
+			if((*i)->Update(false))
+			{
+				colliderUpdate.Add(*i);
+				movedBodies.push_back(*i);
+			}
+#else
 			if((*i)->Update())
 				UpdateHashedObject(*i);
+#endif
 		}
+#ifdef BATCH_COLLIDER_UPDATE
+		colliderUpdate.Run(workerPool);
+		for(unsigned int i = 0; i < movedBodies.size(); ++i)
+			UpdateHashedObject(movedBodies[i]);
+#endif
 
 		 // Generate and process (if necessary) contacts
 		unsigned int usedContacts = GenerateContacts();
 		if(usedContacts)
 		{
 			if(calculateIterations)
+#ifdef SOLVE_VELOCITY_PGS
+				contactResolver.SetIterations(PGS_ITERATIONS, usedContacts*3);
+#else
 				contactResolver.SetIterations(usedContacts*3);
+#endif
+			contactResolver.ResolveContacts(contactBatches, workerPool);
 			for(unsigned int i = 0; i < contactBatches.size(); ++i)
-			{
-				contactResolver.ResolveContacts(contactBatches[i]);
 				delete contactBatches[i];
-			}
 
 			// Clear batches for next frame
 			contactBatches.clear();
@@ -285,7 +809,11 @@ std::set<int> World::GetHashIndices(RigidBody* o)
 	std::set<int> indices;
 
 	// Calculate number of cells between BoundingBox min/max
+#ifdef CONTINUOUS_COLLISION
+	AABB bounds = o->GetSweptBoundingBox();	// Everywhere it went this step, so broadphase finds what it passed
+#else
 	AABB bounds = o->GetBoundingBox();
+#endif
 	int diffX = std::floor((((((int)bounds.maximum.x / cellSize) * cellSize) + cellSize) - bounds.minimum.x) / cellSize);
 	int diffY = std::floor((((((int)bounds.maximum.y / cellSize) * cellSize) + cellSize) - bounds.minimum.y) / cellSize);
 	int diffZ = std::floor((((((int)bounds.maximum.z / cellSize) * cellSize) + cellSize) - bounds.minimum.z) / cellSize);
@@ -319,9 +847,15 @@ void World::AddToHash(RigidBody* o)
 		{
 			hashTable[*iter] = new SpatialHashCell;
 			hashTable[*iter]->boundingBox = CalcHashCellBounds(*iter);
+			hashTable[*iter]->collisionTypes = hashTable[*iter]->collisionMasks = 0;
+			std::fill(hashTable[*iter]->typeCounts, hashTable[*iter]->typeCounts + 32, 0);
+			std::fill(hashTable[*iter]->maskCounts, hashTable[*iter]->maskCounts + 32, 0);
 		}
 		hashTable[*iter]->bucket.push_back(o);
+		AddHashCellLayers(hashTable[*iter], o->GetCollisionTypes(), o->GetCollisionMasks());
 	}
+	o->hashedCollisionTypes = o->GetCollisionTypes();
+	o->hashedCollisionMasks = o->GetCollisionMasks();
 
 	// Save the list of cells/indices in hash intersected by this Object
 	o->SetHashIndices(indices);
@@ -333,7 +867,7 @@ void World::UpdateHashedObject(RigidBody* o)
 
 	// list of hash indices after/before Object moved
 	std::set<int> updatedIndices;
-	std::set<int> oldIndices = o->GetHashIndices();
+	const std::set<int>& oldIndices = o->GetHashIndices();
 
 	// Iterators to track 'end' of currentIndices list
 /*	auto oldEnd = oldIndices.end();
@@ -393,7 +927,7 @@ SpatialHashCell* World::QueryHash(Vector v)
 
 void World::RemoveFromHash(RigidBody* o)
 {
-	std::set<int> indices = o->GetHashIndices();
+	const std::set<int>& indices = o->GetHashIndices();
 	SpatialHashCell* cell;
 	std::vector<RigidBody*>::iterator i;
 	for(auto iter = indices.begin(); iter != indices.end(); ++iter)
@@ -401,6 +935,29 @@ void World::RemoveFromHash(RigidBody* o)
 		cell = hashTable[*iter];
 		i = std::find(cell->bucket.begin(), cell->bucket.end(), o);
 		cell->bucket.erase(i, i+1);
+		RemoveHashCellLayers(cell, o->hashedCollisionTypes, o->hashedCollisionMasks);
+	}
+}
+
+void World::AddHashCellLayers(SpatialHashCell* cell, int types, int masks)
+{
+	unsigned int t = (unsigned int)types, m = (unsigned int)masks;
+	for(unsigned int i = 0; (t | m) != 0; ++i, t >>= 1, m >>= 1)
+	{
+		if((t & 1) && cell->typeCounts[i]++ == 0) cell->collisionTypes |= (int)(1u << i);
+		if((m & 1) && cell->maskCounts[i]++ == 0) cell->collisionMasks |= (int)(1u << i);
+	}
+}
+
+void World::RemoveHashCellLayers(SpatialHashCell* cell, int types, int masks)
+{
+	unsigned int t = (unsigned int)types, m = (unsigned int)masks;
+	for(unsigned int i = 0; (t | m) != 0; ++i, t >>= 1, m >>= 1)
+	{
+		AssertMsg(!(t & 1) || cell->typeCounts[i] > 0, "Removing a Collision Type that was never added to the hash cell");
+		AssertMsg(!(m & 1) || cell->maskCounts[i] > 0, "Removing a Collision Mask that was never added to the hash cell");
+		if((t & 1) && --cell->typeCounts[i] == 0) cell->collisionTypes &= ~(int)(1u << i);
+		if((m & 1) && --cell->maskCounts[i] == 0) cell->collisionMasks &= ~(int)(1u << i);
 	}
 }
 
@@ -411,9 +968,8 @@ Object* World::RayCast(Ray ray, gFloat& t, int mask)
 {
 	// Pre-define variables before using them
 	SpatialHashCell* cell;
-	std::vector<Collider*> colliders;
 	std::set<unsigned int> objectIDs;
-	unsigned int id, numC, index;
+	unsigned int id, index;
 	gFloat dist = 0;
 
 	// Get parameters for moving down the ray incrementally
@@ -429,26 +985,27 @@ Object* World::RayCast(Ray ray, gFloat& t, int mask)
 		index = Hash(start + delta*dist);
 		if(index >= numBuckets) return nullptr;
 		cell = hashTable[index];
-		if(cell != nullptr)
+		// Skip cells where nothing matches the ray's mask
+		if(cell != nullptr && (cell->collisionMasks & mask) != 0)
 		{
 			// Check each Object in cell for collision with ray
 			for(unsigned int i = 0; i < cell->bucket.size(); ++i)
 			{
 				// Make sure we haven't checked this Object already (Objects can be in multiple cells)
 				id = cell->bucket[i]->GetID();
-				if(objectIDs.count(id) == 0)
+				if((cell->bucket[i]->GetCollisionMasks() & mask) != 0 && objectIDs.count(id) == 0)
 				{
 					//objectIDs.insert(id);
 
 					// Check each Collider for each Object
-					numC = cell->bucket[i]->GetColliders(colliders);
-					for(unsigned int j = 0; j < numC; ++j)
+					const std::vector<Collider*>& colliders = cell->bucket[i]->GetColliders();
+					for(unsigned int j = 0; j < colliders.size(); ++j)
 					{
 						// Check that the Collider is enabled and matches the collision mask of the ray
 						if(colliders[j]->IsEnabled() && colliders[j]->QueryCollisionMask(mask))
 						{
 							// Actually test collider against ray
-							if(CollisionTests::RayAABBTest(ray, colliders[j]->GetBounds(), t))
+							if(CollisionTests::RayColliderTest(ray, colliders[j], t))
 							//if(CollisionTests::RaySphereTest(ray, colliders[j]->GetPosition(), colliders[j]->GetBounds().GetRadius(), t))
 								return cell->bucket[i];	// if collision, return the object
 						}
@@ -501,9 +1058,8 @@ std::vector<std::pair<Object*, gFloat>> World::RayCastPenetrate(Ray ray, int mas
 	// Pre-define variables before using them
 	std::vector<std::pair<Object*, gFloat>> objects;
 	SpatialHashCell* cell;
-	std::vector<Collider*> colliders;
 	std::set<unsigned int> objectIDs;
-	unsigned int id, numC, index;
+	unsigned int id, index;
 	gFloat dist = 0, t;
 
 	// Get parameters for moving down the ray incrementally
@@ -519,26 +1075,27 @@ std::vector<std::pair<Object*, gFloat>> World::RayCastPenetrate(Ray ray, int mas
 		index = Hash(start + delta*dist);
 		if(index >= numBuckets) continue;
 		cell = hashTable[index];
-		if(cell != nullptr)
+		// Skip cells where nothing matches the ray's mask
+		if(cell != nullptr && (cell->collisionMasks & mask) != 0)
 		{
 			// Check each Object in cell for collision with ray
 			for(unsigned int i = 0; i < cell->bucket.size(); ++i)
 			{
 				// Make sure we haven't checked this Object already (Objects can be in multiple cells)
 				id = cell->bucket[i]->GetID();
-				if(objectIDs.count(id) == 0)
+				if((cell->bucket[i]->GetCollisionMasks() & mask) != 0 && objectIDs.count(id) == 0)
 				{
 					objectIDs.insert(id);
 
 					// Check each Collider for each Object
-					numC = cell->bucket[i]->GetColliders(colliders);
-					for(unsigned int j = 0; j < numC; ++j)
+					const std::vector<Collider*>& colliders = cell->bucket[i]->GetColliders();
+					for(unsigned int j = 0; j < colliders.size(); ++j)
 					{
 						// Check that the Collider is enabled and matches the collision mask of the ray
 						if(colliders[j]->IsEnabled() && colliders[j]->QueryCollisionMask(mask))
 						{
 							// Actually test collider against ray
-							if(CollisionTests::RayAABBTest(ray, colliders[j]->GetBounds(), t))
+							if(CollisionTests::RayColliderTest(ray, colliders[j], t))
 								objects.push_back(std::make_pair(cell->bucket[i], t));	// if collision, Save object to return
 						}
 					}
@@ -621,11 +1178,64 @@ void World::AddContactGenerator(ContactGenerator* cg)
 }
 */
 
+void World::SetLayerCollision(unsigned int layerA, unsigned int layerB, bool collide)
+{
+	AssertMsg(layerA < NUM_COLLISION_LAYERS && layerB < NUM_COLLISION_LAYERS, "Collision Layer out of range");
+	if(collide)
+	{
+		layerMatrix[layerA] |= (int)(1u << layerB);
+		layerMatrix[layerB] |= (int)(1u << layerA);
+	}
+	else
+	{
+		layerMatrix[layerA] &= ~(int)(1u << layerB);
+		layerMatrix[layerB] &= ~(int)(1u << layerA);
+	}
+}
+
+bool World::GetLayerCollision(unsigned int layerA, unsigned int layerB) const
+{
+	return (layerMatrix[layerA] & (int)(1u << layerB)) != 0;
+}
+
+int World::LayersCollidingWith(int types) const
+{
+	int layers = 0;
+	unsigned int bits = (unsigned int)types;
+	for(unsigned int i = 0; bits != 0; ++i, bits >>= 1)
+		if(bits & 1) layers |= layerMatrix[i];
+	return layers;
+}
+
+void World::UpdateCollisionLayers(RigidBody* rb)
+{
+	rb->UpdateCollisionLayers();
+	const std::set<int>& indices = rb->GetHashIndices();
+	for(auto iter = indices.begin(); iter != indices.end(); ++iter)
+	{
+		RemoveHashCellLayers(hashTable[*iter], rb->hashedCollisionTypes, rb->hashedCollisionMasks);
+		AddHashCellLayers(hashTable[*iter], rb->GetCollisionTypes(), rb->GetCollisionMasks());
+	}
+	rb->hashedCollisionTypes = rb->GetCollisionTypes();
+	rb->hashedCollisionMasks = rb->GetCollisionMasks();
+}
+
 std::vector<RigidBody*>& World::GetRigidBodies()
 {
 	return rigidBodies;
 }
 
+void World::SetContactBudget(unsigned int budget, unsigned int growthLimit)
+{
+	contactStream.SetBudget(budget);
+	if(growthLimit > 0)
+		contactStream.SetGrowthLimit(growthLimit);
+}
+
+void World::SetContactOverflowPolicy(ContactStream::OverflowPolicy policy) { contactStream.SetOverflowPolicy(policy); }
+unsigned int World::GetContactHighWaterMark() const { return contactStream.GetHighWaterMark(); }
+unsigned int World::GetDroppedContactCount() const { return contactStream.GetDroppedCount(); }
+
 /*
 std::map<int, ForceGenerator*>& World::GetForceGenerators()
 {
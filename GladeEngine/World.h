@@ -7,17 +7,95 @@
 //#include "Force Generators\ForceGenerator.h"
 //#include "Contact Generators\ContactGenerator.h"
 #include "Contacts\ContactResolver.h"
+#include "Contacts\ContactStream.h"
 #include "CollisionTests.h"
+#ifdef BATCH_COLLIDER_UPDATE
+#include "ColliderUpdateBatch.h"
+#endif
 #include "System\Camera.h"
+#include "System\Threads\WorkerPool.h"
+#ifdef SLEEP_ISLANDS
+#include "IslandManager.h"
+#endif
 #include <algorithm>
 #include <map>
 
+// Below this total estimated cost, narrowphase stays on the calling thread
+#define MIN_PARALLEL_NARROWPHASE_COST 64
+
+// How far a pair can move relative to each other before its cached narrowphase results are thrown out
+#define PAIR_CACHE_LINEAR_TOLERANCE		gFloat(0.005f)	// Distance
+#define PAIR_CACHE_ANGULAR_TOLERANCE	gFloat(0.01f)	// Radians
+// Number of steps in a row cached results can be reused before the pair is fully tested again
+#define PAIR_CACHE_MAX_AGE				8
+
+// One Collision Layer per bit of a Collider's Collision Type
+#define NUM_COLLISION_LAYERS	32
+
+// Continuous Collision Detection stops sweeping a pair of Colliders once they are this close
+#define CCD_DISTANCE_TOLERANCE	gFloat(0.01f)
+// Most conservative advancement steps per pair of Colliders. The sweep stops wherever it got to
+#define CCD_MAX_ITERATIONS		16
+
 namespace Glade {
+#ifdef NARROWPHASE_CACHE
+// A Contact from a pair's last full test, along with where it was on each RigidBody
+struct CachedContact
+{
+	Contact contact;
+	Vector localPoint1;		// Contact point in b1's local space
+	Vector localPoint2;		// Contact point in b2's local space
+	Vector localNormal;		// Contact normal in b1's local space
+};
+
+// Narrowphase results for a pair of RigidBodies, kept from the last time the pair was fully tested
+struct PairCache
+{
+	PairCache() : margin(0), lastStep(0), age(0), complete(false), reuse(false) { }
+
+	Vector relativePosition;		// Centroid of 'b' in the local space of 'a' when last tested
+	Quaternion relativeOrientation;	// Orientation of 'b' relative to 'a' when last tested
+	gFloat margin;					// Speculative margin used when last tested
+	unsigned int lastStep;			// Step the pair was last found by broadphase
+	unsigned int age;				// Steps in a row the results have been reused
+	bool complete;					// Last test ran over every pair of Colliders
+	bool reuse;						// Results are reused this step instead of testing
+
+	// Results of each pair of Colliders, indexed by (a * number of Colliders on b + b)
+	std::vector<unsigned int> used;
+	std::vector<CachedContact> contacts;	// MAX_CONTACTS_PER_TEST per pair of Colliders
+#ifdef COLLISION_WARM_START
+	std::vector<CollisionWarmStart> warmStarts;	// Indexed the same as 'used'. Kept across full tests, unlike the Contacts
+#endif
+};
+#endif
+
+// Two RigidBodies whose AABBs overlap and need to be tested by narrowphase
+struct CollisionPair
+{
+	RigidBody* a;		// RigidBody with the lower ID
+	RigidBody* b;		// RigidBody with the higher ID
+	unsigned int cost;	// Estimated narrowphase cost, used to split pairs evenly across threads
+	gFloat margin;		// Distance the pair can close this step. Colliders this close generate Speculative Contacts
+	CollisionTests::Kernel kernel;	// Collision Test for the pair's only pair of Colliders. nullptr if either has several
+#ifdef NARROWPHASE_CACHE
+	PairCache* cache;	// Results from the last time the pair was tested
+#endif
+#ifdef BATCH_SPHERE_TESTS
+	SphereBatch* batch;			// Batch the pair was tested in, if it was batched
+	unsigned int batchIndex;	// Index of the pair in 'batch'
+#endif
+};
+
 struct SpatialHashCell
 {
 	AABB boundingBox;
 	std::vector<RigidBody*> bucket;
 	unsigned int index;
+	int collisionTypes;		// Collision Types of every RigidBody in 'bucket' combined
+	int collisionMasks;		// Collision Masks of every RigidBody in 'bucket' combined
+	unsigned int typeCounts[32];	// Number of RigidBodies in 'bucket' with each Collision Type bit, so a bit is only
+	unsigned int maskCounts[32];	//  cleared when the last of them leaves instead of rescanning 'bucket'
 };
 
 /*
@@ -30,6 +108,8 @@ public:
 	~World();
 
 	unsigned int GenerateContacts();
+	void BroadPhase();
+	void NarrowPhase();
 	void PhysicsUpdate(gFloat dt);
 
 	void AddRigidBody(RigidBody* rb);
@@ -37,6 +117,19 @@ public:
 //	void AddContactGenerator(ContactGenerator* cg);
 
 	std::vector<RigidBody*>& GetRigidBodies();
+
+	// Control how many Contacts can be generated in one step and what happens when a step generates more
+	void SetContactBudget(unsigned int budget, unsigned int growthLimit=0);
+	void SetContactOverflowPolicy(ContactStream::OverflowPolicy policy);
+	unsigned int GetContactHighWaterMark() const;
+	unsigned int GetDroppedContactCount() const;
+	// Collision Layers. Each bit of a Collider's Collision Type is a layer, and every pair of layers can be set to collide
+	// or not (all collide by default). Colliders only collide if their layers do and their Collision Masks allow it.
+	// Pairs of RigidBodies that can't are dropped by BroadPhase before their bounds are tested
+	void SetLayerCollision(unsigned int layerA, unsigned int layerB, bool collide);
+	bool GetLayerCollision(unsigned int layerA, unsigned int layerB) const;
+	// Recombine a RigidBody's layers after changing one of its Colliders' Collision Type or Mask
+	void UpdateCollisionLayers(RigidBody* rb);
 //	std::map<int, ForceGenerator*>& GetForceGenerators();
 //	std::vector<ContactGenerator*>& GetContactGenerators();
 
@@ -55,12 +148,73 @@ protected:
 	// Contact Resolver that calculates and resolves all contacts each frame
 	ContactResolver contactResolver;
 
-	// List of all Contacts that occured and are processed each frame
-	Contact* contacts;
+	// Stream of all Contacts that occured and are processed each frame
+	ContactStream contactStream;
 	std::vector<ContactBatch*> contactBatches;
 
+#ifdef SLEEP_ISLANDS
+	// Groups RigidBodies by the Contacts between them so they sleep and wake together
+	IslandManager islandManager;
+#endif
+
+	// Pairs of RigidBodies found by broadphase this step, sorted by ID
+	std::vector<CollisionPair> collisionPairs;
+
+	// Threads narrowphase is split across. Each thread works on a contiguous chunk of 'collisionPairs'
+	// and writes into its own stream. Streams are merged into 'contactStream' in chunk order
+	WorkerPool workerPool;
+	std::vector<ContactStream*> chunkStreams;
+	std::vector<unsigned int> chunkStart;
+
+#ifdef BATCH_COLLIDER_UPDATE
+	// Colliders of RigidBodies that integrated this step, moved together once all of them have
+	ColliderUpdateBatch colliderUpdate;
+	std::vector<RigidBody*> movedBodies;
+#endif
+
+#ifdef NARROWPHASE_CACHE
+	// Narrowphase results of every pair found by broadphase last step, by IDs of the pair
+	// Entries are only added or removed on the calling thread, so each narrowphase thread can use its own pairs' entries
+	std::map<std::pair<unsigned int, unsigned int>, PairCache> pairCache;
+	unsigned int stepCount;
+
+	// Check if a pair has moved little enough relative to each other to reuse its cached Contacts
+	bool CanReuseCache(const CollisionPair& pair);
+	// Save Contacts generated by one pair of Colliders in the pair's cache
+	void StoreCachedContacts(PairCache& cache, unsigned int index, Contact* contacts, unsigned int used);
+	// Move cached Contacts along with the RigidBodies and add them to 'stream'
+	bool ReuseCachedContacts(const CollisionPair& pair, ContactStream& stream);
+#endif
+
+#ifdef BATCH_SPHERE_TESTS
+	// Pairs of RigidBodies with one Sphere Collider against one Sphere or Plane Collider, tested together before
+	// the rest of narrowphase. TestPair only reads back their results, so Contacts stay in pair order
+	SphereBatch sphereSphereBatch;
+	SphereBatch spherePlaneBatch;
+
+	// Add pair to one of the batches if it only has one pair of Colliders and they can be batched
+	bool BatchPair(CollisionPair& pair);
+#endif
+
+#ifdef CONTINUOUS_COLLISION
+	// Move each RigidBody using CCD back to its earliest Time of Impact with any RigidBody broadphase paired it with
+	void SweepPairs();
+	// Fraction of the step (0 to 1) the pair first comes within CCD_DISTANCE_TOLERANCE. 1 if they don't
+	gFloat TimeOfImpact(RigidBody* a, RigidBody* b);
+#endif
+
+	// Layers each layer collides with, one bit per layer. Kept symmetric
+	int layerMatrix[NUM_COLLISION_LAYERS];
+
+	// Layers that any of 'types' collides with
+	int LayersCollidingWith(int types) const;
+	// Whether Collider 'a' can collide with Collider 'b', by Collision Mask and Collision Layer
+	bool CanCollide(Collider* a, Collider* b) const { return a->QueryCollisionMask(b->GetCollisionType()) && (LayersCollidingWith(a->GetCollisionType()) & b->GetCollisionType()) != 0; }
+
 	bool calculateIterations;
-	unsigned int maxContacts;
+
+	// Test all Colliders of one pair of RigidBodies. Returns false if 'stream' is full and reporting
+	bool TestPair(const CollisionPair& pair, ContactStream& stream);
 
 	// Engine/Game can run on variable framerate, but physicss runs at a fixed rate
 	// This tracks time as it passes and updates physics properly at fixed steps
@@ -75,6 +229,8 @@ protected:
 	void					UpdateHashedObject(RigidBody* o);
 	SpatialHashCell*		QueryHash(Vector v);
 	void					RemoveFromHash(RigidBody* o);
+	void					AddHashCellLayers(SpatialHashCell* cell, int types, int masks);
+	void					RemoveHashCellLayers(SpatialHashCell* cell, int types, int masks);
 public:
 	Object*					RayCast(Ray ray, gFloat& t, int mask);
 	std::vector<std::pair<Object*, gFloat>>	